@@ -70,7 +70,41 @@
 #define COAP_MAX_OBSERVERS    COAP_MAX_OPEN_TRANSACTIONS - 1
 #endif /* COAP_MAX_OBSERVERS */
 
+/* Find transactions by MID and observers by client through hash tables, and
+ * keep transactions in a queue ordered by their retransmission deadline */
+#ifndef COAP_WITH_HASH_INDEX
+#define COAP_WITH_HASH_INDEX           0
+#endif /* COAP_WITH_HASH_INDEX */
+
+/* Buckets of the transaction and observer hash tables (powers of two) */
+#ifndef COAP_TRANSACTION_HASH_SIZE
+#define COAP_TRANSACTION_HASH_SIZE     16
+#endif /* COAP_TRANSACTION_HASH_SIZE */
+#ifndef COAP_OBSERVER_HASH_SIZE
+#define COAP_OBSERVER_HASH_SIZE        8
+#endif /* COAP_OBSERVER_HASH_SIZE */
+
+/* Number of clients whose recent message IDs are remembered to drop replays,
+ * 0 disables the check. Clients are told apart by their client identity only,
+ * so every sender needs its own identity when this is enabled. */
+#ifndef COAP_MAX_REPLAY_CLIENTS
+#define COAP_MAX_REPLAY_CLIENTS        0
+#endif /* COAP_MAX_REPLAY_CLIENTS */
+
+/* Number of message IDs up to the latest one of a client that are still accepted once (power of two) */
+#ifndef COAP_REPLAY_WINDOW_SIZE
+#define COAP_REPLAY_WINDOW_SIZE        32
+#endif /* COAP_REPLAY_WINDOW_SIZE */
+
 /* Interval in notifies in which NON notifies are changed to CON notifies to check client. */
 #define COAP_OBSERVE_REFRESH_INTERVAL  20
 
+/* Render a notification once for all observers of a resource instead of once
+ * per observer, and merge notifications into an observer's outstanding CON.
+ * Retransmitting a merged CON parses the encrypted payload again, which needs
+ * an AES driver with decrypt support; the software aes-128 driver has none. */
+#ifndef COAP_OBSERVE_BATCH_NOTIFICATIONS
+#define COAP_OBSERVE_BATCH_NOTIFICATIONS 0
+#endif /* COAP_OBSERVE_BATCH_NOTIFICATIONS */
+
 #endif /* ER_COAP_CONF_H_ */
@@ -66,7 +66,9 @@
 
 #define COAP_HEADER_HMAC_LENGTH              8  /* The maximum number of bytes for the HMAC, value range from 0 to 32 */
 #define COAP_DEFAULT_CLIENT_IDENTITY         1  /* The client identity to use, a suitable PSK must exist */
-#define COAP_BOOT_COUNTER_FILENAME           "bootcounter.hex"
+#define COAP_BOOT_COUNTER_FILENAME           "bootcounter.log"
+#define COAP_BOOT_COUNTER_SPARE_FILENAME     "bootcounter.bak"
+#define COAP_BOOT_COUNTER_LEGACY_FILENAME    "bootcounter.hex"
 #define COAP_MAX_BOOT_COUNTER_CACHE_READS    0xFFFF
 
 /* CoAP message types */
@@ -129,7 +131,8 @@ typedef enum {
   ENCRYPTED_HMAC_INVALID,
   UNENCRYPTED_HMAC_INVALID,
   ENCRYPTED_MALWARE_WITH_HMAC_INVALID,
-  UNENCRYPTED_MALWARE_WITH_HMAC_INVALID
+  UNENCRYPTED_MALWARE_WITH_HMAC_INVALID,
+  REPLAYED
 } coap_status_t;
 
 /* CoAP header option numbers */
@@ -41,6 +41,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "er-coap-engine.h"
+#include "er-coap-replay.h"
 
 #define DEBUG 1
 #if DEBUG
@@ -76,6 +77,9 @@ coap_receive(void)
   static coap_packet_t message[1]; /* this way the packet can be treated as pointer as usual */
   static coap_packet_t response[1];
   static coap_transaction_t *transaction = NULL;
+#if COAP_MAX_REPLAY_CLIENTS
+  static coap_scan_t scan[1];
+#endif /* COAP_MAX_REPLAY_CLIENTS */
 
   if(uip_newdata()) {
 
@@ -84,11 +88,27 @@ coap_receive(void)
     PRINTF(":%u\n  Length: %u\n", uip_ntohs(UIP_UDP_BUF->srcport),
            uip_datalen());
 
+#if COAP_MAX_REPLAY_CLIENTS
+    /* drop replays silently, before their HMAC is calculated */
+    if(coap_scan_message(scan, uip_appdata, uip_datalen()) == NO_ERROR
+       && !coap_replay_check(scan)) {
+      PRINTF("Dropped replay of MID %u from client %u\n", scan->mid,
+             scan->client_identity);
+      erbium_status_code = REPLAYED;
+      return erbium_status_code;
+    }
+#endif /* COAP_MAX_REPLAY_CLIENTS */
+
     erbium_status_code =
       coap_parse_message(message, uip_appdata, uip_datalen());
 
     if(erbium_status_code == NO_ERROR) {
 
+#if COAP_MAX_REPLAY_CLIENTS
+      /* the message is authentic, so later copies of it are replays */
+      coap_replay_accept(scan);
+#endif /* COAP_MAX_REPLAY_CLIENTS */
+
       /*TODO duplicates suppression, if required by application */
 
       PRINTF("  Parsed: v %u, t %u, tkl %u, c %u, mid %u\n", message->version,
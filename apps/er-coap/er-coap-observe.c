@@ -55,9 +55,55 @@
 /*---------------------------------------------------------------------------*/
 MEMB(observers_memb, coap_observer_t, COAP_MAX_OBSERVERS);
 LIST(observers_list);
+#if COAP_WITH_HASH_INDEX
+/* observers by client address and port, their tokens are compared per bucket */
+static coap_observer_t *client_table[COAP_OBSERVER_HASH_SIZE];
+#endif /* COAP_WITH_HASH_INDEX */
+
+#if COAP_OBSERVE_BATCH_NOTIFICATIONS
+/*
+ * A notification is serialized once, without a token, behind room for the
+ * longest token. Each observer's type, MID and token are then written in
+ * front of the options.
+ */
+static uint8_t notification_buffer[COAP_TOKEN_LEN + COAP_MAX_PACKET_SIZE + 1];
+
+/* Observe option value shared by all observers, it only has to increase */
+static uint32_t observe_clock;
+#endif /* COAP_OBSERVE_BATCH_NOTIFICATIONS */
 /*---------------------------------------------------------------------------*/
 /*- Internal API ------------------------------------------------------------*/
 /*---------------------------------------------------------------------------*/
+#if COAP_WITH_HASH_INDEX
+static coap_observer_t **
+client_bucket(uip_ipaddr_t *addr, uint16_t port)
+{
+  return &client_table[(addr->u8[14] ^ addr->u8[15] ^ (port >> 8) ^ port)
+                       & (COAP_OBSERVER_HASH_SIZE - 1)];
+}
+#endif /* COAP_WITH_HASH_INDEX */
+/*---------------------------------------------------------------------------*/
+/* First observer that may belong to the client */
+static coap_observer_t *
+first_of_client(uip_ipaddr_t *addr, uint16_t port)
+{
+#if COAP_WITH_HASH_INDEX
+  return *client_bucket(addr, port);
+#else /* COAP_WITH_HASH_INDEX */
+  return (coap_observer_t *)list_head(observers_list);
+#endif /* COAP_WITH_HASH_INDEX */
+}
+/*---------------------------------------------------------------------------*/
+static coap_observer_t *
+next_of_client(coap_observer_t *obs)
+{
+#if COAP_WITH_HASH_INDEX
+  return obs->client_next;
+#else /* COAP_WITH_HASH_INDEX */
+  return obs->next;
+#endif /* COAP_WITH_HASH_INDEX */
+}
+/*---------------------------------------------------------------------------*/
 static coap_observer_t *
 add_observer(uip_ipaddr_t *addr, uint16_t port, const uint8_t *token,
              size_t token_len, const char *uri, int uri_len)
@@ -84,6 +130,10 @@ add_observer(uip_ipaddr_t *addr, uint16_t port, const uint8_t *token,
            list_length(observers_list) + 1, COAP_MAX_OBSERVERS,
            o->url, o->token[0], o->token[1]);
     list_add(observers_list, o);
+#if COAP_WITH_HASH_INDEX
+    o->client_next = *client_bucket(addr, port);
+    *client_bucket(addr, port) = o;
+#endif /* COAP_WITH_HASH_INDEX */
   }
 
   return o;
@@ -97,6 +147,16 @@ coap_remove_observer(coap_observer_t *o)
   PRINTF("Removing observer for /%s [0x%02X%02X]\n", o->url, o->token[0],
          o->token[1]);
 
+#if COAP_WITH_HASH_INDEX
+  coap_observer_t **p;
+
+  for(p = client_bucket(&o->addr, o->port); *p; p = &(*p)->client_next) {
+    if(*p == o) {
+      *p = o->client_next;
+      break;
+    }
+  }
+#endif /* COAP_WITH_HASH_INDEX */
   memb_free(&observers_memb, o);
   list_remove(observers_list, o);
 }
@@ -106,9 +166,10 @@ coap_remove_observer_by_client(uip_ipaddr_t *addr, uint16_t port)
 {
   int removed = 0;
   coap_observer_t *obs = NULL;
+  coap_observer_t *next;
 
-  for(obs = (coap_observer_t *)list_head(observers_list); obs;
-      obs = obs->next) {
+  for(obs = first_of_client(addr, port); obs; obs = next) {
+    next = next_of_client(obs);
     PRINTF("Remove check client ");
     PRINT6ADDR(addr);
     PRINTF(":%u\n", port);
@@ -126,9 +187,10 @@ coap_remove_observer_by_token(uip_ipaddr_t *addr, uint16_t port,
 {
   int removed = 0;
   coap_observer_t *obs = NULL;
+  coap_observer_t *next;
 
-  for(obs = (coap_observer_t *)list_head(observers_list); obs;
-      obs = obs->next) {
+  for(obs = first_of_client(addr, port); obs; obs = next) {
+    next = next_of_client(obs);
     PRINTF("Remove check Token 0x%02X%02X\n", token[0], token[1]);
     if(uip_ipaddr_cmp(&obs->addr, addr) && obs->port == port
        && obs->token_len == token_len
@@ -146,9 +208,13 @@ coap_remove_observer_by_uri(uip_ipaddr_t *addr, uint16_t port,
 {
   int removed = 0;
   coap_observer_t *obs = NULL;
+  coap_observer_t *next;
 
-  for(obs = (coap_observer_t *)list_head(observers_list); obs;
-      obs = obs->next) {
+  /* without a client, all observers are checked */
+  obs = addr ? first_of_client(addr, port)
+    : (coap_observer_t *)list_head(observers_list);
+  for(; obs; obs = next) {
+    next = addr ? next_of_client(obs) : obs->next;
     PRINTF("Remove check URL %p\n", uri);
     if((addr == NULL
         || (uip_ipaddr_cmp(&obs->addr, addr) && obs->port == port))
@@ -165,9 +231,10 @@ coap_remove_observer_by_mid(uip_ipaddr_t *addr, uint16_t port, uint16_t mid)
 {
   int removed = 0;
   coap_observer_t *obs = NULL;
+  coap_observer_t *next;
 
-  for(obs = (coap_observer_t *)list_head(observers_list); obs;
-      obs = obs->next) {
+  for(obs = first_of_client(addr, port); obs; obs = next) {
+    next = next_of_client(obs);
     PRINTF("Remove check MID %u\n", mid);
     if(uip_ipaddr_cmp(&obs->addr, addr) && obs->port == port
        && obs->last_mid == mid) {
@@ -185,14 +252,166 @@ coap_notify_observers(resource_t *resource)
 {
   coap_notify_observers_sub(resource, NULL);
 }
+/*---------------------------------------------------------------------------*/
+static int
+observer_matches(coap_observer_t *obs, resource_t *resource,
+                 const char *url, int url_len)
+{
+  int obs_url_len = strlen(obs->url);
+
+  /* Do a match based on the parent/sub-resource match so that it is
+     possible to do parent-node observe */
+  return (obs_url_len == url_len
+          || (obs_url_len > url_len
+              && (resource->flags & HAS_SUB_RESOURCES)
+              && obs->url[url_len] == '/'))
+         && strncmp(url, obs->url, url_len) == 0;
+}
+/*---------------------------------------------------------------------------*/
+#if COAP_OBSERVE_BATCH_NOTIFICATIONS
+/*
+ * Writes the type, MID and token of an observer in front of the serialized
+ * notification and updates its HMAC. Returns the start of the packet.
+ */
+static uint8_t *
+address_notification(coap_packet_t *notification, const uint8_t *header,
+                     uint16_t hmac_position, size_t packet_len,
+                     coap_observer_t *obs, coap_message_type_t type,
+                     uint16_t mid)
+{
+  uint8_t *packet = notification_buffer + COAP_TOKEN_LEN - obs->token_len;
+
+  packet[0] = (header[0]
+               & ~(COAP_HEADER_TYPE_MASK | COAP_HEADER_TOKEN_LEN_MASK))
+    | (COAP_HEADER_TYPE_MASK & type << COAP_HEADER_TYPE_POSITION)
+    | (COAP_HEADER_TOKEN_LEN_MASK & obs->token_len);
+  packet[1] = header[1];
+  packet[2] = (uint8_t)(mid >> 8);
+  packet[3] = (uint8_t)mid;
+  memcpy(packet + COAP_HEADER_LEN, obs->token, obs->token_len);
+
+  if(hmac_position) {
+    notification->buffer = packet;
+    coap_update_hmac(notification, packet + obs->token_len + hmac_position
+                     + COAP_HEADER_HMAC_LENGTH, packet_len);
+  }
+  return packet;
+}
+/*---------------------------------------------------------------------------*/
+static void
+notify_batched(resource_t *resource, const char *url)
+{
+  coap_packet_t notification[1];
+  coap_packet_t request[1];
+  coap_scan_t scan[1];
+  coap_observer_t *obs = NULL;
+  coap_transaction_t *transaction;
+  coap_message_type_t type;
+  uint8_t *const body = notification_buffer + COAP_TOKEN_LEN;
+  uint8_t header[COAP_HEADER_LEN];
+  uint8_t *packet;
+  size_t body_len;
+  size_t packet_len;
+  uint16_t hmac_position = 0;
+  uint16_t mid;
+  int url_len = strlen(url);
+
+  for(obs = (coap_observer_t *)list_head(observers_list); obs;
+      obs = obs->next) {
+    if(observer_matches(obs, resource, url, url_len)) {
+      break;
+    }
+  }
+  if(obs == NULL) {
+    return;
+  }
+
+  /* render and serialize the representation once */
+  coap_init_message(notification, COAP_TYPE_NON, CONTENT_2_05, 0);
+  coap_init_message(request, COAP_TYPE_CON, COAP_GET, 0);
+  coap_set_header_uri_path(request, url);
+  resource->get_handler(request, notification, body + COAP_MAX_HEADER_SIZE,
+                        REST_MAX_CHUNK_SIZE, NULL);
+  if(notification->code < BAD_REQUEST_4_00) {
+    /* mask out to keep the CoAP observe option length <= 3 bytes */
+    observe_clock = (observe_clock + 1) & 0xffffff;
+    coap_set_header_observe(notification, observe_clock);
+  }
+  body_len = coap_serialize_message(notification, body);
+  if(body_len == 0) {
+    PRINTF("Observe: Could not serialize notification\n");
+    return;
+  }
+  memcpy(header, body, COAP_HEADER_LEN);
+  if(coap_scan_message(scan, body, body_len) == NO_ERROR) {
+    hmac_position = scan->hmac_position;
+  }
+
+  for(; obs; obs = obs->next) {
+    if(!observer_matches(obs, resource, url, url_len)) {
+      continue;
+    }
+
+    PRINTF("           Observer ");
+    PRINT6ADDR(&obs->addr);
+    PRINTF(":%u\n", obs->port);
+
+    packet_len = body_len + obs->token_len;
+    transaction = coap_get_transaction_by_mid(obs->last_mid);
+    if(transaction && transaction->port == obs->port
+       && uip_ipaddr_cmp(&transaction->addr, &obs->addr)) {
+      /* The observer has not acknowledged its last CON yet. The new state
+         replaces it and goes out when it would have been retransmitted. */
+      PRINTF("           Merged into outstanding CON %u\n", transaction->mid);
+      coap_set_transaction_mid(transaction, coap_get_mid());
+      packet = address_notification(notification, header, hmac_position,
+                                    packet_len, obs, COAP_TYPE_CON,
+                                    transaction->mid);
+      memcpy(transaction->packet, packet, packet_len);
+      transaction->packet_len = packet_len;
+      obs->last_mid = transaction->mid;
+    } else {
+      transaction = NULL;
+      type = COAP_TYPE_NON;
+      if(obs->obs_counter % COAP_OBSERVE_REFRESH_INTERVAL == 0) {
+        PRINTF("           Force Confirmable for\n");
+        transaction = coap_new_transaction(coap_get_mid(), &obs->addr,
+                                           obs->port);
+        if(transaction) {
+          type = COAP_TYPE_CON;
+        }
+      }
+      mid = transaction ? transaction->mid : coap_get_mid();
+      packet = address_notification(notification, header, hmac_position,
+                                    packet_len, obs, type, mid);
+      /* update last MID for RST matching */
+      obs->last_mid = mid;
+
+      if(transaction) {
+        memcpy(transaction->packet, packet, packet_len);
+        transaction->packet_len = packet_len;
+        coap_send_transaction(transaction);
+      } else {
+        coap_send_message(&obs->addr, obs->port, packet, packet_len);
+      }
+    }
+
+    (obs->obs_counter)++;
+    obs->obs_counter &= 0xffffff;
+  }
+}
+#endif /* COAP_OBSERVE_BATCH_NOTIFICATIONS */
+/*---------------------------------------------------------------------------*/
 void
 coap_notify_observers_sub(resource_t *resource, const char *subpath)
 {
+#if !COAP_OBSERVE_BATCH_NOTIFICATIONS
   /* build notification */
   coap_packet_t notification[1]; /* this way the packet can be treated as pointer as usual */
   coap_packet_t request[1]; /* this way the packet can be treated as pointer as usual */
   coap_observer_t *obs = NULL;
-  int url_len, obs_url_len;
+#endif /* !COAP_OBSERVE_BATCH_NOTIFICATIONS */
+  int url_len;
   char url[COAP_OBSERVER_URL_LEN];
 
   url_len = strlen(resource->url);
@@ -205,6 +424,9 @@ coap_notify_observers_sub(resource_t *resource, const char *subpath)
   /* url now contains the notify URL that needs to match the observer */
   PRINTF("Observe: Notification from %s\n", url);
 
+#if COAP_OBSERVE_BATCH_NOTIFICATIONS
+  notify_batched(resource, url);
+#else /* COAP_OBSERVE_BATCH_NOTIFICATIONS */
   coap_init_message(notification, COAP_TYPE_NON, CONTENT_2_05, 0);
   /* create a "fake" request for the URI */
   coap_init_message(request, COAP_TYPE_CON, COAP_GET, 0);
@@ -214,20 +436,13 @@ coap_notify_observers_sub(resource_t *resource, const char *subpath)
   url_len = strlen(url);
   for(obs = (coap_observer_t *)list_head(observers_list); obs;
       obs = obs->next) {
-    obs_url_len = strlen(obs->url);
-
-    /* Do a match based on the parent/sub-resource match so that it is
-       possible to do parent-node observe */
-    if((obs_url_len == url_len
-        || (obs_url_len > url_len
-            && (resource->flags & HAS_SUB_RESOURCES)
-            && obs->url[url_len] == '/'))
-       && strncmp(url, obs->url, url_len) == 0) {
+    if(observer_matches(obs, resource, url, url_len)) {
       coap_transaction_t *transaction = NULL;
 
       /*TODO implement special transaction for CON, sharing the same buffer to allow for more observers */
 
       if((transaction = coap_new_transaction(coap_get_mid(), &obs->addr, obs->port))) {
+        notification->type = COAP_TYPE_NON;
         if(obs->obs_counter % COAP_OBSERVE_REFRESH_INTERVAL == 0) {
           PRINTF("           Force Confirmable for\n");
           notification->type = COAP_TYPE_CON;
@@ -261,6 +476,7 @@ coap_notify_observers_sub(resource_t *resource, const char *subpath)
       }
     }
   }
+#endif /* COAP_OBSERVE_BATCH_NOTIFICATIONS */
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -277,7 +493,12 @@ coap_observe_handler(resource_t *resource, void *request, void *response)
                            coap_req->token, coap_req->token_len,
                            coap_req->uri_path, coap_req->uri_path_len);
         if(obs) {
+#if COAP_OBSERVE_BATCH_NOTIFICATIONS
+          coap_set_header_observe(coap_res, observe_clock);
+          (obs->obs_counter)++;
+#else /* COAP_OBSERVE_BATCH_NOTIFICATIONS */
           coap_set_header_observe(coap_res, (obs->obs_counter)++);
+#endif /* COAP_OBSERVE_BATCH_NOTIFICATIONS */
           /* mask out to keep the CoAP observe option length <= 3 bytes */
           obs->obs_counter &= 0xffffff;
           /*
@@ -55,6 +55,9 @@ typedef struct coap_observable {
 
 typedef struct coap_observer {
   struct coap_observer *next;   /* for LIST */
+#if COAP_WITH_HASH_INDEX
+  struct coap_observer *client_next;    /* for the client hash table */
+#endif /* COAP_WITH_HASH_INDEX */
 
   char url[COAP_OBSERVER_URL_LEN];
   uip_ipaddr_t addr;
@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) 2026, Hasso-Plattner-Institut.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *      CoAP replay protection based on the client identity, boot counter,
+ *      message ID and retransmission counter of secured messages
+ */
+
+#include "contiki.h"
+#include "lib/list.h"
+#include "lib/memb.h"
+#include "er-coap-replay.h"
+
+#include <string.h>
+
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+#if COAP_MAX_REPLAY_CLIENTS
+
+#if COAP_REPLAY_WINDOW_SIZE & (COAP_REPLAY_WINDOW_SIZE - 1)
+#error COAP_REPLAY_WINDOW_SIZE must be a power of two
+#endif
+
+#define SLOT(mid) ((mid) & (COAP_REPLAY_WINDOW_SIZE - 1))
+
+/*
+ * Messages of a client since its last boot. Slot mid % window size holds
+ * a bit for each retransmission counter seen with that message ID, as
+ * every retransmission is sent with a new counter and HMAC.
+ */
+typedef struct coap_replay_window {
+  struct coap_replay_window *next;      /* for LIST */
+
+  uint8_t client_identity;
+  uint16_t boot_counter;
+  uint16_t last_mid;                    /* highest message ID accepted */
+  uint8_t seen[COAP_REPLAY_WINDOW_SIZE];
+} coap_replay_window_t;
+
+/* most recently heard clients first */
+MEMB(windows_memb, coap_replay_window_t, COAP_MAX_REPLAY_CLIENTS);
+LIST(windows_list);
+
+struct coap_replay_stats coap_replay_stats;
+
+/*---------------------------------------------------------------------------*/
+static int
+is_tracked(const coap_scan_t *scan)
+{
+  /* ACKs and RSTs echo the message ID of the peer, which is tracked there */
+  return scan->client_identity != 0
+         && (scan->type == COAP_TYPE_CON || scan->type == COAP_TYPE_NON);
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+retransmission_bit(uint8_t retransmission_counter)
+{
+  /* counters beyond COAP_MAX_RETRANSMIT + 1 share the last bit */
+  return 1 << MIN(retransmission_counter, 7);
+}
+/*---------------------------------------------------------------------------*/
+static coap_replay_window_t *
+find_window(uint8_t client_identity)
+{
+  coap_replay_window_t *w;
+
+  for(w = list_head(windows_list); w; w = w->next) {
+    if(w->client_identity == client_identity) {
+      return w;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+int
+coap_replay_check(const coap_scan_t *scan)
+{
+  coap_replay_window_t *w;
+  int16_t offset;
+
+  if(!is_tracked(scan)) {
+    return 1;
+  }
+
+  w = find_window(scan->client_identity);
+  if(w == NULL) {
+    return 1;
+  }
+
+  if(scan->boot_counter != w->boot_counter) {
+    if(scan->boot_counter > w->boot_counter) {
+      return 1;
+    }
+    PRINTF("Replay: client %u boot %u before %u\n", scan->client_identity,
+           scan->boot_counter, w->boot_counter);
+    coap_replay_stats.stale_boot++;
+    return 0;
+  }
+
+  offset = (int16_t)(scan->mid - w->last_mid);
+  if(offset > 0) {
+    return 1;
+  }
+  if(offset <= -COAP_REPLAY_WINDOW_SIZE) {
+    PRINTF("Replay: client %u MID %u before %u\n", scan->client_identity,
+           scan->mid, w->last_mid);
+    coap_replay_stats.too_old++;
+    return 0;
+  }
+  if(w->seen[SLOT(scan->mid)]
+     & retransmission_bit(scan->retransmission_counter)) {
+    PRINTF("Replay: client %u MID %u retransmission %u\n",
+           scan->client_identity, scan->mid, scan->retransmission_counter);
+    coap_replay_stats.replayed++;
+    return 0;
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+reset_window(coap_replay_window_t *w, const coap_scan_t *scan)
+{
+  w->client_identity = scan->client_identity;
+  w->boot_counter = scan->boot_counter;
+  w->last_mid = scan->mid;
+  memset(w->seen, 0, sizeof(w->seen));
+}
+/*---------------------------------------------------------------------------*/
+void
+coap_replay_accept(const coap_scan_t *scan)
+{
+  coap_replay_window_t *w;
+
+  if(!is_tracked(scan)) {
+    return;
+  }
+
+  w = find_window(scan->client_identity);
+  if(w == NULL) {
+    w = memb_alloc(&windows_memb);
+    if(w == NULL) {
+      w = list_chop(windows_list);
+      coap_replay_stats.evicted++;
+    }
+    reset_window(w, scan);
+  } else {
+    list_remove(windows_list, w);
+    if(scan->boot_counter != w->boot_counter) {
+      reset_window(w, scan);
+    } else if((uint16_t)(scan->mid - w->last_mid) >= COAP_REPLAY_WINDOW_SIZE
+              && (int16_t)(scan->mid - w->last_mid) > 0) {
+      memset(w->seen, 0, sizeof(w->seen));
+      w->last_mid = scan->mid;
+    } else {
+      /* forget the message IDs the window moves past */
+      while((int16_t)(scan->mid - w->last_mid) > 0) {
+        w->last_mid++;
+        w->seen[SLOT(w->last_mid)] = 0;
+      }
+    }
+  }
+  list_push(windows_list, w);
+
+  w->seen[SLOT(scan->mid)] |= retransmission_bit(scan->retransmission_counter);
+}
+/*---------------------------------------------------------------------------*/
+#endif /* COAP_MAX_REPLAY_CLIENTS */
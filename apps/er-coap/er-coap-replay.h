@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2026, Hasso-Plattner-Institut.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *      CoAP replay protection based on the client identity, boot counter,
+ *      message ID and retransmission counter of secured messages
+ */
+
+#ifndef COAP_REPLAY_H_
+#define COAP_REPLAY_H_
+
+#include "er-coap.h"
+
+/* messages dropped by coap_replay_check() and clients forgotten for room */
+struct coap_replay_stats {
+  unsigned long replayed;  /* message ID and retransmission seen before */
+  unsigned long too_old;   /* message ID older than the window */
+  unsigned long stale_boot; /* boot counter older than the current one */
+  unsigned long evicted;   /* least recently heard clients forgotten */
+};
+
+extern struct coap_replay_stats coap_replay_stats;
+
+/*
+ * Returns 0 if the scanned message has been seen before or is too old to
+ * tell, otherwise 1. Only looks the message up, so it may run before the
+ * HMAC is verified. ACKs, RSTs and messages without a client identity are
+ * not tracked and always pass.
+ */
+int coap_replay_check(const coap_scan_t *scan);
+
+/* Remembers a message that passed coap_replay_check() and was authenticated */
+void coap_replay_accept(const coap_scan_t *scan);
+
+#endif /* COAP_REPLAY_H_ */
@@ -41,7 +41,7 @@
 #include "er-coap-transactions.h"
 #include "er-coap-observe.h"
 
-#define DEBUG 1
+#define DEBUG 0
 #if DEBUG
 #include <stdio.h>
 #define PRINTF(...) printf(__VA_ARGS__)
@@ -55,10 +55,116 @@
 
 /*---------------------------------------------------------------------------*/
 MEMB(transactions_memb, coap_transaction_t, COAP_MAX_OPEN_TRANSACTIONS);
+#if COAP_WITH_HASH_INDEX
+static coap_transaction_t *mid_table[COAP_TRANSACTION_HASH_SIZE];
+
+/* CONs waiting for an ACK, the next one to retransmit first */
+static coap_transaction_t *queue_head;
+static coap_transaction_t *queue_tail;
+static struct etimer retrans_timer;
+
+/* a is due before b, also when the clock has wrapped between them */
+#define DEADLINE_BEFORE(a, b) \
+  ((clock_time_t)((a) - (b)) > ((clock_time_t)~(clock_time_t)0 >> 1))
+#else /* COAP_WITH_HASH_INDEX */
 LIST(transactions_list);
+#endif /* COAP_WITH_HASH_INDEX */
 
 static struct process *transaction_handler_process = NULL;
 
+#if COAP_WITH_HASH_INDEX
+/*---------------------------------------------------------------------------*/
+static coap_transaction_t **
+mid_bucket(uint16_t mid)
+{
+  /* MIDs are handed out in sequence, so the low bits spread them evenly */
+  return &mid_table[mid & (COAP_TRANSACTION_HASH_SIZE - 1)];
+}
+/*---------------------------------------------------------------------------*/
+static void
+unindex_transaction(coap_transaction_t *t)
+{
+  coap_transaction_t **p;
+
+  for(p = mid_bucket(t->mid); *p; p = &(*p)->mid_next) {
+    if(*p == t) {
+      *p = t->mid_next;
+      break;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_transaction(coap_transaction_t *t)
+{
+  coap_transaction_t **bucket = mid_bucket(t->mid);
+
+  t->mid_next = *bucket;
+  *bucket = t;
+}
+/*---------------------------------------------------------------------------*/
+static void
+arm_retrans_timer(void)
+{
+  clock_time_t now = clock_time();
+
+  if(queue_head == NULL) {
+    etimer_stop(&retrans_timer);
+    return;
+  }
+
+  PROCESS_CONTEXT_BEGIN(transaction_handler_process);
+  etimer_set(&retrans_timer,
+             DEADLINE_BEFORE(now, queue_head->retrans_deadline)
+             ? queue_head->retrans_deadline - now : 0);
+  PROCESS_CONTEXT_END(transaction_handler_process);
+}
+/*---------------------------------------------------------------------------*/
+static void
+dequeue_transaction(coap_transaction_t *t)
+{
+  if(t->queue_prev) {
+    t->queue_prev->queue_next = t->queue_next;
+  } else if(queue_head == t) {
+    queue_head = t->queue_next;
+  } else {
+    /* not queued */
+    return;
+  }
+  if(t->queue_next) {
+    t->queue_next->queue_prev = t->queue_prev;
+  } else {
+    queue_tail = t->queue_prev;
+  }
+  t->queue_prev = NULL;
+  t->queue_next = NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+enqueue_transaction(coap_transaction_t *t)
+{
+  coap_transaction_t *prev;
+
+  /* new deadlines are mostly the latest ones, so search from the tail */
+  for(prev = queue_tail;
+      prev && DEADLINE_BEFORE(t->retrans_deadline, prev->retrans_deadline);
+      prev = prev->queue_prev);
+
+  t->queue_prev = prev;
+  if(prev) {
+    t->queue_next = prev->queue_next;
+    prev->queue_next = t;
+  } else {
+    t->queue_next = queue_head;
+    queue_head = t;
+  }
+  if(t->queue_next) {
+    t->queue_next->queue_prev = t;
+  } else {
+    queue_tail = t;
+  }
+}
+#endif /* COAP_WITH_HASH_INDEX */
 /*---------------------------------------------------------------------------*/
 /*- Internal API ------------------------------------------------------------*/
 /*---------------------------------------------------------------------------*/
@@ -80,7 +186,13 @@ coap_new_transaction(uint16_t mid, uip_ipaddr_t *addr, uint16_t port)
     uip_ipaddr_copy(&t->addr, addr);
     t->port = port;
 
+#if COAP_WITH_HASH_INDEX
+    t->queue_prev = NULL;
+    t->queue_next = NULL;
+    index_transaction(t);
+#else /* COAP_WITH_HASH_INDEX */
     list_add(transactions_list, t); /* list itself makes sure same element is not added twice */
+#endif /* COAP_WITH_HASH_INDEX */
   }
 
   return t;
@@ -99,6 +211,26 @@ coap_send_transaction(coap_transaction_t *t)
       /* not timed out yet */
       PRINTF("Keeping transaction %u\n", t->mid);
 
+#if COAP_WITH_HASH_INDEX
+      if(t->retrans_counter == 0) {
+        t->retrans_interval =
+          COAP_RESPONSE_TIMEOUT_TICKS + (random_rand()
+                                         %
+                                         (clock_time_t)
+                                         COAP_RESPONSE_TIMEOUT_BACKOFF_MASK);
+      } else {
+        t->retrans_interval <<= 1;  /* double */
+      }
+      PRINTF("Interval (%u) %lu ticks\n", t->retrans_counter,
+             (unsigned long)t->retrans_interval);
+
+      dequeue_transaction(t);
+      t->retrans_deadline = clock_time() + t->retrans_interval;
+      enqueue_transaction(t);
+      if(queue_head == t) {
+        arm_retrans_timer();
+      }
+#else /* COAP_WITH_HASH_INDEX */
       if(t->retrans_counter == 0) {
         t->retrans_timer.timer.interval =
           COAP_RESPONSE_TIMEOUT_TICKS + (random_rand()
@@ -116,6 +248,7 @@ coap_send_transaction(coap_transaction_t *t)
       PROCESS_CONTEXT_BEGIN(transaction_handler_process);
       etimer_restart(&t->retrans_timer);        /* interval updated above */
       PROCESS_CONTEXT_END(transaction_handler_process);
+#endif /* COAP_WITH_HASH_INDEX */
 
       t = NULL;
     } else {
@@ -144,8 +277,18 @@ coap_clear_transaction(coap_transaction_t *t)
   if(t) {
     PRINTF("Freeing transaction %u: %p\n", t->mid, t);
 
+#if COAP_WITH_HASH_INDEX
+    unindex_transaction(t);
+    if(queue_head == t) {
+      dequeue_transaction(t);
+      arm_retrans_timer();
+    } else {
+      dequeue_transaction(t);
+    }
+#else /* COAP_WITH_HASH_INDEX */
     etimer_stop(&t->retrans_timer);
     list_remove(transactions_list, t);
+#endif /* COAP_WITH_HASH_INDEX */
     memb_free(&transactions_memb, t);
   }
 }
@@ -154,7 +297,11 @@ coap_get_transaction_by_mid(uint16_t mid)
 {
   coap_transaction_t *t = NULL;
 
+#if COAP_WITH_HASH_INDEX
+  for(t = *mid_bucket(mid); t; t = t->mid_next) {
+#else /* COAP_WITH_HASH_INDEX */
   for(t = (coap_transaction_t *)list_head(transactions_list); t; t = t->next) {
+#endif /* COAP_WITH_HASH_INDEX */
     if(t->mid == mid) {
       PRINTF("Found transaction for MID %u: %p\n", t->mid, t);
       return t;
@@ -164,10 +311,39 @@ coap_get_transaction_by_mid(uint16_t mid)
 }
 /*---------------------------------------------------------------------------*/
 void
+coap_set_transaction_mid(coap_transaction_t *t, uint16_t mid)
+{
+#if COAP_WITH_HASH_INDEX
+  unindex_transaction(t);
+  t->mid = mid;
+  index_transaction(t);
+#else /* COAP_WITH_HASH_INDEX */
+  t->mid = mid;
+#endif /* COAP_WITH_HASH_INDEX */
+}
+/*---------------------------------------------------------------------------*/
+void
 coap_check_transactions()
 {
   coap_transaction_t *t = NULL;
 
+#if COAP_WITH_HASH_INDEX
+  clock_time_t now = clock_time();
+  uint8_t retransmitted = 0;
+
+  /* only the due transactions at the head of the queue are visited */
+  while((t = queue_head) != NULL
+        && !DEADLINE_BEFORE(now, t->retrans_deadline)) {
+    dequeue_transaction(t);
+    ++(t->retrans_counter);
+    PRINTF("Retransmitting %u (%u)\n", t->mid, t->retrans_counter);
+    coap_send_transaction(t);
+    retransmitted = 1;
+  }
+  if(retransmitted || etimer_expired(&retrans_timer)) {
+    arm_retrans_timer();
+  }
+#else /* COAP_WITH_HASH_INDEX */
   for(t = (coap_transaction_t *)list_head(transactions_list); t; t = t->next) {
     if(etimer_expired(&t->retrans_timer)) {
       ++(t->retrans_counter);
@@ -175,5 +351,6 @@ coap_check_transactions()
       coap_send_transaction(t);
     }
   }
+#endif /* COAP_WITH_HASH_INDEX */
 }
 /*---------------------------------------------------------------------------*/
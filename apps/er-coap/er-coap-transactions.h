@@ -50,10 +50,18 @@
 
 /* container for transactions with message buffer and retransmission info */
 typedef struct coap_transaction {
+#if COAP_WITH_HASH_INDEX
+  struct coap_transaction *mid_next;    /* for the MID hash table */
+  struct coap_transaction *queue_prev;  /* for the retransmission queue */
+  struct coap_transaction *queue_next;
+  clock_time_t retrans_interval;
+  clock_time_t retrans_deadline;
+#else /* COAP_WITH_HASH_INDEX */
   struct coap_transaction *next;        /* for LIST */
+  struct etimer retrans_timer;
+#endif /* COAP_WITH_HASH_INDEX */
 
   uint16_t mid;
-  struct etimer retrans_timer;
   uint8_t retrans_counter;
 
   uip_ipaddr_t addr;
@@ -74,6 +82,7 @@ coap_transaction_t *coap_new_transaction(uint16_t mid, uip_ipaddr_t *addr,
 void coap_send_transaction(coap_transaction_t *t);
 void coap_clear_transaction(coap_transaction_t *t);
 coap_transaction_t *coap_get_transaction_by_mid(uint16_t mid);
+void coap_set_transaction_mid(coap_transaction_t *t, uint16_t mid);
 
 void coap_check_transactions(void);
 
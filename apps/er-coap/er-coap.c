@@ -42,16 +42,22 @@
 #include "contiki.h"
 #include "sys/cc.h"
 #include "contiki-net.h"
-#include "dev/sha256.h"
+#include "lib/sha-256.h"
 #include "lib/aes-128.h"
+#include "lib/persistent-counter.h"
 #include <cfs/cfs.h>
 
 #include "er-coap.h"
 #include "er-coap-transactions.h"
+#include "er-coap-replay.h"
 
 #include "er-coap-psk.h"
 
+#ifdef COAP_CONF_DEBUG
+#define DEBUG COAP_CONF_DEBUG
+#else
 #define DEBUG 1
+#endif
 #if DEBUG
 #include <stdio.h>
 #define PRINTF(...) printf(__VA_ARGS__)
@@ -847,6 +853,258 @@ coap_parse_message(void *packet, uint8_t *data, uint16_t data_len)
   return INTERNAL_SERVER_ERROR_5_00;
 }
 /*---------------------------------------------------------------------------*/
+coap_status_t
+coap_scan_message(coap_scan_t *scan, const uint8_t *data, uint16_t data_len)
+{
+  const uint8_t *current_option;
+  unsigned int option_number = 0;
+  unsigned int option_delta;
+  size_t option_length;
+  uint8_t token_len;
+
+  memset(scan, 0, sizeof(coap_scan_t));
+
+  if(data_len < COAP_HEADER_LEN) {
+    return BAD_REQUEST_4_00;
+  }
+
+  /* parse header fields */
+  if(((COAP_HEADER_VERSION_MASK & data[0]) >> COAP_HEADER_VERSION_POSITION)
+     != 1) {
+    return BAD_REQUEST_4_00;
+  }
+  scan->type = (COAP_HEADER_TYPE_MASK & data[0]) >> COAP_HEADER_TYPE_POSITION;
+  token_len = (COAP_HEADER_TOKEN_LEN_MASK & data[0])
+    >> COAP_HEADER_TOKEN_LEN_POSITION;
+  if(token_len > COAP_TOKEN_LEN) {
+    return BAD_REQUEST_4_00;
+  }
+  scan->code = data[1];
+  scan->mid = data[2] << 8 | data[3];
+
+  /* walk the options, with the same checks as coap_parse_message() */
+  current_option = data + COAP_HEADER_LEN + token_len;
+  while(current_option < data + data_len) {
+    if((current_option[0] & 0xF0) == 0xF0) {
+      ++current_option;
+      scan->payload_offset = current_option - data;
+      scan->payload_len = data_len - scan->payload_offset;
+      break;
+    }
+
+    option_delta = current_option[0] >> 4;
+    option_length = current_option[0] & 0x0F;
+    ++current_option;
+
+    if(option_delta == 13) {
+      option_delta += current_option[0];
+      ++current_option;
+    } else if(option_delta == 14) {
+      option_delta += 255;
+      option_delta += current_option[0] << 8;
+      ++current_option;
+      option_delta += current_option[0];
+      ++current_option;
+    }
+
+    if(option_length == 13) {
+      option_length += current_option[0];
+      ++current_option;
+    } else if(option_length == 14) {
+      option_length += 255;
+      option_length += current_option[0] << 8;
+      ++current_option;
+      option_length += current_option[0];
+      ++current_option;
+    }
+
+    if(current_option + option_length > data + data_len) {
+      return BAD_REQUEST_4_00;
+    }
+
+    option_number += option_delta;
+
+    if(option_number < COAP_OPTION_EXPERIMENTAL && option_number > COAP_OPTION_SIZE1) {
+      return BAD_REQUEST_4_00;
+    }
+
+    switch(option_number) {
+    case COAP_OPTION_PROXY_URI:
+    case COAP_OPTION_PROXY_SCHEME:
+      return PROXYING_NOT_SUPPORTED_5_05;
+    case COAP_OPTION_CLIENT_IDENTITY:
+      scan->client_identity = (uint8_t) coap_parse_int_option((uint8_t *)current_option, option_length);
+      break;
+    case COAP_OPTION_BOOT_COUNTER:
+      scan->boot_counter = (uint16_t) coap_parse_int_option((uint8_t *)current_option, option_length);
+      break;
+    case COAP_OPTION_RETRANSMISSION_COUNTER:
+      scan->retransmission_counter = (uint8_t) coap_parse_int_option((uint8_t *)current_option, option_length);
+      break;
+    case COAP_OPTION_HMAC:
+      /* the HMAC is verified in place, so it must have the full length */
+      if(option_length == COAP_HEADER_HMAC_LENGTH) {
+        scan->hmac_position = current_option - data;
+      }
+      break;
+    case COAP_OPTION_ENCR_ALG:
+      scan->encr_alg = (uint8_t) coap_parse_int_option((uint8_t *)current_option, option_length);
+      break;
+    case COAP_OPTION_IF_MATCH:
+    case COAP_OPTION_URI_HOST:
+    case COAP_OPTION_ETAG:
+    case COAP_OPTION_IF_NONE_MATCH:
+    case COAP_OPTION_OBSERVE:
+    case COAP_OPTION_URI_PORT:
+    case COAP_OPTION_LOCATION_PATH:
+    case COAP_OPTION_URI_PATH:
+    case COAP_OPTION_CONTENT_FORMAT:
+    case COAP_OPTION_MAX_AGE:
+    case COAP_OPTION_URI_QUERY:
+    case COAP_OPTION_ACCEPT:
+    case COAP_OPTION_LOCATION_QUERY:
+    case COAP_OPTION_BLOCK2:
+    case COAP_OPTION_BLOCK1:
+    case COAP_OPTION_SIZE2:
+    case COAP_OPTION_SIZE1:
+      break;
+    default:
+      /* check if critical (odd) */
+      if(option_number & 1) {
+        return BAD_OPTION_4_02;
+      }
+    }
+
+    current_option += option_length;
+  }
+
+  return NO_ERROR;
+}
+/*---------------------------------------------------------------------------*/
+#if COAP_ENABLE_PAYLOAD_INSPECTION == 1 && COAP_ENABLE_ENCRYPTION_SUPPORT == 1
+/*
+ * Decrypts the payload one block at a time and looks for the malware
+ * signature, like coap_is_malware_free() does on the decrypted copy.
+ * As there, the search ends at the first NUL byte. The signature has
+ * no prefix that is also a suffix, so a mismatch only needs to check
+ * whether the byte starts a new match.
+ */
+static bool
+is_encrypted_payload_malware_free(const uint8_t *payload, uint16_t payload_len)
+{
+  static const char signature[] = "EICAR";
+  uint8_t block[AES_128_BLOCK_SIZE];
+  uint8_t block_len;
+  uint8_t padding_len;
+  uint8_t matched;
+  uint16_t offset;
+  uint8_t i;
+  bool done;
+  bool malware_free;
+
+  if((payload_len % AES_128_BLOCK_SIZE) != 0) {
+    /* cannot be decrypted and thus not inspected */
+    return false;
+  }
+
+  AES_128_GET_LOCK();
+  AES_128.set_key(presharedkeys[COAP_DEFAULT_CLIENT_IDENTITY]);
+
+  matched = 0;
+  done = false;
+  malware_free = true;
+  for(offset = 0; offset < payload_len && malware_free;
+      offset += AES_128_BLOCK_SIZE) {
+    if(done) {
+      /* only the padding in the last block is left to check */
+      offset = payload_len - AES_128_BLOCK_SIZE;
+    }
+    memcpy(block, payload + offset, AES_128_BLOCK_SIZE);
+    AES_128.decrypt(block);
+
+    block_len = AES_128_BLOCK_SIZE;
+    if(offset + AES_128_BLOCK_SIZE == payload_len) {
+      padding_len = block[AES_128_BLOCK_SIZE - 1];
+      if(padding_len > AES_128_BLOCK_SIZE) {
+        malware_free = false;
+        break;
+      }
+      for(i = AES_128_BLOCK_SIZE - padding_len; i < AES_128_BLOCK_SIZE; i++) {
+        if(block[i] != padding_len) {
+          malware_free = false;
+        }
+      }
+      block_len -= padding_len;
+    }
+
+    for(i = 0; i < block_len && !done; i++) {
+      if(block[i] == '\0') {
+        done = true;
+      } else if(block[i] == signature[matched]) {
+        if(++matched == sizeof(signature) - 1) {
+          malware_free = false;
+          done = true;
+        }
+      } else {
+        matched = block[i] == signature[0];
+      }
+    }
+  }
+
+  AES_128_RELEASE_LOCK();
+  return malware_free;
+}
+#endif /* COAP_ENABLE_PAYLOAD_INSPECTION == 1 && COAP_ENABLE_ENCRYPTION_SUPPORT == 1 */
+/*---------------------------------------------------------------------------*/
+/**
+ * Runs the checks of coap_parse_message() on a message without copying
+ * or modifying it. The checks stop at the first failure, so the result
+ * may be less specific than the one of coap_parse_message(). With
+ * COAP_MAX_REPLAY_CLIENTS, replays are reported before the HMAC is
+ * checked; the caller passes authentic messages to coap_replay_accept().
+ */
+coap_status_t
+coap_inspect_message(coap_scan_t *scan, const uint8_t *data, uint16_t data_len)
+{
+  coap_status_t status;
+
+  status = coap_scan_message(scan, data, data_len);
+  if(status != NO_ERROR) {
+    return status;
+  }
+
+  /* the checks run in order of cost: header, replay, HMAC, payload */
+#if COAP_MAX_REPLAY_CLIENTS
+  if(!coap_replay_check(scan)) {
+    return REPLAYED;
+  }
+#endif /* COAP_MAX_REPLAY_CLIENTS */
+
+  if(scan->encr_alg != 0x01 && scan->payload_len > 0) {
+    return UNENCRYPTED;
+  }
+
+  if(!coap_is_valid_hmac((uint8_t *)data, scan->hmac_position, data_len)) {
+    return ENCRYPTED_HMAC_INVALID;
+  }
+
+#if COAP_ENABLE_PAYLOAD_INSPECTION == 1
+  if(scan->payload_len > 0) {
+#if COAP_ENABLE_ENCRYPTION_SUPPORT == 1
+    if(!is_encrypted_payload_malware_free(data + scan->payload_offset,
+                                          scan->payload_len)) {
+      return ENCRYPTED_MALWARE;
+    }
+#else /* COAP_ENABLE_ENCRYPTION_SUPPORT == 1 */
+    /* the payload stays encrypted and cannot be inspected */
+    return ENCRYPTED_MALWARE;
+#endif /* COAP_ENABLE_ENCRYPTION_SUPPORT == 1 */
+  }
+#endif /* COAP_ENABLE_PAYLOAD_INSPECTION == 1 */
+
+  return NO_ERROR;
+}
+/*---------------------------------------------------------------------------*/
 /*- REST Engine API ---------------------------------------------------------*/
 /*---------------------------------------------------------------------------*/
 int
@@ -1401,88 +1659,107 @@ coap_set_header_retransmission_counter(void *packet, uint8_t value)
   return 1;
 }
 /*---------------------------------------------------------------------------*/
-int
-coap_calculate_hmac(uint8_t *hmac, uint8_t *data, size_t data_len)
+/*
+ * HMAC according to RFC 2104:
+ *
+ * SHA256(K XOR opad, SHA256(K XOR ipad, text))
+ *
+ * The SHA-256 states after the K XOR ipad and K XOR opad blocks only
+ * depend on the key, so they are computed once per client identity.
+ */
+static struct {
+  sha_256_context_t inner;
+  sha_256_context_t outer;
+  uint8_t initialized;
+} hmac_contexts[sizeof(presharedkeys) / sizeof(presharedkeys[0])];
+/*---------------------------------------------------------------------------*/
+static void
+hmac_start(sha_256_context_t *ctx, uint8_t client_identity)
 {
-  uint8_t *psk = presharedkeys[COAP_DEFAULT_CLIENT_IDENTITY];
-  uint8_t psk_len = presharedkeys_len[COAP_DEFAULT_CLIENT_IDENTITY];
+  uint8_t key_block[SHA_256_BLOCK_SIZE];
+  uint8_t *psk = presharedkeys[client_identity];
+  uint8_t psk_len = presharedkeys_len[client_identity];
+  uint8_t i;
+
+  if(!hmac_contexts[client_identity].initialized) {
+    memset(key_block, 0, sizeof(key_block));
+    if(psk_len > SHA_256_BLOCK_SIZE) {
+      // if psk is longer than 64 bytes use K=SHA256(psk)
+      SHA_256.init(ctx);
+      SHA_256.update(ctx, psk, psk_len);
+      SHA_256.finalize(ctx, key_block);
+    } else {
+      memcpy(key_block, psk, psk_len);
+    }
 
-  PRINTF("Input data for HMAC: ");
-  for (uint8_t i = 0; i < data_len; ++i){
-    PRINTF("%02x ", data[i]);
-  }
-  PRINTF("\b\n");
+    // ipad is the byte 0x36 repeated 64 times
+    for (i = 0; i < SHA_256_BLOCK_SIZE; ++i) {
+      key_block[i] ^= 0x36;
+    }
+    SHA_256.init(&hmac_contexts[client_identity].inner);
+    SHA_256.update(&hmac_contexts[client_identity].inner, key_block, SHA_256_BLOCK_SIZE);
 
-  // Enable crypto processor
-  if (!CRYPTO_IS_ENABLED())
-    crypto_init();
-  static uint8_t error_code = CRYPTO_SUCCESS;
-  static sha256_state_t context;
-
-  /*
-   * HMAC implementation according to RFC 2104
-   */
-  uint8_t k_ipad[65];    // inner padding - key XORd with ipad
-  uint8_t k_opad[65];    // outer padding - key XORd with opad
-  uint8_t tk[32];
-
-  // if psk is longer than 64 bytes reset it to psk=SHA256(psk)
-  if (psk_len > 64) {
-    static sha256_state_t tctx;
-
-    error_code |= sha256_init(&tctx);
-    error_code |= sha256_process(&tctx, psk, psk_len);
-    error_code |= sha256_done(&tctx, tk);
-
-    memmove(psk, tk, sizeof(tk));
-    psk_len = 32;
-  }
-
-  /*
-   * the HMAC_SHA256 transform looks like:
-   *
-   * SHA256(K XOR opad, SHA256(K XOR ipad, text))
-   *
-   * where K is an n byte psk
-   * ipad is the byte 0x36 repeated 64 times
-   * opad is the byte 0x5c repeated 64 times
-   * and text is the data being protected
-   */
-
-  // start out by storing key in pads
-  bzero(k_ipad, sizeof k_ipad);
-  bzero(k_opad, sizeof k_opad);
-  bcopy(psk, k_ipad, psk_len);
-  bcopy(psk, k_opad, psk_len);
-
-  // XOR psk with ipad and opad values
-  for (uint8_t i = 0; i < 64; ++i) {
-    k_ipad[i] ^= 0x36;
-    k_opad[i] ^= 0x5c;
-  }
-
-  // perform inner SHA256
-  error_code |= sha256_init(&context);                          // init context for 1st pass
-  error_code |= sha256_process(&context, k_ipad, 64);           // start with inner pad
-  error_code |= sha256_process(&context, data, (uint32_t) data_len);       // then text of datagram
-  error_code |= sha256_done(&context, hmac);                    // finish up 1st pass
-
-  // perform outer SHA256
-  error_code |= sha256_init(&context);                          // init context for 2nd pass
-  error_code |= sha256_process(&context, k_opad, 64);           // start with outer pad
-  error_code |= sha256_process(&context, hmac, 32);             // then results of 1st hash
-  error_code |= sha256_done(&context, hmac);                    // finish up 2nd pass
-
-  if (error_code != CRYPTO_SUCCESS) {
-    PRINTF("HMAC calculation failed!");
-    return 0;
+    // opad is the byte 0x5c repeated 64 times
+    for (i = 0; i < SHA_256_BLOCK_SIZE; ++i) {
+      key_block[i] ^= 0x36 ^ 0x5c;
+    }
+    SHA_256.init(&hmac_contexts[client_identity].outer);
+    SHA_256.update(&hmac_contexts[client_identity].outer, key_block, SHA_256_BLOCK_SIZE);
+
+    hmac_contexts[client_identity].initialized = 1;
   }
 
+  memcpy(ctx, &hmac_contexts[client_identity].inner, sizeof(sha_256_context_t));
+}
+/*---------------------------------------------------------------------------*/
+static void
+hmac_finish(sha_256_context_t *ctx, uint8_t client_identity, uint8_t *hmac)
+{
+  uint8_t inner_hash[SHA_256_DIGEST_LENGTH];
+
+  SHA_256.finalize(ctx, inner_hash);
+  memcpy(ctx, &hmac_contexts[client_identity].outer, sizeof(sha_256_context_t));
+  SHA_256.update(ctx, inner_hash, sizeof(inner_hash));
+  SHA_256.finalize(ctx, hmac);
+
   PRINTF("Calculated HMAC: ");
-  for (uint8_t i = 0; i < 32; ++i){
+  for (uint8_t i = 0; i < SHA_256_DIGEST_LENGTH; ++i){
     PRINTF("%02x ", hmac[i]);
   }
   PRINTF("\b\n");
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Calculates the HMAC of a packet without the HMAC option value, which
+ * starts at hmac_position, by hashing the parts before and after it.
+ */
+static void
+hmac_calculate_around(uint8_t *hmac, const uint8_t *packet,
+                      size_t hmac_position, size_t packet_len)
+{
+  sha_256_context_t ctx;
+  size_t after_hmac = hmac_position + COAP_HEADER_HMAC_LENGTH;
+
+  hmac_start(&ctx, COAP_DEFAULT_CLIENT_IDENTITY);
+  SHA_256.update(&ctx, packet, hmac_position);
+  SHA_256.update(&ctx, packet + after_hmac, packet_len - after_hmac);
+  hmac_finish(&ctx, COAP_DEFAULT_CLIENT_IDENTITY, hmac);
+}
+/*---------------------------------------------------------------------------*/
+int
+coap_calculate_hmac(uint8_t *hmac, uint8_t *data, size_t data_len)
+{
+  sha_256_context_t ctx;
+
+  PRINTF("Input data for HMAC: ");
+  for (size_t i = 0; i < data_len; ++i){
+    PRINTF("%02x ", data[i]);
+  }
+  PRINTF("\b\n");
+
+  hmac_start(&ctx, COAP_DEFAULT_CLIENT_IDENTITY);
+  SHA_256.update(&ctx, data, data_len);
+  hmac_finish(&ctx, COAP_DEFAULT_CLIENT_IDENTITY, hmac);
 
   return 1;
 }
@@ -1603,15 +1880,9 @@ coap_update_hmac(void *packet, uint8_t* byte_after_hmac, size_t packet_len) {
 
   uint8_t* hmac_position = byte_after_hmac - COAP_HEADER_HMAC_LENGTH;
 
-  size_t hex_all_len = packet_len - COAP_HEADER_HMAC_LENGTH;
-  uint8_t hex_all[hex_all_len];
-  size_t packet_len_before_hmac_value = hmac_position - coap_pkt->buffer;
-  size_t packet_len_after_hmac_value = packet_len - (packet_len_before_hmac_value + COAP_HEADER_HMAC_LENGTH);
-  memcpy(hex_all, coap_pkt->buffer, packet_len_before_hmac_value);
-  memcpy(hex_all + packet_len_before_hmac_value, byte_after_hmac, packet_len_after_hmac_value);
-
-  uint8_t full_hmac[32];
-  coap_calculate_hmac(full_hmac, hex_all, hex_all_len);
+  uint8_t full_hmac[SHA_256_DIGEST_LENGTH];
+  hmac_calculate_around(full_hmac, coap_pkt->buffer,
+                        hmac_position - coap_pkt->buffer, packet_len);
   memcpy(hmac_position, full_hmac, COAP_HEADER_HMAC_LENGTH);
   return 1;
 }
@@ -1722,27 +1993,14 @@ coap_enable_integrity_check_and_encrypt_payload(void *packet, uint8_t retransmis
 bool
 coap_is_valid_hmac(uint8_t *original_packet, uint32_t relative_hmac_position, size_t packet_len) {
 #if COAP_ENABLE_HMAC_SUPPORT == 1
-  if (relative_hmac_position == 0 || original_packet == NULL) {
+  if (relative_hmac_position == 0 || original_packet == NULL ||
+      relative_hmac_position + COAP_HEADER_HMAC_LENGTH > packet_len) {
     return false;
   }
 
-  uint8_t packet[packet_len];
-  uint8_t *hmac_position = packet + relative_hmac_position;
-  uint8_t *original_hmac_position = original_packet + relative_hmac_position;
-  uint8_t *byte_after_hmac = hmac_position + COAP_HEADER_HMAC_LENGTH;
-
-  memcpy(packet, original_packet, packet_len);
-
-  size_t hex_all_len = packet_len - COAP_HEADER_HMAC_LENGTH;
-  uint8_t hex_all[hex_all_len];
-  size_t packet_len_before_hmac_value = hmac_position - packet;
-  size_t packet_len_after_hmac_value = packet_len - (packet_len_before_hmac_value + COAP_HEADER_HMAC_LENGTH);
-
-  memcpy(hex_all, packet, packet_len_before_hmac_value);
-  memcpy(hex_all + packet_len_before_hmac_value, byte_after_hmac, packet_len_after_hmac_value);
-
-  coap_calculate_hmac(hmac_position, hex_all, hex_all_len);
-  uint8_t hmac_comparison = (uint8_t) memcmp(hmac_position, original_hmac_position, COAP_HEADER_HMAC_LENGTH);
+  uint8_t hmac[SHA_256_DIGEST_LENGTH];
+  hmac_calculate_around(hmac, original_packet, relative_hmac_position, packet_len);
+  uint8_t hmac_comparison = (uint8_t) memcmp(hmac, original_packet + relative_hmac_position, COAP_HEADER_HMAC_LENGTH);
 
   PRINTF("HMAC comparison (0 indicates the HMACs are equal): %i\n", hmac_comparison);
 
@@ -1768,6 +2026,11 @@ coap_is_malware_free(void *packet) {
     return false;
   }
 
+  if (coap_pkt->payload_len == 0) {
+    /* nothing to scan, and no payload pointer either */
+    return true;
+  }
+
   PRINTF("Payload was unencrypted or encryption successful. SCANNING...\n");
   if (strstr((const char *)coap_pkt->payload, "EICAR") != NULL) {
     PRINTF("Malware found!!! FILTER packet\n");
@@ -1781,53 +2044,78 @@ coap_is_malware_free(void *packet) {
 #endif
 }
 /*---------------------------------------------------------------------------*/
+/*
+ * The boot counter is appended to a log by persistent_counter_set()
+ * rather than rewritten in place, and only read from flash once.
+ */
+static struct persistent_counter boot_counter;
+static bool boot_counter_loaded;
+/*---------------------------------------------------------------------------*/
+static void
+load_boot_counter(void)
+{
+  int filedescriptor;
+  uint16_t value;
+  int migrated;
+
+  if(boot_counter_loaded) {
+    return;
+  }
+  boot_counter_loaded = true;
+
+  if(!persistent_counter_init(&boot_counter, COAP_BOOT_COUNTER_FILENAME,
+                              COAP_BOOT_COUNTER_SPARE_FILENAME)) {
+    /* take over the counter from the file written by earlier versions */
+    filedescriptor = cfs_open(COAP_BOOT_COUNTER_LEGACY_FILENAME, CFS_READ);
+    if(filedescriptor >= 0) {
+      migrated = 0;
+      if(cfs_read(filedescriptor, &value, sizeof(value)) == sizeof(value)) {
+        migrated = persistent_counter_set(&boot_counter, value);
+      }
+      cfs_close(filedescriptor);
+      /* keep the old file until the counter is stored, the next boot retries */
+      if(migrated) {
+        cfs_remove(COAP_BOOT_COUNTER_LEGACY_FILENAME);
+      }
+    }
+  }
+  PRINTF("Boot counter read from file system: 0x%04x, ",
+         (uint16_t)persistent_counter_get(&boot_counter));
+}
+/*---------------------------------------------------------------------------*/
 uint16_t
 coap_read_persistent_boot_counter(bool disable_caching) {
-  static uint16_t boot_counter = 0x0000;
   static uint16_t cache_read_counter = 0;
 
-  if (disable_caching || cache_read_counter == 0) {
-    int filedescriptor;
-    uint8_t buf[sizeof(uint16_t)];
+  load_boot_counter();
 
-    filedescriptor = cfs_open(COAP_BOOT_COUNTER_FILENAME, CFS_READ);
-    if (filedescriptor >= 0) {
-      cfs_seek(filedescriptor, 0, CFS_SEEK_SET);
-      cfs_read(filedescriptor, buf, sizeof(buf));
-      cfs_close(filedescriptor);
-      memcpy(&boot_counter, buf, sizeof(uint16_t));
-    }
-
-    PRINTF("Boot counter read from file system: 0x%04x, ", boot_counter);
+  if (disable_caching) {
     cache_read_counter = 0;
-  } else if (cache_read_counter == COAP_MAX_BOOT_COUNTER_CACHE_READS) {
-    boot_counter++;
-    coap_write_persistent_boot_counter(boot_counter);
+  } else if (++cache_read_counter == COAP_MAX_BOOT_COUNTER_CACHE_READS) {
+    coap_write_persistent_boot_counter(
+      (uint16_t)(persistent_counter_get(&boot_counter) + 1));
     PRINTF("\b\b (auto-increment), ");
     cache_read_counter = 0;
   }
 
-  if (!disable_caching) {
-    cache_read_counter++;
-  }
-  return boot_counter;
+  return (uint16_t)persistent_counter_get(&boot_counter);
 }
 /*---------------------------------------------------------------------------*/
 int
 coap_write_persistent_boot_counter(uint16_t value) {
+  uint32_t stored;
+  uint32_t next;
+
   PRINTF("Boot counter to write to file system: 0x%04x, ", value);
 
-  int filedescriptor;
-  uint8_t buf[sizeof(uint16_t)];
-  memcpy(buf, &value, sizeof(uint16_t));
+  load_boot_counter();
 
-  cfs_remove(COAP_BOOT_COUNTER_FILENAME);
-  filedescriptor = cfs_open(COAP_BOOT_COUNTER_FILENAME, CFS_WRITE);
-  if(filedescriptor >= 0) {
-    cfs_seek(filedescriptor, 0, CFS_SEEK_SET);
-    cfs_write(filedescriptor, buf, sizeof(buf));
-    cfs_close(filedescriptor);
+  /* the stored counter keeps counting where the 16-bit one wraps around */
+  stored = persistent_counter_get(&boot_counter);
+  next = (stored & 0xFFFF0000UL) | value;
+  if(next < stored) {
+    next += 0x10000UL;
   }
-  return 1;
+  return persistent_counter_set(&boot_counter, next);
 }
 /*---------------------------------------------------------------------------*/
@@ -144,6 +144,20 @@ typedef struct {
   uint8_t encr_alg;
 } coap_packet_t;
 
+/* fields read by coap_scan_message() without modifying the message */
+typedef struct {
+  uint8_t type;
+  uint8_t code;
+  uint16_t mid;
+  uint8_t client_identity;
+  uint16_t boot_counter;
+  uint8_t retransmission_counter;
+  uint16_t hmac_position; /* offset of the HMAC value, 0 if there is none */
+  uint8_t encr_alg;
+  uint16_t payload_offset;
+  uint16_t payload_len;
+} coap_scan_t;
+
 /* option format serialization */
 #define COAP_SERIALIZE_INT_OPTION(number, field, text) \
   if(((number) >= COAP_OPTION_EXPERIMENTAL && coap_pkt->field != 0x00) || (!((number) >= COAP_OPTION_EXPERIMENTAL) && IS_OPTION(coap_pkt, number))) { \
@@ -209,6 +223,10 @@ void coap_send_message_with_counter(uip_ipaddr_t *addr, uint16_t port, uint8_t *
                        uint16_t length, uint8_t counter);
 coap_status_t coap_parse_message(void *request, uint8_t *data,
                                  uint16_t data_len);
+coap_status_t coap_scan_message(coap_scan_t *scan, const uint8_t *data,
+                                uint16_t data_len);
+coap_status_t coap_inspect_message(coap_scan_t *scan, const uint8_t *data,
+                                   uint16_t data_len);
 
 int coap_get_query_variable(void *packet, const char *name,
                             const char **output);
@@ -127,6 +127,9 @@ typedef enum {
 /*---------------------------------------------------------------------------*/
 #define INCREMENT_MID(conn)   (conn)->mid_counter += 2
 #define MQTT_STRING_LENGTH(s) (((s)->length) == 0 ? 0 : (MQTT_STRING_LEN_SIZE + (s)->length))
+#define PUBLISH_QOS(fhdr)     (((fhdr) >> 1) & 0x03)
+/* The publish the publish protothread is writing */
+#define CURRENT_INFLIGHT(conn) (&(conn)->inflight[(conn)->inflight_pos])
 /*---------------------------------------------------------------------------*/
 /* Protothread send macros */
 #define PT_MQTT_WRITE_BYTES(conn, data, len)                                   \
@@ -214,6 +217,14 @@ reset_defaults(struct mqtt_connection *conn)
 
   reset_packet(&conn->in_packet);
   conn->out_buffer_sent = 0;
+
+  /* The session is clean, the broker forgets what was in flight */
+  memset(conn->inflight, 0, sizeof(conn->inflight));
+  conn->inflight_used = 0;
+  conn->flush_pending = 0;
+  conn->ack_head = 0;
+  conn->ack_count = 0;
+  memset(conn->qos2_received, 0, sizeof(conn->qos2_received));
 }
 /*---------------------------------------------------------------------------*/
 static void
@@ -224,6 +235,7 @@ abort_connection(struct mqtt_connection *conn)
 
   /* Reset outgoing packet */
   memset(&conn->out_packet, 0, sizeof(conn->out_packet));
+  ctimer_stop(&conn->retransmit_timer);
 
   tcp_socket_close(&conn->socket);
   tcp_socket_unregister(&conn->socket);
@@ -380,6 +392,119 @@ reset_packet(struct mqtt_in_packet *packet)
   packet->remaining_multiplier = 1;
 }
 /*---------------------------------------------------------------------------*/
+static void
+post_flush(struct mqtt_connection *conn)
+{
+  if(!conn->flush_pending &&
+     process_post(&mqtt_process, mqtt_do_publish_event, conn) ==
+     PROCESS_ERR_OK) {
+    conn->flush_pending = 1;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+queue_ack(struct mqtt_connection *conn, uint8_t fhdr, uint16_t mid)
+{
+  struct mqtt_ack *ack;
+
+  /* The broker sends its message again if we cannot acknowledge it now */
+  if(conn->ack_count == MQTT_ACK_QUEUE_SIZE) {
+    PRINTF("MQTT - Ack queue full, dropping ack for %u\n", mid);
+    return;
+  }
+
+  ack = &conn->acks[(conn->ack_head + conn->ack_count) % MQTT_ACK_QUEUE_SIZE];
+  ack->fhdr = fhdr;
+  ack->mid = mid;
+  conn->ack_count++;
+  post_flush(conn);
+}
+/*---------------------------------------------------------------------------*/
+static void
+write_ack_out(struct mqtt_connection *conn, uint8_t fhdr, uint16_t mid)
+{
+  conn->ack_out[0] = fhdr;
+  conn->ack_out[1] = MQTT_MID_SIZE;
+  conn->ack_out[2] = mid >> 8;
+  conn->ack_out[3] = mid & 0x00FF;
+}
+/*---------------------------------------------------------------------------*/
+static struct mqtt_inflight *
+find_inflight(struct mqtt_connection *conn, uint16_t mid)
+{
+  int i;
+
+  for(i = 0; i < MQTT_INFLIGHT_WINDOW; i++) {
+    if(conn->inflight[i].state != MQTT_INFLIGHT_FREE &&
+       conn->inflight[i].mid == mid) {
+      return &conn->inflight[i];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+free_inflight(struct mqtt_connection *conn, struct mqtt_inflight *entry)
+{
+  entry->state = MQTT_INFLIGHT_FREE;
+  conn->inflight_used--;
+}
+/*---------------------------------------------------------------------------*/
+static void
+retransmit_callback(void *ptr)
+{
+  struct mqtt_connection *conn = ptr;
+  struct mqtt_inflight *entry;
+  clock_time_t now;
+  clock_time_t age;
+  clock_time_t next;
+  uint8_t waiting;
+  int i;
+
+  now = clock_time();
+  next = MQTT_RETRANSMIT_TIMEOUT;
+  waiting = 0;
+  for(i = 0; i < MQTT_INFLIGHT_WINDOW; i++) {
+    entry = &conn->inflight[i];
+    if(entry->state != MQTT_INFLIGHT_WAIT_PUBACK &&
+       entry->state != MQTT_INFLIGHT_WAIT_PUBREC &&
+       entry->state != MQTT_INFLIGHT_WAIT_PUBCOMP) {
+      continue;
+    }
+
+    age = now - entry->sent;
+    if(age >= MQTT_RETRANSMIT_TIMEOUT) {
+      PRINTF("MQTT - Resending message %u\n", entry->mid);
+      if(entry->state == MQTT_INFLIGHT_WAIT_PUBCOMP) {
+        entry->state = MQTT_INFLIGHT_QUEUED_PUBREL;
+      } else {
+        entry->state = MQTT_INFLIGHT_QUEUED;
+        entry->dup = 1;
+      }
+      post_flush(conn);
+    } else {
+      next = MIN(next, MQTT_RETRANSMIT_TIMEOUT - age);
+      waiting = 1;
+    }
+  }
+
+  if(waiting) {
+    ctimer_set(&conn->retransmit_timer, next, retransmit_callback, conn);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+wait_for_ack(struct mqtt_connection *conn, struct mqtt_inflight *entry,
+             mqtt_inflight_state_t state)
+{
+  entry->state = state;
+  entry->sent = clock_time();
+  if(ctimer_expired(&conn->retransmit_timer)) {
+    ctimer_set(&conn->retransmit_timer, MQTT_RETRANSMIT_TIMEOUT,
+               retransmit_callback, conn);
+  }
+}
+/*---------------------------------------------------------------------------*/
 static
 PT_THREAD(connect_pt(struct pt *pt, struct mqtt_connection *conn))
 {
@@ -417,16 +542,16 @@ PT_THREAD(connect_pt(struct pt *pt, struct mqtt_connection *conn))
   PT_MQTT_WRITE_BYTE(conn, conn->connect_vhdr_flags);
   PT_MQTT_WRITE_BYTE(conn, (conn->keep_alive >> 8));
   PT_MQTT_WRITE_BYTE(conn, (conn->keep_alive & 0x00FF));
-  PT_MQTT_WRITE_BYTE(conn, conn->client_id.length << 8);
+  PT_MQTT_WRITE_BYTE(conn, conn->client_id.length >> 8);
   PT_MQTT_WRITE_BYTE(conn, conn->client_id.length & 0x00FF);
   PT_MQTT_WRITE_BYTES(conn, (uint8_t *)conn->client_id.string,
                       conn->client_id.length);
   if(conn->connect_vhdr_flags & MQTT_VHDR_WILL_FLAG) {
-    PT_MQTT_WRITE_BYTE(conn, conn->will.topic.length << 8);
+    PT_MQTT_WRITE_BYTE(conn, conn->will.topic.length >> 8);
     PT_MQTT_WRITE_BYTE(conn, conn->will.topic.length & 0x00FF);
     PT_MQTT_WRITE_BYTES(conn, (uint8_t *)conn->will.topic.string,
                         conn->will.topic.length);
-    PT_MQTT_WRITE_BYTE(conn, conn->will.message.length << 8);
+    PT_MQTT_WRITE_BYTE(conn, conn->will.message.length >> 8);
     PT_MQTT_WRITE_BYTE(conn, conn->will.message.length & 0x00FF);
     PT_MQTT_WRITE_BYTES(conn, (uint8_t *)conn->will.message.string,
                         conn->will.message.length);
@@ -437,14 +562,14 @@ PT_THREAD(connect_pt(struct pt *pt, struct mqtt_connection *conn))
         conn->will.message.length);
   }
   if(conn->connect_vhdr_flags & MQTT_VHDR_USERNAME_FLAG) {
-    PT_MQTT_WRITE_BYTE(conn, conn->credentials.username.length << 8);
+    PT_MQTT_WRITE_BYTE(conn, conn->credentials.username.length >> 8);
     PT_MQTT_WRITE_BYTE(conn, conn->credentials.username.length & 0x00FF);
     PT_MQTT_WRITE_BYTES(conn,
                         (uint8_t *)conn->credentials.username.string,
                         conn->credentials.username.length);
   }
   if(conn->connect_vhdr_flags & MQTT_VHDR_PASSWORD_FLAG) {
-    PT_MQTT_WRITE_BYTE(conn, conn->credentials.password.length << 8);
+    PT_MQTT_WRITE_BYTE(conn, conn->credentials.password.length >> 8);
     PT_MQTT_WRITE_BYTE(conn, conn->credentials.password.length & 0x00FF);
     PT_MQTT_WRITE_BYTES(conn,
                         (uint8_t *)conn->credentials.password.string,
@@ -508,6 +633,9 @@ PT_THREAD(subscribe_pt(struct pt *pt, struct mqtt_connection *conn))
 {
   PT_BEGIN(pt);
 
+  /* Publishes may still be in flight */
+  PT_WAIT_UNTIL(pt, conn->out_buffer_sent);
+
   DBG("MQTT - Sending subscribe message! topic %s topic_length %i\n",
       conn->out_packet.topic,
       conn->out_packet.topic_length);
@@ -535,7 +663,7 @@ PT_THREAD(subscribe_pt(struct pt *pt, struct mqtt_connection *conn))
                       conn->out_packet.remaining_length_enc,
                       conn->out_packet.remaining_length_enc_bytes);
   /* Write Variable Header */
-  PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.mid << 8));
+  PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.mid >> 8));
   PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.mid & 0x00FF));
   /* Write Payload */
   PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.topic_length >> 8));
@@ -571,6 +699,9 @@ PT_THREAD(unsubscribe_pt(struct pt *pt, struct mqtt_connection *conn))
 {
   PT_BEGIN(pt);
 
+  /* Publishes may still be in flight */
+  PT_WAIT_UNTIL(pt, conn->out_buffer_sent);
+
   DBG("MQTT - Sending unsubscribe message on topic %s topic_length %i\n",
       conn->out_packet.topic,
       conn->out_packet.topic_length);
@@ -597,7 +728,7 @@ PT_THREAD(unsubscribe_pt(struct pt *pt, struct mqtt_connection *conn))
   PT_MQTT_WRITE_BYTES(conn, (uint8_t *)conn->out_packet.remaining_length_enc,
                       conn->out_packet.remaining_length_enc_bytes);
   /* Write Variable Header */
-  PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.mid << 8));
+  PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.mid >> 8));
   PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.mid & 0x00FF));
   /* Write Payload */
   PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.topic_length >> 8));
@@ -628,88 +759,128 @@ PT_THREAD(unsubscribe_pt(struct pt *pt, struct mqtt_connection *conn))
   PT_END(pt);
 }
 /*---------------------------------------------------------------------------*/
+/*
+ * Writes the queued acknowledgements, PUBRELs and publishes into as few TCP
+ * segments as they fit, and leaves the publishes awaiting their PUBACK or
+ * PUBREC in the inflight table.
+ */
 static
 PT_THREAD(publish_pt(struct pt *pt, struct mqtt_connection *conn))
 {
+  uint16_t chunk_length;
+
   PT_BEGIN(pt);
 
-  DBG("MQTT - Sending publish message! topic %s topic_length %i\n",
-      conn->out_packet.topic,
-      conn->out_packet.topic_length);
+  /* Earlier packets may still be in flight */
+  PT_WAIT_UNTIL(pt, conn->out_buffer_sent);
+  conn->flush_pending = 0;
+
   DBG("MQTT - Buffer space is %i \n",
       &conn->out_buffer[MQTT_TCP_OUTPUT_BUFF_SIZE] - conn->out_buffer_ptr);
 
-  /* Set up FHDR */
-  conn->out_packet.fhdr = MQTT_FHDR_MSG_TYPE_PUBLISH |
-    conn->out_packet.qos << 1;
-  if(conn->out_packet.retain == MQTT_RETAIN_ON) {
-    conn->out_packet.fhdr |= MQTT_FHDR_RETAIN_FLAG;
-  }
-  conn->out_packet.remaining_length = MQTT_STRING_LEN_SIZE +
-    conn->out_packet.topic_length +
-    conn->out_packet.payload_size;
-  if(conn->out_packet.qos > MQTT_QOS_LEVEL_0) {
-    conn->out_packet.remaining_length += MQTT_MID_SIZE;
-  }
-  encode_remaining_length(conn->out_packet.remaining_length_enc,
-                          &conn->out_packet.remaining_length_enc_bytes,
-                          conn->out_packet.remaining_length);
-  if(conn->out_packet.remaining_length_enc_bytes > 4) {
-    call_event(conn, MQTT_EVENT_PROTOCOL_ERROR, NULL);
-    PRINTF("MQTT - Error, remaining length > 4 bytes\n");
-    PT_EXIT(pt);
+  while(conn->ack_count > 0) {
+    write_ack_out(conn, conn->acks[conn->ack_head].fhdr,
+                  conn->acks[conn->ack_head].mid);
+    PT_MQTT_WRITE_BYTES(conn, conn->ack_out, sizeof(conn->ack_out));
+    conn->ack_head = (conn->ack_head + 1) % MQTT_ACK_QUEUE_SIZE;
+    conn->ack_count--;
   }
 
-  /* Write Fixed Header */
-  PT_MQTT_WRITE_BYTE(conn, conn->out_packet.fhdr);
-  PT_MQTT_WRITE_BYTES(conn, (uint8_t *)conn->out_packet.remaining_length_enc,
-                      conn->out_packet.remaining_length_enc_bytes);
-  /* Write Variable Header */
-  PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.topic_length >> 8));
-  PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.topic_length & 0x00FF));
-  PT_MQTT_WRITE_BYTES(conn, (uint8_t *)conn->out_packet.topic,
-                      conn->out_packet.topic_length);
-  if(conn->out_packet.qos > MQTT_QOS_LEVEL_0) {
-    PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.mid << 8));
-    PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.mid & 0x00FF));
-  }
-  /* Write Payload */
-  PT_MQTT_WRITE_BYTES(conn,
-                      conn->out_packet.payload,
-                      conn->out_packet.payload_size);
+  for(conn->inflight_pos = 0; conn->inflight_pos < MQTT_INFLIGHT_WINDOW;
+      conn->inflight_pos++) {
+    if(CURRENT_INFLIGHT(conn)->state == MQTT_INFLIGHT_QUEUED_PUBREL) {
+      write_ack_out(conn, MQTT_FHDR_MSG_TYPE_PUBREL | MQTT_FHDR_QOS_LEVEL_1,
+                    CURRENT_INFLIGHT(conn)->mid);
+      PT_MQTT_WRITE_BYTES(conn, conn->ack_out, sizeof(conn->ack_out));
+      wait_for_ack(conn, CURRENT_INFLIGHT(conn), MQTT_INFLIGHT_WAIT_PUBCOMP);
+      continue;
+    }
+    if(CURRENT_INFLIGHT(conn)->state != MQTT_INFLIGHT_QUEUED) {
+      continue;
+    }
 
-  send_out_buffer(conn);
-  timer_set(&conn->t, RESPONSE_WAIT_TIMEOUT);
+    DBG("MQTT - Sending publish message! topic %s topic_length %i\n",
+        CURRENT_INFLIGHT(conn)->topic,
+        CURRENT_INFLIGHT(conn)->topic_length);
 
-  /*
-   * If QoS is zero then wait until the message has been sent, since there is
-   * no ACK to wait for.
-   *
-   * Also notify the app will not be notified via PUBACK or PUBCOMP
-   */
-  if(conn->out_packet.qos == 0) {
-    process_post(conn->app_process, mqtt_update_event, NULL);
-  } else if(conn->out_packet.qos == 1) {
-    /* Wait for PUBACK */
-    reset_packet(&conn->in_packet);
-    PT_WAIT_UNTIL(pt, conn->out_packet.qos_state == MQTT_QOS_STATE_GOT_ACK ||
-                  timer_expired(&conn->t));
-    if(timer_expired(&conn->t)) {
-      DBG("Timeout waiting for PUBACK\n");
+    /* Set up FHDR */
+    conn->out_packet.fhdr = MQTT_FHDR_MSG_TYPE_PUBLISH |
+      CURRENT_INFLIGHT(conn)->qos << 1;
+    if(CURRENT_INFLIGHT(conn)->retain == MQTT_RETAIN_ON) {
+      conn->out_packet.fhdr |= MQTT_FHDR_RETAIN_FLAG;
     }
-    if(conn->in_packet.mid != conn->out_packet.mid) {
-      DBG("MQTT - Warning, got PUBACK with none matching MID. Currently there "
-          "is no support for several concurrent PUBLISH messages.\n");
+    if(CURRENT_INFLIGHT(conn)->dup) {
+      conn->out_packet.fhdr |= MQTT_FHDR_DUP_FLAG;
+    }
+    conn->out_packet.remaining_length = MQTT_STRING_LEN_SIZE +
+      CURRENT_INFLIGHT(conn)->topic_length +
+      CURRENT_INFLIGHT(conn)->payload_size;
+    if(CURRENT_INFLIGHT(conn)->qos > MQTT_QOS_LEVEL_0) {
+      conn->out_packet.remaining_length += MQTT_MID_SIZE;
+    }
+    encode_remaining_length(conn->out_packet.remaining_length_enc,
+                            &conn->out_packet.remaining_length_enc_bytes,
+                            conn->out_packet.remaining_length);
+    if(conn->out_packet.remaining_length_enc_bytes > 4) {
+      free_inflight(conn, CURRENT_INFLIGHT(conn));
+      call_event(conn, MQTT_EVENT_PROTOCOL_ERROR, NULL);
+      PRINTF("MQTT - Error, remaining length > 4 bytes\n");
+      continue;
     }
-  } else if(conn->out_packet.qos == 2) {
-    DBG("MQTT - QoS not implemented yet.\n");
-    /* Should wait for PUBREC, send PUBREL and then wait for PUBCOMP */
-  }
 
-  reset_packet(&conn->in_packet);
+    /* Write Fixed Header */
+    PT_MQTT_WRITE_BYTE(conn, conn->out_packet.fhdr);
+    PT_MQTT_WRITE_BYTES(conn, (uint8_t *)conn->out_packet.remaining_length_enc,
+                        conn->out_packet.remaining_length_enc_bytes);
+    /* Write Variable Header */
+    PT_MQTT_WRITE_BYTE(conn, (CURRENT_INFLIGHT(conn)->topic_length >> 8));
+    PT_MQTT_WRITE_BYTE(conn, (CURRENT_INFLIGHT(conn)->topic_length & 0x00FF));
+    PT_MQTT_WRITE_BYTES(conn, (uint8_t *)CURRENT_INFLIGHT(conn)->topic,
+                        CURRENT_INFLIGHT(conn)->topic_length);
+    if(CURRENT_INFLIGHT(conn)->qos > MQTT_QOS_LEVEL_0) {
+      PT_MQTT_WRITE_BYTE(conn, (CURRENT_INFLIGHT(conn)->mid >> 8));
+      PT_MQTT_WRITE_BYTE(conn, (CURRENT_INFLIGHT(conn)->mid & 0x00FF));
+    }
+    /* Write Payload */
+    if(CURRENT_INFLIGHT(conn)->writer == NULL) {
+      PT_MQTT_WRITE_BYTES(conn,
+                          CURRENT_INFLIGHT(conn)->payload,
+                          CURRENT_INFLIGHT(conn)->payload_size);
+    } else {
+      /* The writer fills the output buffer itself, one chunk per segment */
+      conn->out_write_pos = 0;
+      while(conn->out_write_pos < CURRENT_INFLIGHT(conn)->payload_size) {
+        if(conn->out_buffer_ptr == &conn->out_buffer[MQTT_TCP_OUTPUT_BUFF_SIZE]) {
+          send_out_buffer(conn);
+          PT_WAIT_UNTIL(pt, conn->out_buffer_sent);
+        }
+        chunk_length =
+          MIN(&conn->out_buffer[MQTT_TCP_OUTPUT_BUFF_SIZE] - conn->out_buffer_ptr,
+              CURRENT_INFLIGHT(conn)->payload_size - conn->out_write_pos);
+        CURRENT_INFLIGHT(conn)->writer(conn, CURRENT_INFLIGHT(conn)->writer_ptr,
+                                       conn->out_write_pos,
+                                       conn->out_buffer_ptr, chunk_length);
+        conn->out_buffer_ptr += chunk_length;
+        conn->out_write_pos += chunk_length;
+      }
+      conn->out_write_pos = 0;
+    }
 
-  /* This is clear after the entire transaction is complete */
-  conn->out_queue_full = 0;
+    /*
+     * There is no ACK to wait for with QoS 0, the app may reuse the slot
+     * right away.
+     */
+    if(CURRENT_INFLIGHT(conn)->qos == MQTT_QOS_LEVEL_0) {
+      free_inflight(conn, CURRENT_INFLIGHT(conn));
+      process_post(conn->app_process, mqtt_update_event, NULL);
+    } else if(CURRENT_INFLIGHT(conn)->qos == MQTT_QOS_LEVEL_1) {
+      wait_for_ack(conn, CURRENT_INFLIGHT(conn), MQTT_INFLIGHT_WAIT_PUBACK);
+    } else {
+      wait_for_ack(conn, CURRENT_INFLIGHT(conn), MQTT_INFLIGHT_WAIT_PUBREC);
+    }
+  }
+
+  send_out_buffer(conn);
 
   DBG("MQTT - Publish Enqueued\n");
 
@@ -825,29 +996,136 @@ handle_unsuback(struct mqtt_connection *conn)
 static void
 handle_puback(struct mqtt_connection *conn)
 {
+  struct mqtt_inflight *entry;
+
   DBG("MQTT - Got PUBACK\n");
 
-  conn->out_packet.qos_state = MQTT_QOS_STATE_GOT_ACK;
   conn->in_packet.mid = (conn->in_packet.payload[0] << 8) |
     (conn->in_packet.payload[1]);
 
+  entry = find_inflight(conn, conn->in_packet.mid);
+  if(entry == NULL || entry->state != MQTT_INFLIGHT_WAIT_PUBACK) {
+    DBG("MQTT - Got PUBACK for unknown message %u\n", conn->in_packet.mid);
+    return;
+  }
+  free_inflight(conn, entry);
+
   call_event(conn, MQTT_EVENT_PUBACK, &conn->in_packet.mid);
 }
 /*---------------------------------------------------------------------------*/
 static void
+handle_pubrec(struct mqtt_connection *conn)
+{
+  struct mqtt_inflight *entry;
+
+  DBG("MQTT - Got PUBREC\n");
+
+  conn->in_packet.mid = (conn->in_packet.payload[0] << 8) |
+    (conn->in_packet.payload[1]);
+
+  entry = find_inflight(conn, conn->in_packet.mid);
+  if(entry == NULL || (entry->state != MQTT_INFLIGHT_WAIT_PUBREC &&
+                       entry->state != MQTT_INFLIGHT_WAIT_PUBCOMP)) {
+    DBG("MQTT - Got PUBREC for unknown message %u\n", conn->in_packet.mid);
+    return;
+  }
+  entry->state = MQTT_INFLIGHT_QUEUED_PUBREL;
+  post_flush(conn);
+}
+/*---------------------------------------------------------------------------*/
+static void
+handle_pubcomp(struct mqtt_connection *conn)
+{
+  struct mqtt_inflight *entry;
+
+  DBG("MQTT - Got PUBCOMP\n");
+
+  conn->in_packet.mid = (conn->in_packet.payload[0] << 8) |
+    (conn->in_packet.payload[1]);
+
+  entry = find_inflight(conn, conn->in_packet.mid);
+  if(entry == NULL || entry->state != MQTT_INFLIGHT_WAIT_PUBCOMP) {
+    DBG("MQTT - Got PUBCOMP for unknown message %u\n", conn->in_packet.mid);
+    return;
+  }
+  free_inflight(conn, entry);
+
+  call_event(conn, MQTT_EVENT_PUBCOMP, &conn->in_packet.mid);
+}
+/*---------------------------------------------------------------------------*/
+static void
+handle_pubrel(struct mqtt_connection *conn)
+{
+  int i;
+
+  DBG("MQTT - Got PUBREL\n");
+
+  conn->in_packet.mid = (conn->in_packet.payload[0] << 8) |
+    (conn->in_packet.payload[1]);
+
+  /* The broker will not send this QoS 2 message again */
+  for(i = 0; i < MQTT_QOS2_RECEIVE_NUM; i++) {
+    if(conn->qos2_received[i] == conn->in_packet.mid) {
+      conn->qos2_received[i] = 0;
+    }
+  }
+
+  queue_ack(conn, MQTT_FHDR_MSG_TYPE_PUBCOMP, conn->in_packet.mid);
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Decides whether an incoming PUBLISH goes to the application once its
+ * variable header is read. A QoS 2 message is delivered once, and its MID
+ * kept until the broker sends PUBREL.
+ */
+static void
+accept_publish(struct mqtt_connection *conn)
+{
+  int free_slot;
+  int i;
+
+  conn->in_packet.deliver = 1;
+  conn->in_packet.acknowledge =
+    PUBLISH_QOS(conn->in_packet.fhdr) > MQTT_QOS_LEVEL_0;
+  if(PUBLISH_QOS(conn->in_packet.fhdr) != MQTT_QOS_LEVEL_2) {
+    return;
+  }
+
+  free_slot = -1;
+  for(i = 0; i < MQTT_QOS2_RECEIVE_NUM; i++) {
+    if(conn->qos2_received[i] == conn->in_packet.mid) {
+      DBG("MQTT - Repeated QoS 2 PUBLISH %u\n", conn->in_packet.mid);
+      conn->in_packet.deliver = 0;
+      return;
+    }
+    if(conn->qos2_received[i] == 0) {
+      free_slot = i;
+    }
+  }
+
+  if(free_slot < 0) {
+    /* Without PUBREC, the broker sends the message again later */
+    PRINTF("MQTT - No room for QoS 2 PUBLISH %u\n", conn->in_packet.mid);
+    conn->in_packet.deliver = 0;
+    conn->in_packet.acknowledge = 0;
+    return;
+  }
+  conn->qos2_received[free_slot] = conn->in_packet.mid;
+}
+/*---------------------------------------------------------------------------*/
+static void
 handle_publish(struct mqtt_connection *conn)
 {
   DBG("MQTT - Got PUBLISH, called once per manageable chunk of message.\n");
   DBG("MQTT - Handling publish on topic '%s'\n", conn->in_publish_msg.topic);
 
-  DBG("MQTT - This chunk is %i bytes\n", conn->in_packet.payload_pos);
+  DBG("MQTT - This chunk is %u bytes\n",
+      conn->in_publish_msg.payload_chunk_length);
 
-  if(((conn->in_packet.fhdr & 0x09) >> 1) > 0) {
-    PRINTF("MQTT - Error, got incoming PUBLISH with QoS > 0, not supported atm!\n");
+  if(conn->in_packet.deliver) {
+    call_event(conn, MQTT_EVENT_PUBLISH, &conn->in_publish_msg);
   }
 
-  call_event(conn, MQTT_EVENT_PUBLISH, &conn->in_publish_msg);
-
   if(conn->in_publish_msg.first_chunk == 1) {
     conn->in_publish_msg.first_chunk = 0;
   }
@@ -857,9 +1135,15 @@ handle_publish(struct mqtt_connection *conn)
 
     /* Check for QoS and initiate the reply, do not rely on the data in the
      * in_packet being untouched. */
+    if(conn->in_packet.acknowledge) {
+      queue_ack(conn,
+                PUBLISH_QOS(conn->in_packet.fhdr) == MQTT_QOS_LEVEL_1 ?
+                MQTT_FHDR_MSG_TYPE_PUBACK : MQTT_FHDR_MSG_TYPE_PUBREC,
+                conn->in_packet.mid);
+    }
 
-    DBG("MQTT - (handle_publish) resetting packet.\n");
-    reset_packet(&conn->in_packet);
+    DBG("MQTT - (handle_publish) last chunk.\n");
+    conn->in_packet.packet_received = 1;
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -871,6 +1155,10 @@ parse_publish_vhdr(struct mqtt_connection *conn,
 {
   uint16_t copy_bytes;
 
+  if(*pos >= input_data_len) {
+    return;
+  }
+
   /* Read out topic length */
   if(conn->in_packet.topic_len_received == 0) {
     conn->in_packet.topic_len = (input_data_ptr[(*pos)++] << 8);
@@ -893,42 +1181,81 @@ parse_publish_vhdr(struct mqtt_connection *conn,
                      input_data_len - *pos);
     DBG("MQTT - topic_pos: %i copy_bytes: %i", conn->in_packet.topic_pos,
         copy_bytes);
-    memcpy(&conn->in_publish_msg.topic[conn->in_packet.topic_pos],
-           &input_data_ptr[*pos],
-           copy_bytes);
+    /* Keep what fits of a topic that is too long, the rest is skipped */
+    if(conn->in_packet.topic_pos < MQTT_MAX_TOPIC_LENGTH) {
+      memcpy(&conn->in_publish_msg.topic[conn->in_packet.topic_pos],
+             &input_data_ptr[*pos],
+             MIN(copy_bytes,
+                 MQTT_MAX_TOPIC_LENGTH - conn->in_packet.topic_pos));
+    }
     (*pos) += copy_bytes;
     conn->in_packet.byte_counter += copy_bytes;
     conn->in_packet.topic_pos += copy_bytes;
 
     if(conn->in_packet.topic_len - conn->in_packet.topic_pos == 0) {
-      DBG("MQTT - Got topic '%s'", conn->in_publish_msg.topic);
       conn->in_packet.topic_received = 1;
-      conn->in_publish_msg.topic[conn->in_packet.topic_pos] = '\0';
-      conn->in_publish_msg.payload_length =
-        conn->in_packet.remaining_length - conn->in_packet.topic_len - 2;
-      conn->in_publish_msg.payload_left = conn->in_publish_msg.payload_length;
+      conn->in_publish_msg.topic[MIN(conn->in_packet.topic_pos,
+                                     MQTT_MAX_TOPIC_LENGTH)] = '\0';
+      DBG("MQTT - Got topic '%s'", conn->in_publish_msg.topic);
     }
 
     /* Set this once per incomming publish message */
     conn->in_publish_msg.first_chunk = 1;
   }
+
+  if(conn->in_packet.topic_received == 0) {
+    return;
+  }
+
+  /* Read out the MID of QoS 1 and 2 messages */
+  if(PUBLISH_QOS(conn->in_packet.fhdr) > MQTT_QOS_LEVEL_0) {
+    while(conn->in_packet.mid_bytes_received < MQTT_MID_SIZE) {
+      if(*pos >= input_data_len) {
+        return;
+      }
+      conn->in_packet.mid = (conn->in_packet.mid << 8) |
+        input_data_ptr[(*pos)++];
+      conn->in_packet.byte_counter++;
+      conn->in_packet.mid_bytes_received++;
+    }
+  }
+
+  conn->in_packet.vhdr_received = 1;
+  conn->in_publish_msg.payload_length = conn->in_packet.remaining_length -
+    MQTT_STRING_LEN_SIZE - conn->in_packet.topic_len -
+    conn->in_packet.mid_bytes_received;
+  conn->in_publish_msg.payload_left = conn->in_publish_msg.payload_length;
+  conn->in_publish_msg.mid = conn->in_packet.mid;
+  accept_publish(conn);
+
+  if(conn->in_packet.topic_len > MQTT_MAX_TOPIC_LENGTH) {
+    PRINTF("MQTT - Topic of %u bytes too long, not delivering PUBLISH\n",
+           conn->in_packet.topic_len);
+    conn->in_packet.deliver = 0;
+  }
 }
 /*---------------------------------------------------------------------------*/
-static int
-tcp_input(struct tcp_socket *s,
-          void *ptr,
-          const uint8_t *input_data_ptr,
-          int input_data_len)
+/* Length of the incoming packet including its fixed header */
+static uint32_t
+in_packet_length(struct mqtt_connection *conn)
+{
+  return MQTT_FHDR_SIZE + conn->in_packet.remaining_length_bytes +
+         conn->in_packet.remaining_length;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Reads input up to the end of the current packet and handles the packet
+ * once complete. Returns the number of bytes read.
+ */
+static uint32_t
+parse_input(struct mqtt_connection *conn,
+            const uint8_t *input_data_ptr,
+            int input_data_len)
 {
-  struct mqtt_connection *conn = ptr;
   uint32_t pos = 0;
   uint32_t copy_bytes = 0;
   uint8_t byte;
 
-  if(input_data_len == 0) {
-    return 0;
-  }
-
   if(conn->in_packet.packet_received) {
     reset_packet(&conn->in_packet);
   }
@@ -943,7 +1270,7 @@ tcp_input(struct tcp_socket *s,
     DBG("MQTT - Read VHDR '%02X'\n", conn->in_packet.fhdr);
 
     if(pos >= input_data_len) {
-      return 0;
+      return pos;
     }
   }
 
@@ -951,7 +1278,7 @@ tcp_input(struct tcp_socket *s,
   if(!conn->in_packet.has_remaining_length) {
     do {
       if(pos >= input_data_len) {
-        return 0;
+        return pos;
       }
 
       byte = input_data_ptr[pos++];
@@ -962,7 +1289,7 @@ tcp_input(struct tcp_socket *s,
       if(conn->in_packet.byte_counter > 5) {
         call_event(conn, MQTT_EVENT_ERROR, NULL);
         DBG("Received more then 4 byte 'remaining lenght'.");
-        return 0;
+        return input_data_len;
       }
 
       conn->in_packet.remaining_length +=
@@ -985,31 +1312,77 @@ tcp_input(struct tcp_socket *s,
 
     PRINTF("MQTT - Error, unsupported payload size for non-PUBLISH message\n");
 
-    conn->in_packet.byte_counter += input_data_len;
-    if(conn->in_packet.byte_counter >=
-       (MQTT_FHDR_SIZE + conn->in_packet.remaining_length)) {
+    copy_bytes = MIN(input_data_len - pos,
+                     in_packet_length(conn) - conn->in_packet.byte_counter);
+    conn->in_packet.byte_counter += copy_bytes;
+    pos += copy_bytes;
+    if(conn->in_packet.byte_counter >= in_packet_length(conn)) {
       conn->in_packet.packet_received = 1;
     }
-    return 0;
+    return pos;
+  }
+
+  /*
+   * PUBLISH payloads that fit the input buffer are delivered in one piece.
+   * Larger ones are not buffered. Whatever part of the payload this segment
+   * carries goes to the application as one chunk, straight from the TCP
+   * input buffer.
+   */
+  if((conn->in_packet.fhdr & 0xF0) == MQTT_FHDR_MSG_TYPE_PUBLISH) {
+    if(conn->in_packet.vhdr_received == 0) {
+      parse_publish_vhdr(conn, &pos, input_data_ptr, input_data_len);
+      if(conn->in_packet.vhdr_received == 0) {
+        return pos;
+      }
+    }
+
+    if(conn->in_publish_msg.payload_length <= MQTT_INPUT_BUFF_SIZE) {
+      copy_bytes = MIN(input_data_len - pos,
+                       in_packet_length(conn) - conn->in_packet.byte_counter);
+      memcpy(&conn->in_packet.payload[conn->in_packet.payload_pos],
+             &input_data_ptr[pos],
+             copy_bytes);
+      conn->in_packet.payload_pos += copy_bytes;
+      conn->in_packet.byte_counter += copy_bytes;
+      pos += copy_bytes;
+
+      if(conn->in_packet.byte_counter >= in_packet_length(conn)) {
+        conn->in_publish_msg.payload_chunk = conn->in_packet.payload;
+        conn->in_publish_msg.payload_chunk_length = conn->in_packet.payload_pos;
+        conn->in_publish_msg.payload_left = 0;
+        handle_publish(conn);
+      }
+      return pos;
+    }
+
+    copy_bytes = MIN(input_data_len - pos,
+                     in_packet_length(conn) - conn->in_packet.byte_counter);
+    conn->in_publish_msg.payload_chunk = (uint8_t *)&input_data_ptr[pos];
+    conn->in_publish_msg.payload_chunk_length = copy_bytes;
+    conn->in_publish_msg.payload_left -= copy_bytes;
+    conn->in_packet.byte_counter += copy_bytes;
+    pos += copy_bytes;
+
+    /* An empty payload is delivered as one empty chunk */
+    if(copy_bytes > 0 || conn->in_publish_msg.payload_left == 0) {
+      handle_publish(conn);
+    }
+    return pos;
   }
 
   /*
-   * Supported payload, reads out both VHDR and Payload of all packets.
+   * Supported payload, reads out both VHDR and Payload of all other packets.
    *
    * Note: There will always be at least one byte left to read when we enter
    *       this loop.
    */
-  while(conn->in_packet.byte_counter <
-        (MQTT_FHDR_SIZE + conn->in_packet.remaining_length)) {
-
-    if((conn->in_packet.fhdr & 0xF0) == MQTT_FHDR_MSG_TYPE_PUBLISH &&
-       conn->in_packet.topic_received == 0) {
-      parse_publish_vhdr(conn, &pos, input_data_ptr, input_data_len);
-    }
+  while(conn->in_packet.byte_counter < in_packet_length(conn)) {
 
     /* Read in as much as we can into the packet payload */
     copy_bytes = MIN(input_data_len - pos,
                      MQTT_INPUT_BUFF_SIZE - conn->in_packet.payload_pos);
+    copy_bytes = MIN(copy_bytes,
+                     in_packet_length(conn) - conn->in_packet.byte_counter);
     DBG("- Copied %lu payload bytes\n", copy_bytes);
     memcpy(&conn->in_packet.payload[conn->in_packet.payload_pos],
            &input_data_ptr[pos],
@@ -1025,21 +1398,9 @@ tcp_input(struct tcp_socket *s,
     }
     DBG("\n");
 
-    /* Full buffer, shall only happen to PUBLISH messages. */
-    if(MQTT_INPUT_BUFF_SIZE - conn->in_packet.payload_pos == 0) {
-      conn->in_publish_msg.payload_chunk = conn->in_packet.payload;
-      conn->in_publish_msg.payload_chunk_length = MQTT_INPUT_BUFF_SIZE;
-      conn->in_publish_msg.payload_left -= MQTT_INPUT_BUFF_SIZE;
-
-      handle_publish(conn);
-
-      conn->in_publish_msg.payload_chunk = conn->in_packet.payload;
-      conn->in_packet.payload_pos = 0;
-    }
-
     if(pos >= input_data_len &&
-       (conn->in_packet.byte_counter < (MQTT_FHDR_SIZE + conn->in_packet.remaining_length))) {
-      return 0;
+       conn->in_packet.byte_counter < in_packet_length(conn)) {
+      return pos;
     }
   }
 
@@ -1048,21 +1409,14 @@ tcp_input(struct tcp_socket *s,
   /* Take care of input */
   DBG("MQTT - Finished reading packet!\n");
   /* What to return? */
-  DBG("MQTT - total data was %i bytes of data. \n",
-      (MQTT_FHDR_SIZE + conn->in_packet.remaining_length));
+  DBG("MQTT - total data was %lu bytes of data. \n",
+      in_packet_length(conn));
 
   /* Handle packet here. */
   switch(conn->in_packet.fhdr & 0xF0) {
   case MQTT_FHDR_MSG_TYPE_CONNACK:
     handle_connack(conn);
     break;
-  case MQTT_FHDR_MSG_TYPE_PUBLISH:
-    /* This is the only or the last chunk of publish payload */
-    conn->in_publish_msg.payload_chunk = conn->in_packet.payload;
-    conn->in_publish_msg.payload_chunk_length = conn->in_packet.payload_pos;
-    conn->in_publish_msg.payload_left = 0;
-    handle_publish(conn);
-    break;
   case MQTT_FHDR_MSG_TYPE_PUBACK:
     handle_puback(conn);
     break;
@@ -1075,14 +1429,14 @@ tcp_input(struct tcp_socket *s,
   case MQTT_FHDR_MSG_TYPE_PINGRESP:
     handle_pingresp(conn);
     break;
-
-  /* QoS 2 not implemented yet */
   case MQTT_FHDR_MSG_TYPE_PUBREC:
+    handle_pubrec(conn);
+    break;
   case MQTT_FHDR_MSG_TYPE_PUBREL:
+    handle_pubrel(conn);
+    break;
   case MQTT_FHDR_MSG_TYPE_PUBCOMP:
-    call_event(conn, MQTT_EVENT_NOT_IMPLEMENTED_ERROR, NULL);
-    PRINTF("MQTT - Got unhandled MQTT Message Type '%i'",
-           (conn->in_packet.fhdr & 0xF0));
+    handle_pubcomp(conn);
     break;
 
   default:
@@ -1093,6 +1447,24 @@ tcp_input(struct tcp_socket *s,
 
   conn->in_packet.packet_received = 1;
 
+  return pos;
+}
+/*---------------------------------------------------------------------------*/
+static int
+tcp_input(struct tcp_socket *s,
+          void *ptr,
+          const uint8_t *input_data_ptr,
+          int input_data_len)
+{
+  struct mqtt_connection *conn = ptr;
+  uint32_t pos = 0;
+
+  /* A segment may carry several packets, such as the PUBACKs of pipelined
+   * publishes */
+  while(pos < input_data_len) {
+    pos += parse_input(conn, &input_data_ptr[pos], input_data_len - pos);
+  }
+
   return 0;
 }
 /*---------------------------------------------------------------------------*/
@@ -1221,8 +1593,7 @@ PROCESS_THREAD(mqtt_process, ev, data)
       conn = data;
       DBG("MQTT - Got mqtt_do_subscribe_mqtt_event!\n");
 
-      if(conn->out_buffer_sent == 1 &&
-         conn->state == MQTT_CONN_STATE_CONNECTED_TO_BROKER) {
+      if(conn->state == MQTT_CONN_STATE_CONNECTED_TO_BROKER) {
         PT_INIT(&conn->out_proto_thread);
         while(conn->state == MQTT_CONN_STATE_CONNECTED_TO_BROKER &&
               subscribe_pt(&conn->out_proto_thread, conn) < PT_EXITED) {
@@ -1234,8 +1605,7 @@ PROCESS_THREAD(mqtt_process, ev, data)
       conn = data;
       DBG("MQTT - Got mqtt_do_unsubscribe_mqtt_event!\n");
 
-      if(conn->out_buffer_sent == 1 &&
-         conn->state == MQTT_CONN_STATE_CONNECTED_TO_BROKER) {
+      if(conn->state == MQTT_CONN_STATE_CONNECTED_TO_BROKER) {
         PT_INIT(&conn->out_proto_thread);
         while(conn->state == MQTT_CONN_STATE_CONNECTED_TO_BROKER &&
               unsubscribe_pt(&conn->out_proto_thread, conn) < PT_EXITED) {
@@ -1247,8 +1617,7 @@ PROCESS_THREAD(mqtt_process, ev, data)
       conn = data;
       DBG("MQTT - Got mqtt_do_publish_mqtt_event!\n");
 
-      if(conn->out_buffer_sent == 1 &&
-         conn->state == MQTT_CONN_STATE_CONNECTED_TO_BROKER) {
+      if(conn->state == MQTT_CONN_STATE_CONNECTED_TO_BROKER) {
         PT_INIT(&conn->out_proto_thread);
         while(conn->state == MQTT_CONN_STATE_CONNECTED_TO_BROKER &&
               publish_pt(&conn->out_proto_thread, conn) < PT_EXITED) {
@@ -1419,35 +1788,89 @@ mqtt_unsubscribe(struct mqtt_connection *conn, uint16_t *mid, char *topic)
   return MQTT_STATUS_OK;
 }
 /*----------------------------------------------------------------------------*/
+static struct mqtt_inflight *
+queue_publish(struct mqtt_connection *conn, uint16_t *mid, char *topic,
+              uint32_t payload_size, mqtt_qos_level_t qos_level,
+              mqtt_retain_t retain)
+{
+  struct mqtt_inflight *entry;
+  int i;
+
+  DBG("MQTT - Call to mqtt_publish...\n");
+
+  entry = NULL;
+  for(i = 0; i < MQTT_INFLIGHT_WINDOW; i++) {
+    if(conn->inflight[i].state == MQTT_INFLIGHT_FREE) {
+      entry = &conn->inflight[i];
+      break;
+    }
+  }
+  if(entry == NULL) {
+    DBG("MQTT - Not accepted!\n");
+    return NULL;
+  }
+  DBG("MQTT - Accepted!\n");
+
+  entry->mid = INCREMENT_MID(conn);
+  entry->retain = retain;
+  entry->topic = topic;
+  entry->topic_length = strlen(topic);
+  entry->payload = NULL;
+  entry->payload_size = payload_size;
+  entry->writer = NULL;
+  entry->writer_ptr = NULL;
+  entry->qos = qos_level;
+  entry->dup = 0;
+  entry->state = MQTT_INFLIGHT_QUEUED;
+  conn->inflight_used++;
+  if(mid != NULL) {
+    *mid = entry->mid;
+  }
+
+  post_flush(conn);
+  return entry;
+}
+/*----------------------------------------------------------------------------*/
 mqtt_status_t
 mqtt_publish(struct mqtt_connection *conn, uint16_t *mid, char *topic,
              uint8_t *payload, uint32_t payload_size,
              mqtt_qos_level_t qos_level, mqtt_retain_t retain)
 {
+  struct mqtt_inflight *entry;
+
   if(conn->state != MQTT_CONN_STATE_CONNECTED_TO_BROKER) {
     return MQTT_STATUS_NOT_CONNECTED_ERROR;
   }
 
-  DBG("MQTT - Call to mqtt_publish...\n");
-
-  /* Currently don't have a queue, so only one item at a time */
-  if(conn->out_queue_full) {
-    DBG("MQTT - Not accepted!\n");
+  entry = queue_publish(conn, mid, topic, payload_size, qos_level, retain);
+  if(entry == NULL) {
     return MQTT_STATUS_OUT_QUEUE_FULL;
   }
-  conn->out_queue_full = 1;
-  DBG("MQTT - Accepted!\n");
+  entry->payload = payload;
+  return MQTT_STATUS_OK;
+}
+/*----------------------------------------------------------------------------*/
+mqtt_status_t
+mqtt_publish_stream(struct mqtt_connection *conn, uint16_t *mid, char *topic,
+                    uint32_t payload_size, mqtt_payload_writer_t writer,
+                    void *ptr, mqtt_qos_level_t qos_level,
+                    mqtt_retain_t retain)
+{
+  struct mqtt_inflight *entry;
 
-  conn->out_packet.mid = INCREMENT_MID(conn);
-  conn->out_packet.retain = retain;
-  conn->out_packet.topic = topic;
-  conn->out_packet.topic_length = strlen(topic);
-  conn->out_packet.payload = payload;
-  conn->out_packet.payload_size = payload_size;
-  conn->out_packet.qos = qos_level;
-  conn->out_packet.qos_state = MQTT_QOS_STATE_NO_ACK;
+  if(conn->state != MQTT_CONN_STATE_CONNECTED_TO_BROKER) {
+    return MQTT_STATUS_NOT_CONNECTED_ERROR;
+  }
+  if(writer == NULL) {
+    return MQTT_STATUS_INVALID_ARGS_ERROR;
+  }
 
-  process_post(&mqtt_process, mqtt_do_publish_event, conn);
+  entry = queue_publish(conn, mid, topic, payload_size, qos_level, retain);
+  if(entry == NULL) {
+    return MQTT_STATUS_OUT_QUEUE_FULL;
+  }
+  entry->writer = writer;
+  entry->writer_ptr = ptr;
   return MQTT_STATUS_OK;
 }
 /*----------------------------------------------------------------------------*/
@@ -35,7 +35,8 @@
  * \defgroup mqtt-engine An implementation of MQTT v3.1
  * @{
  *
- * This application is an engine for MQTT v3.1. It supports QoS Levels 0 and 1.
+ * This application is an engine for MQTT v3.1. It supports QoS Levels 0, 1
+ * and 2.
  *
  * MQTT is a Client Server publish/subscribe messaging transport protocol.
  * It is light weight, open, simple, and designed so as to be easy to implement.
@@ -60,8 +61,7 @@
  *  can occur.
  *  -- "Exactly once" (2), where message are assured to arrive exactly once.
  *  This level could be used, for example, with billing systems where duplicate
- *  or lost messages could lead to incorrect charges being applied. This QoS
- *  level is currently not supported in this implementation.
+ *  or lost messages could lead to incorrect charges being applied.
  *
  * - A small transport overhead and protocol exchanges minimized to reduce
  *   network traffic.
@@ -108,8 +108,23 @@
 #define MQTT_TCP_INPUT_BUFF_SIZE 512
 #define MQTT_TCP_OUTPUT_BUFF_SIZE 512
 
+/*
+ * Incoming packets are read into a buffer of this size. PUBLISH payloads
+ * that do not fit are handed to the application in chunks straight from
+ * the TCP input buffer instead.
+ */
+#ifdef MQTT_CONF_INPUT_BUFF_SIZE
+#define MQTT_INPUT_BUFF_SIZE MQTT_CONF_INPUT_BUFF_SIZE
+#else /* MQTT_CONF_INPUT_BUFF_SIZE */
 #define MQTT_INPUT_BUFF_SIZE 512
+#endif /* MQTT_CONF_INPUT_BUFF_SIZE */
+
+/* Incoming publishes with longer topics are acknowledged but not delivered */
+#ifdef MQTT_CONF_MAX_TOPIC_LENGTH
+#define MQTT_MAX_TOPIC_LENGTH MQTT_CONF_MAX_TOPIC_LENGTH
+#else /* MQTT_CONF_MAX_TOPIC_LENGTH */
 #define MQTT_MAX_TOPIC_LENGTH 64
+#endif /* MQTT_CONF_MAX_TOPIC_LENGTH */
 #define MQTT_MAX_TOPICS_PER_SUBSCRIBE 1
 
 #define MQTT_FHDR_SIZE 1
@@ -117,6 +132,38 @@
 #define MQTT_PROTOCOL_VERSION 3
 #define MQTT_PROTOCOL_NAME "MQIsdp"
 #define MQTT_TOPIC_MAX_LENGTH 128
+
+/*
+ * Number of publishes that may be queued or awaiting their PUBACK or PUBCOMP
+ * at the same time. Publishes queued while a TCP segment is in flight are
+ * written together into the next one.
+ */
+#ifdef MQTT_CONF_INFLIGHT_WINDOW
+#define MQTT_INFLIGHT_WINDOW MQTT_CONF_INFLIGHT_WINDOW
+#else /* MQTT_CONF_INFLIGHT_WINDOW */
+#define MQTT_INFLIGHT_WINDOW 1
+#endif /* MQTT_CONF_INFLIGHT_WINDOW */
+
+/* Time after which an unacknowledged PUBLISH or PUBREL is sent again */
+#ifdef MQTT_CONF_RETRANSMIT_TIMEOUT
+#define MQTT_RETRANSMIT_TIMEOUT MQTT_CONF_RETRANSMIT_TIMEOUT
+#else /* MQTT_CONF_RETRANSMIT_TIMEOUT */
+#define MQTT_RETRANSMIT_TIMEOUT (CLOCK_SECOND * 10)
+#endif /* MQTT_CONF_RETRANSMIT_TIMEOUT */
+
+/* Number of incoming QoS 2 messages that may await their PUBREL */
+#ifdef MQTT_CONF_QOS2_RECEIVE_NUM
+#define MQTT_QOS2_RECEIVE_NUM MQTT_CONF_QOS2_RECEIVE_NUM
+#else /* MQTT_CONF_QOS2_RECEIVE_NUM */
+#define MQTT_QOS2_RECEIVE_NUM 4
+#endif /* MQTT_CONF_QOS2_RECEIVE_NUM */
+
+/* Number of PUBACKs, PUBRECs and PUBCOMPs that may wait to be sent */
+#ifdef MQTT_CONF_ACK_QUEUE_SIZE
+#define MQTT_ACK_QUEUE_SIZE MQTT_CONF_ACK_QUEUE_SIZE
+#else /* MQTT_CONF_ACK_QUEUE_SIZE */
+#define MQTT_ACK_QUEUE_SIZE 4
+#endif /* MQTT_CONF_ACK_QUEUE_SIZE */
 /*---------------------------------------------------------------------------*/
 /*
  * Debug configuration, this is similar but not exactly like the Debugging
@@ -151,6 +198,7 @@ typedef enum {
   MQTT_EVENT_UNSUBACK,
   MQTT_EVENT_PUBLISH,
   MQTT_EVENT_PUBACK,
+  MQTT_EVENT_PUBCOMP,
 
   /* Errors */
   MQTT_EVENT_ERROR = 0x80,
@@ -182,9 +230,17 @@ typedef enum {
 typedef enum {
   MQTT_QOS_STATE_NO_ACK,
   MQTT_QOS_STATE_GOT_ACK,
-
-  /* Expand for QoS 2 */
 } mqtt_qos_state_t;
+
+/* Where an outgoing publish is in its QoS 1 or QoS 2 handshake */
+typedef enum {
+  MQTT_INFLIGHT_FREE,
+  MQTT_INFLIGHT_QUEUED,
+  MQTT_INFLIGHT_WAIT_PUBACK,
+  MQTT_INFLIGHT_WAIT_PUBREC,
+  MQTT_INFLIGHT_QUEUED_PUBREL,
+  MQTT_INFLIGHT_WAIT_PUBCOMP,
+} mqtt_inflight_state_t;
 /*---------------------------------------------------------------------------*/
 /*
  * This is the state of the connection itself.
@@ -223,7 +279,14 @@ struct mqtt_suback_event {
   mqtt_qos_level_t qos_level;
 };
 
-/* This is the MQTT message that is exposed to the end user. */
+/*
+ * This is the MQTT message that is exposed to the end user. A payload of up
+ * to MQTT_INPUT_BUFF_SIZE bytes is delivered in one chunk. A larger payload
+ * is delivered in chunks as the TCP segments carrying it arrive, so
+ * applications must read payload_chunk_length bytes of each chunk rather
+ * than payload_length, and use payload_left to find the last one.
+ * payload_chunk is only valid during the MQTT_EVENT_PUBLISH callback.
+ */
 struct mqtt_message {
   uint32_t mid;
   char topic[MQTT_MAX_TOPIC_LENGTH + 1]; /* +1 for string termination */
@@ -258,7 +321,7 @@ struct mqtt_in_packet {
   /* Not the same as payload in the MQTT sense, it also contains the variable
    * header.
    */
-  uint8_t payload_pos;
+  uint16_t payload_pos;
   uint8_t payload[MQTT_INPUT_BUFF_SIZE];
 
   /* Message specific data */
@@ -266,6 +329,13 @@ struct mqtt_in_packet {
   uint16_t topic_pos;
   uint8_t topic_len_received;
   uint8_t topic_received;
+  uint8_t mid_bytes_received;
+  uint8_t vhdr_received;
+
+  /* Whether a PUBLISH goes to the application and gets acknowledged. A
+   * repeated QoS 2 PUBLISH is only acknowledged. */
+  uint8_t deliver;
+  uint8_t acknowledge;
 };
 
 /* This struct represents a packet sent to the MQTT server. */
@@ -283,6 +353,46 @@ struct mqtt_out_packet {
   mqtt_qos_state_t qos_state;
   mqtt_retain_t retain;
 };
+
+/**
+ * \brief           MQTT payload writer function
+ * \param m         A pointer to a MQTT connection
+ * \param ptr       The pointer given to mqtt_publish_stream()
+ * \param offset    Offset of the chunk within the payload
+ * \param chunk     Where to write the chunk
+ * \param chunk_length Number of bytes to write, all of which must be written
+ *
+ * The writer function fills the TCP output buffer directly with the next
+ * chunk of a payload given to mqtt_publish_stream(). It is called again from
+ * offset 0 if a QoS 1 or QoS 2 publish has to be sent again.
+ */
+typedef void (*mqtt_payload_writer_t)(struct mqtt_connection *m,
+                                      void *ptr,
+                                      uint32_t offset,
+                                      uint8_t *chunk,
+                                      uint16_t chunk_length);
+
+/* A publish that is queued or awaiting its acknowledgement */
+struct mqtt_inflight {
+  uint8_t state;
+  uint8_t qos;
+  uint8_t retain;
+  uint8_t dup;
+  uint16_t mid;
+  char *topic;
+  uint16_t topic_length;
+  uint8_t *payload;
+  uint32_t payload_size;
+  mqtt_payload_writer_t writer;
+  void *writer_ptr;
+  clock_time_t sent;
+};
+
+/* A PUBACK, PUBREC, PUBREL or PUBCOMP waiting to be sent */
+struct mqtt_ack {
+  uint8_t fhdr;
+  uint16_t mid;
+};
 /*---------------------------------------------------------------------------*/
 /**
  * \brief           MQTT event callback function
@@ -348,10 +458,22 @@ struct mqtt_connection {
   uint32_t out_write_pos;
   uint16_t max_segment_size;
 
+  /* Outgoing publishes and acknowledgements */
+  struct mqtt_inflight inflight[MQTT_INFLIGHT_WINDOW];
+  uint8_t inflight_used;
+  uint8_t inflight_pos;
+  uint8_t flush_pending;
+  struct ctimer retransmit_timer;
+  struct mqtt_ack acks[MQTT_ACK_QUEUE_SIZE];
+  uint8_t ack_head;
+  uint8_t ack_count;
+  uint8_t ack_out[4];
+
   /* Incoming data related */
   uint8_t in_buffer[MQTT_TCP_INPUT_BUFF_SIZE];
   struct mqtt_in_packet in_packet;
   struct mqtt_message in_publish_msg;
+  uint16_t qos2_received[MQTT_QOS2_RECEIVE_NUM];
 
   /* TCP related information */
   char *server_host;
@@ -442,14 +564,18 @@ mqtt_status_t mqtt_unsubscribe(struct mqtt_connection *conn,
  * \param topic A pointer to the topic to subscribe to.
  * \param payload A pointer to the topic payload.
  * \param payload_size Payload size.
- * \param qos_level Quality Of Service level to use. Currently supports 0, 1.
+ * \param qos_level Quality Of Service level to use. Supports 0, 1 and 2.
  * \param retain If the RETAIN flag is set to 1, in a PUBLISH Packet sent by a
  *        Client to a Server, the Server MUST store the Application Message
  *        and its QoS, so that it can be delivered to future subscribers whose
  *        subscriptions match its topic name
  * \return MQTT_STATUS_OK or some error status
  *
- * This function publishes to a topic on a MQTT broker.
+ * This function publishes to a topic on a MQTT broker. Up to
+ * MQTT_INFLIGHT_WINDOW publishes may be outstanding at once. The topic and
+ * payload must stay valid until MQTT_EVENT_PUBACK for QoS 1, or
+ * MQTT_EVENT_PUBCOMP for QoS 2, reports the message ID. QoS 0 publishes
+ * only need them until the next mqtt_update_event.
  */
 mqtt_status_t mqtt_publish(struct mqtt_connection *conn,
                            uint16_t *mid,
@@ -459,6 +585,33 @@ mqtt_status_t mqtt_publish(struct mqtt_connection *conn,
                            mqtt_qos_level_t qos_level,
                            mqtt_retain_t retain);
 /*---------------------------------------------------------------------------*/
+/**
+ * \brief Publish to a MQTT topic with a payload written in chunks.
+ * \param conn A pointer to the MQTT connection.
+ * \param mid A pointer to message ID.
+ * \param topic A pointer to the topic to subscribe to.
+ * \param payload_size Payload size.
+ * \param writer Function writing the payload chunk by chunk.
+ * \param ptr A pointer passed to the writer.
+ * \param qos_level Quality Of Service level to use. Supports 0, 1 and 2.
+ * \param retain The RETAIN flag, as for mqtt_publish().
+ * \return MQTT_STATUS_OK or some error status
+ *
+ * This function works like mqtt_publish(), but the payload is not kept in
+ * RAM. The writer fills the TCP output buffer with each chunk as soon as
+ * there is room for it, so the payload may be much larger than
+ * MQTT_TCP_OUTPUT_BUFF_SIZE. The writer and ptr must stay valid for as long
+ * as mqtt_publish() needs its payload.
+ */
+mqtt_status_t mqtt_publish_stream(struct mqtt_connection *conn,
+                                  uint16_t *mid,
+                                  char *topic,
+                                  uint32_t payload_size,
+                                  mqtt_payload_writer_t writer,
+                                  void *ptr,
+                                  mqtt_qos_level_t qos_level,
+                                  mqtt_retain_t retain);
+/*---------------------------------------------------------------------------*/
 /**
  * \brief Set the user name and password for a MQTT client.
  * \param conn A pointer to the MQTT connection.
@@ -498,7 +651,8 @@ void mqtt_set_last_will(struct mqtt_connection *conn,
   ((conn)->state == MQTT_CONN_STATE_CONNECTED_TO_BROKER ? 1 : 0)
 
 #define mqtt_ready(conn) \
-  (!(conn)->out_queue_full && mqtt_connected((conn)))
+  (!(conn)->out_queue_full && \
+   (conn)->inflight_used < MQTT_INFLIGHT_WINDOW && mqtt_connected((conn)))
 /*---------------------------------------------------------------------------*/
 #endif /* MQTT_H_ */
 /*---------------------------------------------------------------------------*/
@@ -59,7 +59,16 @@ PROCESS_THREAD(shell_ps_process, ev, data)
   for(p = PROCESS_LIST(); p != NULL; p = p->next) {
     char namebuf[30];
     strncpy(namebuf, PROCESS_NAME_STRING(p), sizeof(namebuf));
+#if PROCESS_STATS_PER_PROCESS
+    {
+      char statsbuf[50];
+      snprintf(statsbuf, sizeof(statsbuf), ": %lu events, %lu polls, %lu ticks",
+               p->events, p->polls, p->runtime);
+      shell_output_str(&ps_command, namebuf, statsbuf);
+    }
+#else /* PROCESS_STATS_PER_PROCESS */
     shell_output_str(&ps_command, namebuf, "");
+#endif /* PROCESS_STATS_PER_PROCESS */
   }
 
   PROCESS_END();
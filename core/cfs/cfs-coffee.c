@@ -55,6 +55,7 @@
 #endif
 
 #include "contiki-conf.h"
+#include "sys/process.h"
 #include "cfs/cfs.h"
 #include "cfs-coffee-arch.h"
 #include "cfs/cfs-coffee.h"
@@ -84,6 +85,69 @@
 #define COFFEE_EXTENDED_WEAR_LEVELLING  1
 #endif
 
+/*
+ * Number of files whose first page is kept in a RAM index, so that
+ * opening a file reads a single header instead of scanning the
+ * flash. With more files, files missing from the index are searched
+ * for on the flash as without it. 0 disables the index.
+ */
+#ifndef COFFEE_NAME_INDEX_SIZE
+#ifdef COFFEE_CONF_NAME_INDEX_SIZE
+#define COFFEE_NAME_INDEX_SIZE COFFEE_CONF_NAME_INDEX_SIZE
+#else
+#define COFFEE_NAME_INDEX_SIZE 0
+#endif
+#endif
+
+/*
+ * Number of log regions per cached file whose latest log record is
+ * remembered in RAM, so that reading a modified file does not search
+ * the log index table on the flash. 0 disables the map.
+ */
+#ifndef COFFEE_LOG_MAP_SIZE
+#ifdef COFFEE_CONF_LOG_MAP_SIZE
+#define COFFEE_LOG_MAP_SIZE COFFEE_CONF_LOG_MAP_SIZE
+#else
+#define COFFEE_LOG_MAP_SIZE 0
+#endif
+#endif
+
+#if COFFEE_LOG_MAP_SIZE && !COFFEE_MICRO_LOGS
+#undef COFFEE_LOG_MAP_SIZE
+#define COFFEE_LOG_MAP_SIZE 0
+#endif
+
+/*
+ * Erase obsolete sectors from a background process, one sector per
+ * process slice, when fewer than COFFEE_GC_LOW_WATERMARK pages are
+ * free, until COFFEE_GC_HIGH_WATERMARK pages are free or no sector can
+ * be erased. Writes that still run out of space erase sectors one at
+ * a time until their allocation fits, instead of all at once.
+ */
+#ifndef COFFEE_BACKGROUND_GC
+#ifdef COFFEE_CONF_BACKGROUND_GC
+#define COFFEE_BACKGROUND_GC COFFEE_CONF_BACKGROUND_GC
+#else
+#define COFFEE_BACKGROUND_GC 0
+#endif
+#endif
+
+#ifndef COFFEE_GC_LOW_WATERMARK
+#ifdef COFFEE_CONF_GC_LOW_WATERMARK
+#define COFFEE_GC_LOW_WATERMARK COFFEE_CONF_GC_LOW_WATERMARK
+#else
+#define COFFEE_GC_LOW_WATERMARK (2 * COFFEE_PAGES_PER_SECTOR)
+#endif
+#endif
+
+#ifndef COFFEE_GC_HIGH_WATERMARK
+#ifdef COFFEE_CONF_GC_HIGH_WATERMARK
+#define COFFEE_GC_HIGH_WATERMARK COFFEE_CONF_GC_HIGH_WATERMARK
+#else
+#define COFFEE_GC_HIGH_WATERMARK (4 * COFFEE_PAGES_PER_SECTOR)
+#endif
+#endif
+
 #if COFFEE_START & (COFFEE_SECTOR_SIZE - 1)
 #error COFFEE_START must point to the first byte in a sector.
 #endif
@@ -96,6 +160,7 @@
 
 /* File object flags. */
 #define COFFEE_FILE_MODIFIED  0x1
+#define COFFEE_FILE_LOG_MAPPED 0x2 /* log_map is up to date. */
 
 /* Internal Coffee markers. */
 #define INVALID_PAGE      ((coffee_page_t)-1)
@@ -111,6 +176,8 @@
 #define GC_GREEDY         0
 /* "Reluctant" garbage collection stops after erasing one sector. */
 #define GC_RELUCTANT      1
+/* "Incremental" garbage collection erases the first erasable sector. */
+#define GC_INCREMENTAL    2
 
 /* File descriptor macros. */
 #define FD_VALID(fd)      ((fd) >= 0 && (fd) < COFFEE_FD_SET_SIZE && \
@@ -168,6 +235,10 @@ struct file {
   int16_t record_count;
   uint8_t references;
   uint8_t flags;
+#if COFFEE_LOG_MAP_SIZE
+  /* The latest log record of each region, -1 if there is none. */
+  int16_t log_map[COFFEE_LOG_MAP_SIZE];
+#endif
 };
 
 /* The file descriptor structure. */
@@ -190,6 +261,19 @@ struct file_header {
   char name[COFFEE_NAME_LENGTH];
 };
 
+#if COFFEE_NAME_INDEX_SIZE
+/* An entry of the name index. */
+struct name_entry {
+  uint16_t hash;
+  coffee_page_t page;
+};
+
+/* States of the name index. */
+#define INDEX_UNBUILT     0
+#define INDEX_COMPLETE    1 /* Every active file is in the index. */
+#define INDEX_PARTIAL     2 /* Some files did not fit into the index. */
+#endif /* COFFEE_NAME_INDEX_SIZE */
+
 /* This is needed because of a buggy compiler. */
 struct log_param {
   cfs_offset_t offset;
@@ -205,6 +289,17 @@ static struct file coffee_files[COFFEE_MAX_OPEN_FILES];
 static struct file_desc coffee_fd_set[COFFEE_FD_SET_SIZE];
 static coffee_page_t next_free;
 static char gc_wait;
+#if COFFEE_NAME_INDEX_SIZE
+static struct name_entry name_index[COFFEE_NAME_INDEX_SIZE];
+static coffee_page_t name_index_count;
+static uint8_t name_index_state;
+#endif /* COFFEE_NAME_INDEX_SIZE */
+#if COFFEE_BACKGROUND_GC
+/* Free pages, or INVALID_PAGE until they have been counted. */
+static coffee_page_t free_pages = INVALID_PAGE;
+
+PROCESS(coffee_gc_process, "Coffee GC");
+#endif /* COFFEE_BACKGROUND_GC */
 
 /*---------------------------------------------------------------------------*/
 static void
@@ -348,15 +443,18 @@ isolate_pages(coffee_page_t start, coffee_page_t skip_pages)
          (unsigned)skip_pages, (int)start / COFFEE_PAGES_PER_SECTOR);
 }
 /*---------------------------------------------------------------------------*/
-static void
+static int
 collect_garbage(int mode)
 {
   coffee_page_t sector;
   struct sector_status stats;
   coffee_page_t first_page, isolation_count;
+  int erased;
 
   PRINTF("Coffee: Running the garbage collector in %s mode\n",
-         mode == GC_RELUCTANT ? "reluctant" : "greedy");
+         mode == GC_RELUCTANT ? "reluctant" :
+         mode == GC_INCREMENTAL ? "incremental" : "greedy");
+  erased = 0;
   /*
    * The garbage collector erases as many sectors as possible. A sector is
    * erasable if there are only free or obsolete pages in it.
@@ -372,7 +470,7 @@ collect_garbage(int mode)
     }
 
     if((mode == GC_RELUCTANT && stats.free == 0) ||
-       (mode == GC_GREEDY && stats.obsolete > 0)) {
+       (mode != GC_RELUCTANT && stats.obsolete > 0)) {
       first_page = sector * COFFEE_PAGES_PER_SECTOR;
       if(first_page < next_free) {
         next_free = first_page;
@@ -384,13 +482,67 @@ collect_garbage(int mode)
 
       COFFEE_ERASE(sector);
       PRINTF("Coffee: Erased sector %d!\n", sector);
+      erased++;
+#if COFFEE_BACKGROUND_GC
+      if(free_pages != INVALID_PAGE) {
+        free_pages += stats.obsolete;
+      }
+#endif /* COFFEE_BACKGROUND_GC */
 
-      if(mode == GC_RELUCTANT && isolation_count > 0) {
+      if((mode == GC_RELUCTANT && isolation_count > 0) ||
+         mode == GC_INCREMENTAL) {
         break;
       }
     }
   }
+
+  return erased;
+}
+/*---------------------------------------------------------------------------*/
+#if COFFEE_BACKGROUND_GC
+static void
+count_free_pages(void)
+{
+  coffee_page_t sector;
+  struct sector_status stats;
+
+  free_pages = 0;
+  for(sector = 0; sector < COFFEE_SECTOR_COUNT; sector++) {
+    get_sector_status(sector, &stats);
+    free_pages += stats.free;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+schedule_gc(void)
+{
+  if(!process_is_running(&coffee_gc_process)) {
+    process_start(&coffee_gc_process, NULL);
+  }
+  process_poll(&coffee_gc_process);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(coffee_gc_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL);
+
+    if(free_pages == INVALID_PAGE) {
+      count_free_pages();
+      PROCESS_PAUSE();
+    }
+
+    while(free_pages < COFFEE_GC_HIGH_WATERMARK &&
+          collect_garbage(GC_INCREMENTAL) > 0) {
+      PROCESS_PAUSE();
+    }
+  }
+
+  PROCESS_END();
 }
+#endif /* COFFEE_BACKGROUND_GC */
 /*---------------------------------------------------------------------------*/
 static coffee_page_t
 next_file(coffee_page_t page, struct file_header *hdr)
@@ -413,6 +565,62 @@ next_file(coffee_page_t page, struct file_header *hdr)
   return page + hdr->max_pages;
 }
 /*---------------------------------------------------------------------------*/
+#if COFFEE_NAME_INDEX_SIZE
+static uint16_t
+name_hash(const char *name)
+{
+  uint16_t hash;
+  int i;
+
+  hash = 0;
+  for(i = 0; i < COFFEE_NAME_LENGTH && name[i] != '\0'; i++) {
+    hash = (hash << 5) + hash + (unsigned char)name[i];
+  }
+  return hash;
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_add(const char *name, coffee_page_t page)
+{
+  if(name_index_count == COFFEE_NAME_INDEX_SIZE) {
+    name_index_state = INDEX_PARTIAL;
+    return;
+  }
+  name_index[name_index_count].hash = name_hash(name);
+  name_index[name_index_count].page = page;
+  name_index_count++;
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_remove(coffee_page_t page)
+{
+  coffee_page_t i;
+
+  for(i = 0; i < name_index_count; i++) {
+    if(name_index[i].page == page) {
+      name_index[i] = name_index[--name_index_count];
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_build(void)
+{
+  struct file_header hdr;
+  coffee_page_t page;
+
+  name_index_count = 0;
+  name_index_state = INDEX_COMPLETE;
+  for(page = 0; page < COFFEE_PAGE_COUNT; page = next_file(page, &hdr)) {
+    read_header(&hdr, page);
+    if(HDR_ACTIVE(hdr) && !HDR_LOG(hdr)) {
+      index_add(hdr.name, page);
+    }
+  }
+}
+#endif /* COFFEE_NAME_INDEX_SIZE */
+/*---------------------------------------------------------------------------*/
 static struct file *
 load_file(coffee_page_t start, struct file_header *hdr)
 {
@@ -458,6 +666,36 @@ find_file(const char *name)
   int i;
   struct file_header hdr;
   coffee_page_t page;
+#if COFFEE_NAME_INDEX_SIZE
+  coffee_page_t j;
+  uint16_t hash;
+
+  if(name_index_state == INDEX_UNBUILT) {
+    index_build();
+  }
+
+  /* Only the headers of files with the same name hash are read. */
+  hash = name_hash(name);
+  for(j = 0; j < name_index_count; j++) {
+    if(name_index[j].hash != hash) {
+      continue;
+    }
+    page = name_index[j].page;
+    read_header(&hdr, page);
+    if(HDR_ACTIVE(hdr) && !HDR_LOG(hdr) && strcmp(name, hdr.name) == 0) {
+      for(i = 0; i < COFFEE_MAX_OPEN_FILES; i++) {
+        if(!FILE_FREE(&coffee_files[i]) && coffee_files[i].page == page) {
+          return &coffee_files[i];
+        }
+      }
+      return load_file(page, &hdr);
+    }
+  }
+
+  if(name_index_state == INDEX_COMPLETE) {
+    return NULL;
+  }
+#endif /* COFFEE_NAME_INDEX_SIZE */
 
   /* First check if the file metadata is cached. */
   for(i = 0; i < COFFEE_MAX_OPEN_FILES; i++) {
@@ -573,6 +811,10 @@ remove_by_page(coffee_page_t page, int remove_log,
   hdr.flags |= HDR_FLAG_OBSOLETE;
   write_header(&hdr, page);
 
+#if COFFEE_NAME_INDEX_SIZE
+  index_remove(page);
+#endif /* COFFEE_NAME_INDEX_SIZE */
+
   gc_wait = 0;
 
   /* Close all file descriptors that reference the removed file. */
@@ -623,8 +865,17 @@ reserve(const char *name, coffee_page_t pages,
     if(gc_wait) {
       return NULL;
     }
+#if COFFEE_BACKGROUND_GC
+    do {
+      if(collect_garbage(GC_INCREMENTAL) == 0) {
+        break;
+      }
+      page = find_contiguous_pages(pages);
+    } while(page == INVALID_PAGE);
+#else
     collect_garbage(GC_GREEDY);
     page = find_contiguous_pages(pages);
+#endif /* COFFEE_BACKGROUND_GC */
     if(page == INVALID_PAGE) {
       gc_wait = 1;
       return NULL;
@@ -637,6 +888,24 @@ reserve(const char *name, coffee_page_t pages,
   hdr.flags = HDR_FLAG_ALLOCATED | flags;
   write_header(&hdr, page);
 
+#if COFFEE_BACKGROUND_GC
+  if(pages > free_pages) {
+    /* the count has drifted, let the collector count the pages again */
+    free_pages = INVALID_PAGE;
+  } else if(free_pages != INVALID_PAGE) {
+    free_pages -= pages;
+  }
+  if(free_pages == INVALID_PAGE || free_pages < COFFEE_GC_LOW_WATERMARK) {
+    schedule_gc();
+  }
+#endif /* COFFEE_BACKGROUND_GC */
+
+#if COFFEE_NAME_INDEX_SIZE
+  if(name_index_state != INDEX_UNBUILT && !(flags & HDR_FLAG_LOG)) {
+    index_add(hdr.name, page);
+  }
+#endif /* COFFEE_NAME_INDEX_SIZE */
+
   PRINTF("Coffee: Reserved %u pages starting from %u for file %s\n",
          (unsigned)pages, (unsigned)page, name);
 
@@ -720,10 +989,53 @@ get_record_index(coffee_page_t log_page, uint16_t search_records,
 }
 #endif /* COFFEE_MICRO_LOGS */
 /*---------------------------------------------------------------------------*/
+#if COFFEE_LOG_MAP_SIZE
+static void
+map_log(struct file *file, coffee_page_t log_page, uint16_t log_records)
+{
+  uint16_t processed;
+  uint16_t batch_size;
+  uint16_t records;
+  int16_t i;
+
+  for(i = 0; i < COFFEE_LOG_MAP_SIZE; i++) {
+    file->log_map[i] = -1;
+  }
+
+  /* Read the log index table once, up to the first unused entry. */
+  records = file->record_count < 0 ? log_records : file->record_count;
+  batch_size = records > COFFEE_LOG_TABLE_LIMIT ?
+    COFFEE_LOG_TABLE_LIMIT : records;
+  if(batch_size > 0) {
+    uint16_t indices[batch_size];
+
+    for(processed = 0; processed < records; processed += batch_size) {
+      if(batch_size + processed > records) {
+        batch_size = records - processed;
+      }
+      COFFEE_READ(&indices, batch_size * sizeof(indices[0]),
+                  absolute_offset(log_page, processed * sizeof(indices[0])));
+      for(i = 0; i < batch_size; i++) {
+        if(indices[i] == 0) {
+          records = processed + i;
+          break;
+        }
+        if(indices[i] - 1 < COFFEE_LOG_MAP_SIZE) {
+          file->log_map[indices[i] - 1] = processed + i;
+        }
+      }
+    }
+  }
+
+  file->record_count = records;
+  file->flags |= COFFEE_FILE_LOG_MAPPED;
+}
+#endif /* COFFEE_LOG_MAP_SIZE */
+/*---------------------------------------------------------------------------*/
 #if COFFEE_MICRO_LOGS
 static int
-read_log_page(struct file_header *hdr, int16_t record_count,
-              struct log_param *lp)
+read_log_page(struct file *file, struct file_header *hdr,
+              int16_t record_count, struct log_param *lp)
 {
   uint16_t region;
   int16_t match_index;
@@ -735,8 +1047,18 @@ read_log_page(struct file_header *hdr, int16_t record_count,
   adjust_log_config(hdr, &log_record_size, &log_records);
   region = modify_log_buffer(log_record_size, &lp->offset, &lp->size);
 
-  search_records = record_count < 0 ? log_records : record_count;
-  match_index = get_record_index(hdr->log_page, search_records, region);
+#if COFFEE_LOG_MAP_SIZE
+  if(region < COFFEE_LOG_MAP_SIZE) {
+    if(!(file->flags & COFFEE_FILE_LOG_MAPPED)) {
+      map_log(file, hdr->log_page, log_records);
+    }
+    match_index = file->log_map[region];
+  } else
+#endif /* COFFEE_LOG_MAP_SIZE */
+  {
+    search_records = record_count < 0 ? log_records : record_count;
+    match_index = get_record_index(hdr->log_page, search_records, region);
+  }
   if(match_index < 0) {
     return -1;
   }
@@ -839,7 +1161,7 @@ merge_log(coffee_page_t file_page, int extend)
   hdr2.log_records = hdr.log_records;
   write_header(&hdr2, new_file->page);
 
-  new_file->flags &= ~COFFEE_FILE_MODIFIED;
+  new_file->flags &= ~(COFFEE_FILE_MODIFIED | COFFEE_FILE_LOG_MAPPED);
   new_file->end = offset;
 
   cfs_close(fd);
@@ -934,7 +1256,7 @@ write_log_page(struct file *file, struct log_param *lp)
     lp_out.size = log_record_size;
 
     if((lp->offset > 0 || lp->size != log_record_size) &&
-       read_log_page(&hdr, log_record, &lp_out) < 0) {
+       read_log_page(file, &hdr, log_record, &lp_out) < 0) {
       COFFEE_READ(copy_buf, sizeof(copy_buf),
                   absolute_offset(file->page, offset));
     }
@@ -954,6 +1276,13 @@ write_log_page(struct file *file, struct log_param *lp)
     COFFEE_WRITE(copy_buf, sizeof(copy_buf),
                  offset + log_record * log_record_size);
     file->record_count = log_record + 1;
+
+#if COFFEE_LOG_MAP_SIZE
+    /* Keep the map up to date rather than reading the table again. */
+    if(region - 1 < COFFEE_LOG_MAP_SIZE) {
+      file->log_map[region - 1] = log_record;
+    }
+#endif /* COFFEE_LOG_MAP_SIZE */
   }
 
   return lp->size;
@@ -1122,7 +1451,7 @@ cfs_read(int fd, void *buf, unsigned size)
     lp.offset = fdp->offset;
     lp.buf = buf;
     lp.size = bytes_left;
-    r = read_log_page(&hdr, file->record_count, &lp);
+    r = read_log_page(file, &hdr, file->record_count, &lp);
 
     /* Read from the original file if we cannot find the data in the log. */
     if(r < 0) {
@@ -1338,6 +1667,13 @@ cfs_coffee_format(void)
   memset(&coffee_fd_set, 0, sizeof(coffee_fd_set));
   next_free = 0;
   gc_wait = 1;
+#if COFFEE_BACKGROUND_GC
+  free_pages = COFFEE_PAGE_COUNT;
+#endif /* COFFEE_BACKGROUND_GC */
+#if COFFEE_NAME_INDEX_SIZE
+  name_index_count = 0;
+  name_index_state = INDEX_COMPLETE;
+#endif /* COFFEE_NAME_INDEX_SIZE */
 
   PRINTF(" done!\n");
 
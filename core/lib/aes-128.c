@@ -46,6 +46,17 @@
 #include "lib/aes-128.h"
 #include <string.h>
 
+/*
+ * Number of expanded keys kept at once. set_key() only expands a key that
+ * is not among them, so switching between a few keys, e.g., those of the
+ * neighbors a node talks to, does not redo the key schedule every time.
+ */
+#ifdef AES_128_CONF_KEY_SLOTS
+#define KEY_SLOTS AES_128_CONF_KEY_SLOTS
+#else /* AES_128_CONF_KEY_SLOTS */
+#define KEY_SLOTS 1
+#endif /* AES_128_CONF_KEY_SLOTS */
+
 static const uint8_t sbox[256] =   { 
 0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
 0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
@@ -64,7 +75,12 @@ static const uint8_t sbox[256] =   {
 0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
 0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16 };
 
-static uint8_t round_keys[11][AES_128_KEY_LENGTH];
+/* round_keys[slot][0] is the key itself */
+static uint8_t key_slots[KEY_SLOTS][11][AES_128_KEY_LENGTH];
+static uint16_t slot_last_used[KEY_SLOTS];
+static uint16_t use_count;
+static uint8_t slots_used;
+static uint8_t (*round_keys)[AES_128_KEY_LENGTH] = key_slots[0];
 
 /*---------------------------------------------------------------------------*/
 /* multiplies by 2 in GF(2) */
@@ -81,7 +97,32 @@ set_key(const uint8_t *key)
   uint8_t i;
   uint8_t j;
   uint8_t rcon;
-  
+  uint8_t slot;
+
+  use_count++;
+  for(slot = 0; slot < slots_used; slot++) {
+    if(!memcmp(key_slots[slot][0], key, AES_128_KEY_LENGTH)) {
+      round_keys = key_slots[slot];
+      slot_last_used[slot] = use_count;
+      return;
+    }
+  }
+
+  /* take a free slot or else the least recently used one */
+  if(slots_used < KEY_SLOTS) {
+    slot = slots_used++;
+  } else {
+    slot = 0;
+    for(i = 1; i < KEY_SLOTS; i++) {
+      if((uint16_t)(use_count - slot_last_used[i])
+         > (uint16_t)(use_count - slot_last_used[slot])) {
+        slot = i;
+      }
+    }
+  }
+  round_keys = key_slots[slot];
+  slot_last_used[slot] = use_count;
+
   rcon = 0x01;
   memcpy(round_keys[0], key, AES_128_KEY_LENGTH);
   for(i = 1; i <= 10; i++) {
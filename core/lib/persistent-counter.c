@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2026, Hasso-Plattner-Institut.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Monotonic counters that survive reboots.
+ */
+
+#include "lib/persistent-counter.h"
+#include "cfs/cfs.h"
+
+/*
+ * Coffee finds the end of a file after a reboot by skipping trailing
+ * zero bytes, so every record ends with a non-zero marker. The marker
+ * also tells complete records from interrupted writes.
+ */
+#define RECORD_SIZE   5
+#define RECORD_MARKER 0xc5
+
+/*---------------------------------------------------------------------------*/
+static int
+read_last(const char *file, uint32_t *value, uint16_t *records)
+{
+  uint8_t record[RECORD_SIZE];
+  cfs_offset_t end;
+  uint16_t n;
+  int found;
+  int fd;
+
+  fd = cfs_open(file, CFS_READ);
+  if(fd < 0) {
+    return 0;
+  }
+
+  end = cfs_seek(fd, 0, CFS_SEEK_END);
+  n = end < 0 ? 0 : end / RECORD_SIZE;
+  found = 0;
+  *records = n;
+  if(end % RECORD_SIZE != 0) {
+    *records = PERSISTENT_COUNTER_RECORDS;
+  }
+
+  for(; n > 0 && !found; n--) {
+    if(cfs_seek(fd, (n - 1) * RECORD_SIZE, CFS_SEEK_SET) < 0
+       || cfs_read(fd, record, RECORD_SIZE) != RECORD_SIZE
+       || record[RECORD_SIZE - 1] != RECORD_MARKER) {
+      /* later records would not be aligned */
+      *records = PERSISTENT_COUNTER_RECORDS;
+      continue;
+    }
+    *value = ((uint32_t)record[0] << 24) | ((uint32_t)record[1] << 16)
+      | ((uint32_t)record[2] << 8) | record[3];
+    found = 1;
+  }
+
+  cfs_close(fd);
+  return found;
+}
+/*---------------------------------------------------------------------------*/
+int
+persistent_counter_init(struct persistent_counter *c,
+                        const char *file, const char *spare_file)
+{
+  uint32_t value;
+  uint16_t records;
+  int found;
+  uint8_t i;
+
+  c->file[0] = file;
+  c->file[1] = spare_file;
+  c->value = 0;
+  c->records = 0;
+  c->active = 0;
+
+  /* both files are left after a reset while switching between them */
+  found = 0;
+  for(i = 0; i < 2; i++) {
+    if(read_last(c->file[i], &value, &records)
+       && (!found || value > c->value)) {
+      c->value = value;
+      c->records = records;
+      c->active = i;
+      found = 1;
+    }
+  }
+  return found;
+}
+/*---------------------------------------------------------------------------*/
+int
+persistent_counter_set(struct persistent_counter *c, uint32_t value)
+{
+  uint8_t record[RECORD_SIZE];
+  int full;
+  int fd;
+  int n;
+
+  if(value < c->value) {
+    return 0;
+  }
+
+  record[0] = value >> 24;
+  record[1] = value >> 16;
+  record[2] = value >> 8;
+  record[3] = value;
+  record[4] = RECORD_MARKER;
+
+  full = c->records >= PERSISTENT_COUNTER_RECORDS;
+  if(full) {
+    /* the full file is only removed once the other one holds the value */
+    c->active ^= 1;
+    c->records = 0;
+    cfs_remove(c->file[c->active]);
+  }
+
+  fd = cfs_open(c->file[c->active], CFS_WRITE | CFS_APPEND);
+  if(fd < 0) {
+    return 0;
+  }
+  n = cfs_write(fd, record, RECORD_SIZE);
+  cfs_close(fd);
+  if(n != RECORD_SIZE) {
+    c->records = PERSISTENT_COUNTER_RECORDS;
+    return 0;
+  }
+
+  c->records++;
+  c->value = value;
+  if(full) {
+    cfs_remove(c->file[c->active ^ 1]);
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+persistent_counter_increment(struct persistent_counter *c)
+{
+  return persistent_counter_set(c, c->value + 1);
+}
+/*---------------------------------------------------------------------------*/
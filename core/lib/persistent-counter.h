@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2026, Hasso-Plattner-Institut.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Monotonic counters that survive reboots, such as boot counters.
+ *         Each update appends a record to a log file instead of rewriting
+ *         the file, and a full log continues in a second file.
+ */
+
+#ifndef PERSISTENT_COUNTER_H_
+#define PERSISTENT_COUNTER_H_
+
+#include "contiki.h"
+
+#ifdef PERSISTENT_COUNTER_CONF_RECORDS
+#define PERSISTENT_COUNTER_RECORDS PERSISTENT_COUNTER_CONF_RECORDS
+#else /* PERSISTENT_COUNTER_CONF_RECORDS */
+/* 48 records of 5 bytes fit into one page of 256 bytes */
+#define PERSISTENT_COUNTER_RECORDS 48
+#endif /* PERSISTENT_COUNTER_CONF_RECORDS */
+
+/**
+ * A counter and the two log files that hold it.
+ */
+struct persistent_counter {
+  const char *file[2];
+  uint32_t value;
+  /** Records in the file that is appended to, or
+      PERSISTENT_COUNTER_RECORDS if it must not be appended to anymore */
+  uint16_t records;
+  uint8_t active;
+};
+
+/**
+ * \brief Recovers the latest value of a counter, 0 if none was stored.
+ * \return 1 if a stored value was found, 0 otherwise
+ *
+ * Reads at most the last record of each file, unless an interrupted
+ * write left a damaged record behind.
+ */
+int persistent_counter_init(struct persistent_counter *c,
+                            const char *file, const char *spare_file);
+
+/**
+ * \brief Stores a new value, which must not be smaller than the current one.
+ * \return 1 on success, 0 otherwise
+ */
+int persistent_counter_set(struct persistent_counter *c, uint32_t value);
+
+/**
+ * \brief Increments a counter by one.
+ * \return 1 on success, 0 otherwise
+ */
+int persistent_counter_increment(struct persistent_counter *c);
+
+#define persistent_counter_get(c) ((c)->value)
+
+#endif /* PERSISTENT_COUNTER_H_ */
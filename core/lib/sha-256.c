@@ -0,0 +1,199 @@
+/*
+ * Copyright (c) 2026, Hasso-Plattner-Institut.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Software implementation of SHA-256.
+ */
+
+#include "lib/sha-256.h"
+
+#include <string.h>
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+#define CH(x, y, z) (((x) & (y)) ^ (~(x) & (z)))
+#define MAJ(x, y, z) (((x) & (y)) ^ ((x) & (z)) ^ ((y) & (z)))
+#define SIGMA0(x) (ROTR(x, 2) ^ ROTR(x, 13) ^ ROTR(x, 22))
+#define SIGMA1(x) (ROTR(x, 6) ^ ROTR(x, 11) ^ ROTR(x, 25))
+#define SIGMA_LOWER0(x) (ROTR(x, 7) ^ ROTR(x, 18) ^ ((x) >> 3))
+#define SIGMA_LOWER1(x) (ROTR(x, 17) ^ ROTR(x, 19) ^ ((x) >> 10))
+
+static const uint32_t k[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+  0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+  0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+  0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+  0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+  0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+  0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+  0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+  0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+/*---------------------------------------------------------------------------*/
+static void
+compress(sha_256_context_t *ctx, const uint8_t *block)
+{
+  uint32_t w[16];
+  uint32_t a, b, c, d, e, f, g, h;
+  uint32_t t1, t2;
+  uint8_t i;
+
+  a = ctx->state[0];
+  b = ctx->state[1];
+  c = ctx->state[2];
+  d = ctx->state[3];
+  e = ctx->state[4];
+  f = ctx->state[5];
+  g = ctx->state[6];
+  h = ctx->state[7];
+
+  /* The message schedule is kept in a ring of 16 words */
+  for(i = 0; i < 64; i++) {
+    if(i < 16) {
+      w[i] = ((uint32_t)block[4 * i] << 24)
+          | ((uint32_t)block[4 * i + 1] << 16)
+          | ((uint32_t)block[4 * i + 2] << 8)
+          | block[4 * i + 3];
+    } else {
+      w[i & 15] += SIGMA_LOWER1(w[(i - 2) & 15])
+          + w[(i - 7) & 15]
+          + SIGMA_LOWER0(w[(i - 15) & 15]);
+    }
+    t1 = h + SIGMA1(e) + CH(e, f, g) + k[i] + w[i & 15];
+    t2 = SIGMA0(a) + MAJ(a, b, c);
+    h = g;
+    g = f;
+    f = e;
+    e = d + t1;
+    d = c;
+    c = b;
+    b = a;
+    a = t1 + t2;
+  }
+
+  ctx->state[0] += a;
+  ctx->state[1] += b;
+  ctx->state[2] += c;
+  ctx->state[3] += d;
+  ctx->state[4] += e;
+  ctx->state[5] += f;
+  ctx->state[6] += g;
+  ctx->state[7] += h;
+  ctx->bit_count += SHA_256_BLOCK_SIZE * 8;
+}
+/*---------------------------------------------------------------------------*/
+static void
+init(sha_256_context_t *ctx)
+{
+  ctx->state[0] = 0x6a09e667;
+  ctx->state[1] = 0xbb67ae85;
+  ctx->state[2] = 0x3c6ef372;
+  ctx->state[3] = 0xa54ff53a;
+  ctx->state[4] = 0x510e527f;
+  ctx->state[5] = 0x9b05688c;
+  ctx->state[6] = 0x1f83d9ab;
+  ctx->state[7] = 0x5be0cd19;
+  ctx->bit_count = 0;
+  ctx->buf_len = 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+update(sha_256_context_t *ctx, const uint8_t *data, size_t len)
+{
+  size_t n;
+
+  if(ctx->buf_len > 0) {
+    n = SHA_256_BLOCK_SIZE - ctx->buf_len;
+    if(n > len) {
+      n = len;
+    }
+    memcpy(ctx->buf + ctx->buf_len, data, n);
+    ctx->buf_len += n;
+    data += n;
+    len -= n;
+    if(ctx->buf_len < SHA_256_BLOCK_SIZE) {
+      return;
+    }
+    compress(ctx, ctx->buf);
+    ctx->buf_len = 0;
+  }
+
+  /* Full blocks are compressed straight from the input */
+  while(len >= SHA_256_BLOCK_SIZE) {
+    compress(ctx, data);
+    data += SHA_256_BLOCK_SIZE;
+    len -= SHA_256_BLOCK_SIZE;
+  }
+
+  memcpy(ctx->buf, data, len);
+  ctx->buf_len = len;
+}
+/*---------------------------------------------------------------------------*/
+static void
+finalize(sha_256_context_t *ctx, uint8_t digest[SHA_256_DIGEST_LENGTH])
+{
+  uint64_t bit_count;
+  uint8_t i;
+
+  bit_count = ctx->bit_count + ctx->buf_len * 8;
+
+  /* Append a 1 bit, zeros, and the message length in bits */
+  ctx->buf[ctx->buf_len++] = 0x80;
+  if(ctx->buf_len > SHA_256_BLOCK_SIZE - 8) {
+    memset(ctx->buf + ctx->buf_len, 0, SHA_256_BLOCK_SIZE - ctx->buf_len);
+    compress(ctx, ctx->buf);
+    ctx->buf_len = 0;
+  }
+  memset(ctx->buf + ctx->buf_len, 0, SHA_256_BLOCK_SIZE - 8 - ctx->buf_len);
+  for(i = 0; i < 8; i++) {
+    ctx->buf[SHA_256_BLOCK_SIZE - 1 - i] = bit_count >> (8 * i);
+  }
+  compress(ctx, ctx->buf);
+
+  for(i = 0; i < SHA_256_DIGEST_LENGTH; i++) {
+    digest[i] = ctx->state[i >> 2] >> (24 - 8 * (i & 3));
+  }
+}
+/*---------------------------------------------------------------------------*/
+const struct sha_256_driver sha_256_driver = {
+  init,
+  update,
+  finalize
+};
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2026, Hasso-Plattner-Institut.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         SHA-256, as defined in FIPS 180-4.
+ */
+
+#ifndef SHA_256_H_
+#define SHA_256_H_
+
+#include "contiki.h"
+
+#include <stddef.h>
+
+#define SHA_256_DIGEST_LENGTH 32
+#define SHA_256_BLOCK_SIZE    64
+
+#ifdef SHA_256_CONF
+#define SHA_256            SHA_256_CONF
+#else /* SHA_256_CONF */
+#define SHA_256            sha_256_driver
+#endif /* SHA_256_CONF */
+
+/**
+ * State of a hash computation. The state can be copied, e.g., to
+ * continue several computations from a common prefix.
+ */
+typedef struct {
+  /** Intermediate hash value, drivers may leave it unset while bit_count is 0 */
+  uint32_t state[8];
+  /** Number of bits in the blocks already compressed into state */
+  uint64_t bit_count;
+  /** Input that does not fill a block yet */
+  uint8_t buf[SHA_256_BLOCK_SIZE];
+  uint8_t buf_len;
+} sha_256_context_t;
+
+/**
+ * Structure of SHA-256 drivers.
+ */
+struct sha_256_driver {
+
+  /**
+   * \brief Starts a hash computation.
+   */
+  void (* init)(sha_256_context_t *ctx);
+
+  /**
+   * \brief Hashes data.
+   */
+  void (* update)(sha_256_context_t *ctx, const uint8_t *data, size_t len);
+
+  /**
+   * \brief Finishes a hash computation.
+   */
+  void (* finalize)(sha_256_context_t *ctx,
+                    uint8_t digest[SHA_256_DIGEST_LENGTH]);
+};
+
+extern const struct sha_256_driver SHA_256;
+
+#endif /* SHA_256_H_ */
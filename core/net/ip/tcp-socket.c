@@ -350,7 +350,10 @@ tcp_socket_send(struct tcp_socket *s,
 
   len = MIN(datalen, s->output_data_maxlen - s->output_data_len);
 
-  memcpy(&s->output_data_ptr[s->output_data_len], data, len);
+  /* The data may already have been written in place */
+  if(data != &s->output_data_ptr[s->output_data_len]) {
+    memcpy(&s->output_data_ptr[s->output_data_len], data, len);
+  }
   s->output_data_len += len;
 
   if(s->output_senddata_len == 0) {
@@ -223,7 +223,8 @@ int tcp_socket_unlisten(struct tcp_socket *s);
  *             sent to the remote host as soon as possiblce. When the
  *             data has been acknowledged by the remote host, the
  *             event callback is sent with the TCP_SOCKET_DATA_SENT
- *             event.
+ *             event. Data that the caller has already written to the
+ *             free part of the output buffer is not copied again.
  */
 int tcp_socket_send(struct tcp_socket *s,
                     const uint8_t *dataptr,
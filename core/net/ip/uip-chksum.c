@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2026, Hasso-Plattner-Institut.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \addtogroup uip
+ * @{
+ */
+
+/**
+ * \file
+ *         Internet checksum computation.
+ */
+
+#include "net/ip/uip-chksum.h"
+#include "net/ip/uip.h"
+
+#include <string.h>
+
+/*---------------------------------------------------------------------------*/
+/* Add b to a in one's complement arithmetic */
+static uint16_t
+add16(uint16_t a, uint16_t b)
+{
+  a += b;
+  return a < b ? a + 1 : a;
+}
+/*---------------------------------------------------------------------------*/
+#if !UIP_ARCH_CHKSUM_ADD
+uint16_t
+uip_chksum_add(uint16_t sum, const uint8_t *data, uint16_t len)
+{
+#if UIP_CHKSUM_WIDE
+  /* Summing words in host byte order gives the byte-swapped sum on
+     little-endian CPUs (RFC 1071, section 2), so the partial sum is
+     converted before and after. */
+  uint64_t acc;
+  uint32_t w32;
+  uint16_t w16;
+
+  acc = uip_htons(sum);
+  while(len >= 16) {
+    memcpy(&w32, data, 4);
+    acc += w32;
+    memcpy(&w32, data + 4, 4);
+    acc += w32;
+    memcpy(&w32, data + 8, 4);
+    acc += w32;
+    memcpy(&w32, data + 12, 4);
+    acc += w32;
+    data += 16;
+    len -= 16;
+  }
+  while(len >= 4) {
+    memcpy(&w32, data, 4);
+    acc += w32;
+    data += 4;
+    len -= 4;
+  }
+  if(len >= 2) {
+    memcpy(&w16, data, 2);
+    acc += w16;
+    data += 2;
+    len -= 2;
+  }
+  if(len == 1) {
+    /* Pad the last byte with a zero byte, in memory order */
+    w16 = 0;
+    memcpy(&w16, data, 1);
+    acc += w16;
+  }
+
+  acc = (acc & 0xffffffff) + (acc >> 32);
+  acc = (acc & 0xffff) + (acc >> 16);
+  acc = (acc & 0xffff) + (acc >> 16);
+  acc = (acc & 0xffff) + (acc >> 16);
+  return uip_ntohs((uint16_t)acc);
+#else /* UIP_CHKSUM_WIDE */
+  /* The carries are collected in the upper half of the accumulator
+     and folded back once at the end. With len below 64 KiB, this
+     cannot overflow. */
+  uint32_t acc;
+
+  acc = sum;
+  while(len >= 2) {
+    acc += ((uint16_t)data[0] << 8) | data[1];
+    data += 2;
+    len -= 2;
+  }
+  if(len == 1) {
+    acc += (uint16_t)data[0] << 8;
+  }
+
+  acc = (acc & 0xffff) + (acc >> 16);
+  acc = (acc & 0xffff) + (acc >> 16);
+  return (uint16_t)acc;
+#endif /* UIP_CHKSUM_WIDE */
+}
+#endif /* !UIP_ARCH_CHKSUM_ADD */
+/*---------------------------------------------------------------------------*/
+uint16_t
+uip_chksum_adjust(uint16_t chksum, uint16_t old_sum, uint16_t new_sum)
+{
+  /* HC' = ~(~HC + ~m + m'), RFC 1624, equation 3 */
+  return ~add16(add16(~chksum, ~old_sum), new_sum);
+}
+/*---------------------------------------------------------------------------*/
+/** @} */
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2026, Hasso-Plattner-Institut.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \addtogroup uip
+ * @{
+ */
+
+/**
+ * \file
+ *         Internet checksum computation, as defined in RFC 1071, and
+ *         incremental checksum updates, as defined in RFC 1624.
+ */
+
+#ifndef UIP_CHKSUM_H_
+#define UIP_CHKSUM_H_
+
+#include "contiki-conf.h"
+#include <stdint.h>
+
+/**
+ * If enabled, the portable checksum implementation sums 32-bit words
+ * into a 64-bit accumulator. This pays off on 32- and 64-bit CPUs, but
+ * not on 8- and 16-bit CPUs, which sum 16-bit words instead.
+ */
+#ifdef UIP_CONF_CHKSUM_WIDE
+#define UIP_CHKSUM_WIDE UIP_CONF_CHKSUM_WIDE
+#else /* UIP_CONF_CHKSUM_WIDE */
+#define UIP_CHKSUM_WIDE 0
+#endif /* UIP_CONF_CHKSUM_WIDE */
+
+/**
+ * Add the one's complement sum of a buffer to a partial sum.
+ *
+ * Architectures may provide an optimized implementation of this
+ * function by setting UIP_ARCH_CHKSUM_ADD to 1.
+ *
+ * \param sum The partial sum to add to, in host byte order.
+ * \param data A pointer to the buffer. It need not be aligned.
+ * \param len The length of the buffer. If odd, the buffer is padded
+ * with a zero byte.
+ * \return The new partial sum, in host byte order.
+ */
+uint16_t uip_chksum_add(uint16_t sum, const uint8_t *data, uint16_t len);
+
+/**
+ * Incrementally update a checksum after rewriting packet fields.
+ *
+ * \param chksum The checksum field before the rewrite, in host byte
+ * order.
+ * \param old_sum The one's complement sum of the fields before the
+ * rewrite, as returned by uip_chksum_add().
+ * \param new_sum The one's complement sum of the fields after the
+ * rewrite.
+ * \return The new value of the checksum field, in host byte order.
+ */
+uint16_t uip_chksum_adjust(uint16_t chksum, uint16_t old_sum, uint16_t new_sum);
+
+#endif /* UIP_CHKSUM_H_ */
+
+/** @} */
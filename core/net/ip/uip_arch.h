@@ -103,6 +103,13 @@ void uip_add32(uint8_t *op32, uint16_t op16);
  */
 uint16_t uip_chksum(uint16_t *data, uint16_t len);
 
+/*
+ * uip_chksum_add(), declared in uip-chksum.h, is used by the portable
+ * implementations of the checksum functions above. Architectures that
+ * only need a faster inner summing loop can provide it instead, by
+ * defining UIP_ARCH_CHKSUM_ADD to 1.
+ */
+
 /**
  * Calculate the IP header checksum of the packet header in uip_buf.
  *
@@ -61,6 +61,7 @@
 #include "ip64-slip-interface.h"
 #include "ip64-dns64.h"
 #include "net/ipv6/uip-ds6.h"
+#include "net/ip/uip-chksum.h"
 #include "ip64-ipv4-dhcp.h"
 #include "contiki-net.h"
 
@@ -269,42 +270,11 @@ ip64_set_ipv6_address(const uip_ip6addr_t *addr)
 }
 /*---------------------------------------------------------------------------*/
 static uint16_t
-chksum(uint16_t sum, const uint8_t *data, uint16_t len)
-{
-  uint16_t t;
-  const uint8_t *dataptr;
-  const uint8_t *last_byte;
-
-  dataptr = data;
-  last_byte = data + len - 1;
-
-  while(dataptr < last_byte) {	/* At least two more bytes */
-    t = (dataptr[0] << 8) + dataptr[1];
-    sum += t;
-    if(sum < t) {
-      sum++;		/* carry */
-    }
-    dataptr += 2;
-  }
-
-  if(dataptr == last_byte) {
-    t = (dataptr[0] << 8) + 0;
-    sum += t;
-    if(sum < t) {
-      sum++;		/* carry */
-    }
-  }
-
-  /* Return sum in host byte order. */
-  return sum;
-}
-/*---------------------------------------------------------------------------*/
-static uint16_t
 ipv4_checksum(struct ipv4_hdr *hdr)
 {
   uint16_t sum;
 
-  sum = chksum(0, (uint8_t *)hdr, IPV4_HDRLEN);
+  sum = uip_chksum_add(0, (uint8_t *)hdr, IPV4_HDRLEN);
   return (sum == 0) ? 0xffff : uip_htons(sum);
 }
 /*---------------------------------------------------------------------------*/
@@ -323,14 +293,15 @@ ipv4_transport_checksum(const uint8_t *packet, uint16_t len, uint8_t proto)
     /* IP protocol and length fields. This addition cannot carry. */
     sum = transport_layer_len + proto;
     /* Sum IP source and destination addresses. */
-    sum = chksum(sum, (uint8_t *)&v4hdr->srcipaddr, 2 * sizeof(uip_ip4addr_t));
+    sum = uip_chksum_add(sum, (uint8_t *)&v4hdr->srcipaddr,
+                         2 * sizeof(uip_ip4addr_t));
   } else {
     /* ping replies' checksums are calculated over the icmp-part only */
     sum = 0;
   }
 
   /* Sum transport layer header and data. */
-  sum = chksum(sum, &packet[IPV4_HDRLEN], transport_layer_len);
+  sum = uip_chksum_add(sum, &packet[IPV4_HDRLEN], transport_layer_len);
 
   return (sum == 0) ? 0xffff : uip_htons(sum);
 }
@@ -349,15 +320,36 @@ ipv6_transport_checksum(const uint8_t *packet, uint16_t len, uint8_t proto)
   /* IP protocol and length fields. This addition cannot carry. */
   sum = transport_layer_len + proto;
   /* Sum IP source and destination addresses. */
-  sum = chksum(sum, (uint8_t *)&v6hdr->srcipaddr, sizeof(uip_ip6addr_t));
-  sum = chksum(sum, (uint8_t *)&v6hdr->destipaddr, sizeof(uip_ip6addr_t));
+  sum = uip_chksum_add(sum, (uint8_t *)&v6hdr->srcipaddr, sizeof(uip_ip6addr_t));
+  sum = uip_chksum_add(sum, (uint8_t *)&v6hdr->destipaddr, sizeof(uip_ip6addr_t));
 
   /* Sum transport layer header and data. */
-  sum = chksum(sum, &packet[IPV6_HDRLEN], transport_layer_len);
+  sum = uip_chksum_add(sum, &packet[IPV6_HDRLEN], transport_layer_len);
 
   return (sum == 0) ? 0xffff : uip_htons(sum);
 }
 /*---------------------------------------------------------------------------*/
+/* Update a TCP or UDP checksum after the addresses of the pseudo
+   header and the port numbers have been rewritten, as in RFC 1624,
+   instead of summing the whole payload again. The length and protocol
+   fields of the pseudo header are the same for IPv4 and IPv6. */
+static uint16_t
+transport_checksum_adjust(uint16_t chksum,
+                          const uint8_t *oldaddrs, uint8_t oldaddrslen,
+                          const uint8_t *oldports,
+                          const uint8_t *newaddrs, uint8_t newaddrslen,
+                          const uint8_t *newports)
+{
+  uint16_t old_sum, new_sum;
+
+  old_sum = uip_chksum_add(0, oldaddrs, oldaddrslen);
+  old_sum = uip_chksum_add(old_sum, oldports, 4);
+  new_sum = uip_chksum_add(0, newaddrs, newaddrslen);
+  new_sum = uip_chksum_add(new_sum, newports, 4);
+
+  return uip_htons(uip_chksum_adjust(uip_ntohs(chksum), old_sum, new_sum));
+}
+/*---------------------------------------------------------------------------*/
 int
 ip64_6to4(const uint8_t *ipv6packet, const uint16_t ipv6packet_len,
 	  uint8_t *resultpacket)
@@ -370,6 +362,7 @@ ip64_6to4(const uint8_t *ipv6packet, const uint16_t ipv6packet_len,
   struct icmpv6_hdr *icmpv6hdr;
   uint16_t ipv6len, ipv4len;
   struct ip64_addrmap_entry *m;
+  uint8_t adjust_chksum;
 
   v6hdr = (struct ipv6_hdr *)ipv6packet;
   v4hdr = (struct ipv4_hdr *)resultpacket;
@@ -420,19 +413,22 @@ ip64_6to4(const uint8_t *ipv6packet, const uint16_t ipv6packet_len,
      IPv6 next header numbers, the ICMPv4 and ICMPv6 numbers are
      different so we cannot simply copy the contents of the IPv6 next
      header field. */
+  adjust_chksum = 0;
   switch(v6hdr->nxthdr) {
   case IP_PROTO_TCP:
     PRINTF("ip64_6to4: TCP header\n");
     v4hdr->proto = IP_PROTO_TCP;
 
-    /* Compute and check the TCP checksum - since we're going to
-       recompute it ourselves, we must ensure that it was correct in
-       the first place. */
+#if DEBUG
+    /* Compute and check the TCP checksum. The checksum is updated
+       incrementally below, so an incorrect checksum stays incorrect
+       and the packet is dropped by the receiver. */
     if(ipv6_transport_checksum(ipv6packet, ipv6len,
                                IP_PROTO_TCP) != 0xffff) {
-      PRINTF("Bad TCP checksum, dropping packet\n");
+      PRINTF("Bad TCP checksum\n");
     }
-
+#endif /* DEBUG */
+    adjust_chksum = 1;
     break;
 
   case IP_PROTO_UDP:
@@ -446,14 +442,17 @@ ip64_6to4(const uint8_t *ipv6packet, const uint16_t ipv6packet_len,
                       ipv6len - IPV6_HDRLEN - sizeof(struct udp_hdr),
                       (uint8_t *)udphdr + sizeof(struct udp_hdr),
                       BUFSIZE - IPV4_HDRLEN - sizeof(struct udp_hdr));
+    } else {
+      /* Only rewritten DNS requests need a full checksum. */
+      adjust_chksum = 1;
     }
-    /* Compute and check the UDP checksum - since we're going to
-       recompute it ourselves, we must ensure that it was correct in
-       the first place. */
+#if DEBUG
+    /* Compute and check the UDP checksum. */
     if(ipv6_transport_checksum(ipv6packet, ipv6len,
                                IP_PROTO_UDP) != 0xffff) {
-      PRINTF("Bad UDP checksum, dropping packet\n");
+      PRINTF("Bad UDP checksum\n");
     }
+#endif /* DEBUG */
     break;
 
   case IP_PROTO_ICMPV6:
@@ -619,14 +618,36 @@ ip64_6to4(const uint8_t *ipv6packet, const uint16_t ipv6packet_len,
      field. */
   switch(v4hdr->proto) {
   case IP_PROTO_TCP:
-    tcphdr->tcpchksum = 0;
-    tcphdr->tcpchksum = ~(ipv4_transport_checksum(resultpacket, ipv4len,
-						  IP_PROTO_TCP));
+    if(adjust_chksum) {
+      tcphdr->tcpchksum =
+        transport_checksum_adjust(tcphdr->tcpchksum,
+                                  (uint8_t *)&v6hdr->srcipaddr,
+                                  2 * sizeof(uip_ip6addr_t),
+                                  &ipv6packet[IPV6_HDRLEN],
+                                  (uint8_t *)&v4hdr->srcipaddr,
+                                  2 * sizeof(uip_ip4addr_t),
+                                  (uint8_t *)tcphdr);
+    } else {
+      tcphdr->tcpchksum = 0;
+      tcphdr->tcpchksum = ~(ipv4_transport_checksum(resultpacket, ipv4len,
+						    IP_PROTO_TCP));
+    }
     break;
   case IP_PROTO_UDP:
-    udphdr->udpchksum = 0;
-    udphdr->udpchksum = ~(ipv4_transport_checksum(resultpacket, ipv4len,
-						  IP_PROTO_UDP));
+    if(adjust_chksum) {
+      udphdr->udpchksum =
+        transport_checksum_adjust(udphdr->udpchksum,
+                                  (uint8_t *)&v6hdr->srcipaddr,
+                                  2 * sizeof(uip_ip6addr_t),
+                                  &ipv6packet[IPV6_HDRLEN],
+                                  (uint8_t *)&v4hdr->srcipaddr,
+                                  2 * sizeof(uip_ip4addr_t),
+                                  (uint8_t *)udphdr);
+    } else {
+      udphdr->udpchksum = 0;
+      udphdr->udpchksum = ~(ipv4_transport_checksum(resultpacket, ipv4len,
+						    IP_PROTO_UDP));
+    }
     if(udphdr->udpchksum == 0) {
       udphdr->udpchksum = 0xffff;
     }
@@ -659,6 +680,7 @@ ip64_4to6(const uint8_t *ipv4packet, const uint16_t ipv4packet_len,
   struct icmpv6_hdr *icmpv6hdr;
   uint16_t ipv4len, ipv6len, ipv6_packet_len;
   struct ip64_addrmap_entry *m;
+  uint8_t adjust_chksum;
 
   v6hdr = (struct ipv6_hdr *)resultpacket;
   v4hdr = (struct ipv4_hdr *)ipv4packet;
@@ -725,6 +747,7 @@ ip64_4to6(const uint8_t *ipv4packet, const uint16_t ipv4packet_len,
 
     /* For the next header field, we simply use the IPv4 protocol
      field. We only support UDP and TCP packets. */
+  adjust_chksum = 0;
   switch(v4hdr->proto) {
   case IP_PROTO_UDP:
     v6hdr->nxthdr = IP_PROTO_UDP;
@@ -742,11 +765,16 @@ ip64_4to6(const uint8_t *ipv4packet, const uint16_t ipv4packet_len,
       v6hdr->len[1] = ipv6_packet_len & 0xff;
       ipv6len = ipv6_packet_len + IPV6_HDRLEN;
 
+    } else if(udphdr->udpchksum != 0) {
+      /* A zero UDP checksum means that the IPv4 sender did not
+         compute one, so there is nothing to update. */
+      adjust_chksum = 1;
     }
     break;
 
   case IP_PROTO_TCP:
     v6hdr->nxthdr = IP_PROTO_TCP;
+    adjust_chksum = 1;
     break;
 
   case IP_PROTO_ICMPV4:
@@ -854,16 +882,38 @@ ip64_4to6(const uint8_t *ipv4packet, const uint16_t ipv4packet_len,
      field. */
   switch(v6hdr->nxthdr) {
   case IP_PROTO_TCP:
-    tcphdr->tcpchksum = 0;
-    tcphdr->tcpchksum = ~(ipv6_transport_checksum(resultpacket,
-						  ipv6len,
-						  IP_PROTO_TCP));
+    if(adjust_chksum) {
+      tcphdr->tcpchksum =
+        transport_checksum_adjust(tcphdr->tcpchksum,
+                                  (uint8_t *)&v4hdr->srcipaddr,
+                                  2 * sizeof(uip_ip4addr_t),
+                                  &ipv4packet[IPV4_HDRLEN],
+                                  (uint8_t *)&v6hdr->srcipaddr,
+                                  2 * sizeof(uip_ip6addr_t),
+                                  (uint8_t *)tcphdr);
+    } else {
+      tcphdr->tcpchksum = 0;
+      tcphdr->tcpchksum = ~(ipv6_transport_checksum(resultpacket,
+						    ipv6len,
+						    IP_PROTO_TCP));
+    }
     break;
   case IP_PROTO_UDP:
-    udphdr->udpchksum = 0;
-    udphdr->udpchksum = ~(ipv6_transport_checksum(resultpacket,
-						  ipv6len,
-						  IP_PROTO_UDP));
+    if(adjust_chksum) {
+      udphdr->udpchksum =
+        transport_checksum_adjust(udphdr->udpchksum,
+                                  (uint8_t *)&v4hdr->srcipaddr,
+                                  2 * sizeof(uip_ip4addr_t),
+                                  &ipv4packet[IPV4_HDRLEN],
+                                  (uint8_t *)&v6hdr->srcipaddr,
+                                  2 * sizeof(uip_ip6addr_t),
+                                  (uint8_t *)udphdr);
+    } else {
+      udphdr->udpchksum = 0;
+      udphdr->udpchksum = ~(ipv6_transport_checksum(resultpacket,
+						    ipv6len,
+						    IP_PROTO_UDP));
+    }
     if(udphdr->udpchksum == 0) {
       udphdr->udpchksum = 0xffff;
     }
@@ -69,6 +69,10 @@
 #include "net/rime/rime.h"
 #include "net/ipv6/sicslowpan.h"
 #include "net/netstack.h"
+#if UIP_CONF_IPV6_RPL
+#include "net/rpl/rpl.h"
+#include "net/rpl/rpl-dag-root.h"
+#endif /* UIP_CONF_IPV6_RPL */
 
 #include <stdio.h>
 
@@ -217,6 +221,9 @@ static int last_rssi;
 /* Support for reassembling multiple packets                         */
 /* ----------------------------------------------------------------- */
 
+/* Defined without fragmentation too, so readers of the stats still link */
+struct sicslowpan_reass_stats sicslowpan_reass_stats;
+
 #if SICSLOWPAN_CONF_FRAG
 static uint16_t my_tag;
 
@@ -231,9 +238,9 @@ static uint16_t my_tag;
 #endif
 
 /* REASS_CONTEXTS corresponds to the number of simultaneous
- * reassemblies that can be made. NOTE: the first buffer for each
- * reassembly is stored in the context since it can be larger than the
- * rest of the fragments due to header compression.
+ * reassemblies that can be made. A context only holds the bookkeeping
+ * of a reassembly; the fragments themselves are stored in the buffer
+ * pools below, so contexts are cheap to add.
  **/
 #ifdef SICSLOWPAN_CONF_REASS_CONTEXTS
 #define SICSLOWPAN_REASS_CONTEXTS SICSLOWPAN_CONF_REASS_CONTEXTS
@@ -241,6 +248,33 @@ static uint16_t my_tag;
 #define SICSLOWPAN_REASS_CONTEXTS 2
 #endif
 
+/* The number of buffers for first fragments. These are larger than the
+ * rest of the fragment buffers due to header compression. */
+#ifdef SICSLOWPAN_CONF_FIRST_FRAGMENT_BUFFERS
+#define SICSLOWPAN_FIRST_FRAGMENT_BUFFERS SICSLOWPAN_CONF_FIRST_FRAGMENT_BUFFERS
+#else
+#define SICSLOWPAN_FIRST_FRAGMENT_BUFFERS SICSLOWPAN_REASS_CONTEXTS
+#endif
+
+/* With FRAG_FORWARDING, a router forwards the fragments of a packet that
+ * is not for itself as they arrive, once the first fragment has given the
+ * route, instead of reassembling the packet for uIP first. Packets with a
+ * RPL hop-by-hop option are forwarded too, except by the DODAG root.
+ * Packets with any other extension header, such as the source routing
+ * header of non-storing mode downward traffic, are still reassembled.
+ * FRAG_FORWARD_ENTRIES is the number of packets forwarded at once. */
+#ifdef SICSLOWPAN_CONF_FRAG_FORWARDING
+#define SICSLOWPAN_FRAG_FORWARDING SICSLOWPAN_CONF_FRAG_FORWARDING
+#else
+#define SICSLOWPAN_FRAG_FORWARDING 0
+#endif
+
+#ifdef SICSLOWPAN_CONF_FRAG_FORWARD_ENTRIES
+#define SICSLOWPAN_FRAG_FORWARD_ENTRIES SICSLOWPAN_CONF_FRAG_FORWARD_ENTRIES
+#else
+#define SICSLOWPAN_FRAG_FORWARD_ENTRIES 4
+#endif
+
 /* The size of each fragment (IP payload) for the 6lowpan fragmentation */
 #ifdef SICSLOWPAN_CONF_FRAGMENT_SIZE
 #define SICSLOWPAN_FRAGMENT_SIZE SICSLOWPAN_CONF_FRAGMENT_SIZE
@@ -251,6 +285,11 @@ static uint16_t my_tag;
 /* Assuming that the worst growth for uncompression is 38 bytes */
 #define SICSLOWPAN_FIRST_FRAGMENT_SIZE (SICSLOWPAN_FRAGMENT_SIZE + 38)
 
+/* The largest packet that can be reassembled, and the number of 8-byte
+   units it spans (fragment offsets are counted in such units) */
+#define SICSLOWPAN_REASS_MAX_LEN (UIP_BUFSIZE - UIP_LLH_LEN)
+#define SICSLOWPAN_REASS_UNITS ((SICSLOWPAN_REASS_MAX_LEN + 7) / 8)
+
 /* all information needed for reassembly */
 struct sicslowpan_frag_info {
   /** When reassembling, the source address of the fragments being merged */
@@ -261,20 +300,30 @@ struct sicslowpan_frag_info {
   uint16_t tag;
   /** Total length of the fragmented packet */
   uint16_t len;
-  /** Current length of reassembled fragments */
-  uint16_t reassembled_len;
+  /** Number of 8-byte units of the packet received so far */
+  uint16_t covered_units;
+  /** One bit per 8-byte unit of the packet, set once it is received */
+  uint8_t covered[(SICSLOWPAN_REASS_UNITS + 7) / 8];
   /** Reassembly %process %timer. */
   struct timer reass_timer;
 
-  /** Fragment size of first fragment */
+  /** Fragment size of first fragment, 0 until it is received */
   uint16_t first_frag_len;
-  /** First fragment - needs a larger buffer since the size is uncompressed size
-   and we need to know total size to know when we have received last fragment. */
-  uint8_t first_frag[SICSLOWPAN_FIRST_FRAGMENT_SIZE];
 };
 
 static struct sicslowpan_frag_info frag_info[SICSLOWPAN_REASS_CONTEXTS];
 
+struct sicslowpan_first_frag_buf {
+  /* the index of the frag_info */
+  uint8_t index;
+  /* Length of the uncompressed fragment (if zero this buffer is not allocated) */
+  uint16_t len;
+  /* First fragment - needs a larger buffer since the size is uncompressed size */
+  uint8_t data[SICSLOWPAN_FIRST_FRAGMENT_SIZE];
+};
+
+static struct sicslowpan_first_frag_buf first_frag_buf[SICSLOWPAN_FIRST_FRAGMENT_BUFFERS];
+
 struct sicslowpan_frag_buf {
   /* the index of the frag_info */
   uint8_t index;
@@ -289,11 +338,16 @@ static struct sicslowpan_frag_buf frag_buf[SICSLOWPAN_FRAGMENT_BUFFERS];
 
 /*---------------------------------------------------------------------------*/
 static int
-clear_fragments(uint8_t frag_info_index)
+free_fragments(uint8_t frag_info_index)
 {
   int i, clear_count;
   clear_count = 0;
-  frag_info[frag_info_index].len = 0;
+  for(i = 0; i < SICSLOWPAN_FIRST_FRAGMENT_BUFFERS; i++) {
+    if(first_frag_buf[i].len > 0 && first_frag_buf[i].index == frag_info_index) {
+      first_frag_buf[i].len = 0;
+      clear_count++;
+    }
+  }
   for(i = 0; i < SICSLOWPAN_FRAGMENT_BUFFERS; i++) {
     if(frag_buf[i].len > 0 && frag_buf[i].index == frag_info_index) {
       /* deallocate the buffer */
@@ -305,6 +359,21 @@ clear_fragments(uint8_t frag_info_index)
 }
 /*---------------------------------------------------------------------------*/
 static int
+clear_fragments(uint8_t frag_info_index)
+{
+  frag_info[frag_info_index].len = 0;
+  return free_fragments(frag_info_index);
+}
+/*---------------------------------------------------------------------------*/
+/* A reassembled context is kept until it expires so that fragments
+   received again after the packet was delivered are still dropped */
+static int
+is_reassembled(int context)
+{
+  return frag_info[context].covered_units == (frag_info[context].len + 7) / 8;
+}
+/*---------------------------------------------------------------------------*/
+static int
 timeout_fragments(int not_context)
 {
   int i;
@@ -313,6 +382,9 @@ timeout_fragments(int not_context)
     if(frag_info[i].len > 0 && i != not_context &&
        timer_expired(&frag_info[i].reass_timer)) {
       /* This context can be freed */
+      if(!is_reassembled(i)) {
+        sicslowpan_reass_stats.timeouts++;
+      }
       count += clear_fragments(i);
     }
   }
@@ -341,76 +413,116 @@ store_fragment(uint8_t index, uint8_t offset)
   return -1;
 }
 /*---------------------------------------------------------------------------*/
-/* add a new fragment to the buffer */
+/* Returns a free first fragment buffer for a context. The buffer is only
+   allocated once its length is set, after uncompression succeeded. */
+static struct sicslowpan_first_frag_buf *
+get_first_frag_buf(uint8_t index)
+{
+  int i;
+  for(i = 0; i < SICSLOWPAN_FIRST_FRAGMENT_BUFFERS; i++) {
+    if(first_frag_buf[i].len == 0) {
+      first_frag_buf[i].index = index;
+      return &first_frag_buf[i];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+/* Counts the 8-byte units in bytes [start, end) of a packet that have not
+   been received yet, and marks them as received if mark is set. A fragment
+   that does not end the packet only covers its complete units. */
+static uint16_t
+cover_fragment(int context, uint16_t start, uint16_t end, uint8_t mark)
+{
+  struct sicslowpan_frag_info *info = &frag_info[context];
+  uint16_t unit, last, count;
+
+  if(end >= info->len) {
+    last = (info->len + 7) / 8;
+  } else {
+    last = end / 8;
+  }
+  count = 0;
+  for(unit = start / 8; unit < last; unit++) {
+    if((info->covered[unit / 8] & (1 << (unit & 7))) == 0) {
+      if(mark) {
+        info->covered[unit / 8] |= 1 << (unit & 7);
+      }
+      count++;
+    }
+  }
+  if(mark) {
+    info->covered_units += count;
+  }
+  return count;
+}
+/*---------------------------------------------------------------------------*/
+/* Finds the reassembly context of a fragment, or starts a new one. Any
+   fragment may start it, since they all carry the packet size. */
 static int8_t
 add_fragment(uint16_t tag, uint16_t frag_size, uint8_t offset)
 {
   int i;
-  int len;
   int8_t found = -1;
+  int8_t free_context = -1;
+  int8_t done_context = -1;
 
-  if(offset == 0) {
-    /* This is a first fragment - check if we can add this */
-    for(i = 0; i < SICSLOWPAN_REASS_CONTEXTS; i++) {
-      /* clear all fragment info with expired timer to free all fragment buffers */
-      if(frag_info[i].len > 0 && timer_expired(&frag_info[i].reass_timer)) {
-	clear_fragments(i);
+  if(frag_size == 0 || frag_size > SICSLOWPAN_REASS_MAX_LEN) {
+    PRINTF("*** Fragmented packet too large - tag: %d size: %d\n", tag, frag_size);
+    return -1;
+  }
+
+  for(i = 0; i < SICSLOWPAN_REASS_CONTEXTS; i++) {
+    /* clear all fragment info with expired timer to free all fragment buffers */
+    if(frag_info[i].len > 0 && timer_expired(&frag_info[i].reass_timer)) {
+      if(!is_reassembled(i)) {
+        sicslowpan_reass_stats.timeouts++;
       }
+      clear_fragments(i);
+    }
 
-      /* We use len as indication on used or not used */
-      if(found < 0 && frag_info[i].len == 0) {
+    /* We use len as indication on used or not used */
+    if(frag_info[i].len == 0) {
+      if(free_context < 0) {
         /* We remember the first free fragment info but must continue
            the loop to free any other expired fragment buffers. */
-        found = i;
+        free_context = i;
       }
-    }
-
-    if(found < 0) {
-      PRINTF("*** Failed to store new fragment session - tag: %d\n", tag);
-      return -1;
-    }
-
-    /* Found a free fragment info to store data in */
-    frag_info[found].len = frag_size;
-    frag_info[found].tag = tag;
-    linkaddr_copy(&frag_info[found].sender,
-                  packetbuf_addr(PACKETBUF_ADDR_SENDER));
-    timer_set(&frag_info[found].reass_timer, SICSLOWPAN_REASS_MAXAGE * CLOCK_SECOND / 16);
-    /* first fragment can not be stored immediately but is moved into
-       the buffer while uncompressing */
-    return found;
-  }
-
-  /* This is a N-fragment - should find the info */
-  for(i = 0; i < SICSLOWPAN_REASS_CONTEXTS; i++) {
-    if(frag_info[i].tag == tag && frag_info[i].len > 0 &&
-       linkaddr_cmp(&frag_info[i].sender, packetbuf_addr(PACKETBUF_ADDR_SENDER))) {
+    } else if(found < 0 && frag_info[i].tag == tag &&
+              linkaddr_cmp(&frag_info[i].sender, packetbuf_addr(PACKETBUF_ADDR_SENDER))) {
       /* Tag and Sender match - this must be the correct info to store in */
       found = i;
-      break;
+    } else if(done_context < 0 && is_reassembled(i)) {
+      done_context = i;
     }
   }
 
-  if(found < 0) {
-    /* no entry found for storing the new fragment */
-    PRINTF("*** Failed to store N-fragment - could not find session - tag: %d offset: %d\n", tag, offset);
-    return -1;
+  if(found >= 0) {
+    return found;
   }
 
-  /* i is the index of the reassembly context */
-  len = store_fragment(i, offset);
-  if(len < 0 && timeout_fragments(i) > 0) {
-    len = store_fragment(i, offset);
+  if(free_context < 0) {
+    /* Reuse a context whose packet has already been delivered */
+    free_context = done_context;
   }
-  if(len > 0) {
-    frag_info[i].reassembled_len += len;
-    return i;
-  } else {
-    /* should we also clear all fragments since we failed to store
-       this fragment? */
-    PRINTF("*** Failed to store fragment - packet reassembly will fail tag:%d l\n", frag_info[i].tag);
+
+  if(free_context < 0) {
+    PRINTF("*** Failed to store new fragment session - tag: %d offset: %d\n", tag, offset);
+    sicslowpan_reass_stats.contexts_exhausted++;
     return -1;
   }
+
+  /* Found a free fragment info to store data in */
+  found = free_context;
+  frag_info[found].len = frag_size;
+  frag_info[found].tag = tag;
+  frag_info[found].covered_units = 0;
+  frag_info[found].first_frag_len = 0;
+  memset(frag_info[found].covered, 0, sizeof(frag_info[found].covered));
+  linkaddr_copy(&frag_info[found].sender,
+                packetbuf_addr(PACKETBUF_ADDR_SENDER));
+  timer_set(&frag_info[found].reass_timer, SICSLOWPAN_REASS_MAXAGE * CLOCK_SECOND / 16);
+  return found;
 }
 /*---------------------------------------------------------------------------*/
 /* Copy all the fragments that are associated with a specific context
@@ -420,9 +532,13 @@ copy_frags2uip(int context)
 {
   int i;
 
-  /* Copy from the fragment context info buffer first */
-  memcpy((uint8_t *)UIP_IP_BUF, (uint8_t *)frag_info[context].first_frag,
-	 frag_info[context].first_frag_len);
+  /* Copy from the first fragment buffer first */
+  for(i = 0; i < SICSLOWPAN_FIRST_FRAGMENT_BUFFERS; i++) {
+    if(first_frag_buf[i].len > 0 && first_frag_buf[i].index == context) {
+      memcpy((uint8_t *)UIP_IP_BUF, first_frag_buf[i].data, first_frag_buf[i].len);
+      break;
+    }
+  }
   for(i = 0; i < SICSLOWPAN_FRAGMENT_BUFFERS; i++) {
     /* And also copy all matching fragments */
     if(frag_buf[i].len > 0 && frag_buf[i].index == context) {
@@ -430,9 +546,12 @@ copy_frags2uip(int context)
 	     (uint8_t *)frag_buf[i].data, frag_buf[i].len);
     }
   }
-  /* deallocate all the fragments for this context */
-  clear_fragments(context);
+  /* deallocate all the fragments for this context, the context itself
+     stays to catch duplicates */
+  free_fragments(context);
 }
+#else /* SICSLOWPAN_CONF_FRAG */
+#define SICSLOWPAN_FRAG_FORWARDING 0
 #endif /* SICSLOWPAN_CONF_FRAG */
 
 /* -------------------------------------------------------------------------- */
@@ -1262,6 +1381,32 @@ send_packet(linkaddr_t *dest)
   watchdog_periodic();
 }
 /*--------------------------------------------------------------------*/
+/**
+ * \brief Returns the room for 6lowpan headers and payload in a frame.
+ * \param dest the link layer destination address of the frame
+ */
+static int
+get_max_payload(linkaddr_t *dest)
+{
+  int framer_hdrlen;
+
+  /* Calculate NETSTACK_FRAMER's header length, that will be added in the NETSTACK_RDC.
+   * We calculate it here only to make a better decision of whether the outgoing packet
+   * needs to be fragmented or not. */
+#ifndef SICSLOWPAN_USE_FIXED_HDRLEN
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, dest);
+  framer_hdrlen = NETSTACK_FRAMER.length();
+  if(framer_hdrlen < 0) {
+    /* Framing failed, we assume the maximum header length */
+    framer_hdrlen = SICSLOWPAN_FIXED_HDRLEN;
+  }
+#else /* USE_FRAMER_HDRLEN */
+  framer_hdrlen = SICSLOWPAN_FIXED_HDRLEN;
+#endif /* USE_FRAMER_HDRLEN */
+
+  return MAC_MAX_PAYLOAD - framer_hdrlen;
+}
+/*--------------------------------------------------------------------*/
 /** \brief Take an IP packet and format it to be sent on an 802.15.4
  *  network using 6lowpan.
  *  \param localdest The MAC address of the destination
@@ -1274,7 +1419,6 @@ send_packet(linkaddr_t *dest)
 static uint8_t
 output(const uip_lladdr_t *localdest)
 {
-  int framer_hdrlen;
   int max_payload;
 
   /* The MAC address of the destination of the packet */
@@ -1337,21 +1481,7 @@ output(const uip_lladdr_t *localdest)
   }
   PRINTFO("sicslowpan output: header of len %d\n", packetbuf_hdr_len);
 
-  /* Calculate NETSTACK_FRAMER's header length, that will be added in the NETSTACK_RDC.
-   * We calculate it here only to make a better decision of whether the outgoing packet
-   * needs to be fragmented or not. */
-#ifndef SICSLOWPAN_USE_FIXED_HDRLEN
-  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &dest);
-  framer_hdrlen = NETSTACK_FRAMER.length();
-  if(framer_hdrlen < 0) {
-    /* Framing failed, we assume the maximum header length */
-    framer_hdrlen = SICSLOWPAN_FIXED_HDRLEN;
-  }
-#else /* USE_FRAMER_HDRLEN */
-  framer_hdrlen = SICSLOWPAN_FIXED_HDRLEN;
-#endif /* USE_FRAMER_HDRLEN */
-
-  max_payload = MAC_MAX_PAYLOAD - framer_hdrlen;
+  max_payload = get_max_payload(&dest);
   if((int)uip_len - (int)uncomp_hdr_len > max_payload - (int)packetbuf_hdr_len) {
 #if SICSLOWPAN_CONF_FRAG
     /* Number of bytes processed. */
@@ -1487,6 +1617,310 @@ output(const uip_lladdr_t *localdest)
   return 1;
 }
 
+#if SICSLOWPAN_FRAG_FORWARDING
+/*--------------------------------------------------------------------*/
+/** \name Fragment forwarding
+ * @{                                                                 */
+/*--------------------------------------------------------------------*/
+/* A packet forwarded fragment by fragment. Tags are only unique per
+   sender, so its fragments get one of our tags on the next hop. */
+struct sicslowpan_frag_fwd {
+  /** The previous hop and its tag for the packet */
+  linkaddr_t sender;
+  uint16_t tag;
+  /** The next hop and our tag for the packet */
+  linkaddr_t next_hop;
+  uint16_t out_tag;
+  /** Total length of the packet (if zero this entry is not used) */
+  uint16_t len;
+  /** Number of 8-byte units of the packet forwarded so far */
+  uint16_t forwarded_units;
+  /** One bit per 8-byte unit of the packet, set once it is forwarded */
+  uint8_t forwarded[(SICSLOWPAN_REASS_UNITS + 7) / 8];
+  /** The packet is dropped fragment by fragment */
+  uint8_t drop;
+  struct timer timer;
+};
+
+static struct sicslowpan_frag_fwd frag_fwd[SICSLOWPAN_FRAG_FORWARD_ENTRIES];
+
+/* Holds the payload of a fragment while packetbuf is rebuilt around it */
+static uint8_t fwd_payload[PACKETBUF_SIZE];
+/*--------------------------------------------------------------------*/
+static struct sicslowpan_frag_fwd *
+fwd_lookup(uint16_t tag)
+{
+  int i;
+
+  for(i = 0; i < SICSLOWPAN_FRAG_FORWARD_ENTRIES; i++) {
+    if(frag_fwd[i].len > 0 && frag_fwd[i].tag == tag &&
+       linkaddr_cmp(&frag_fwd[i].sender, packetbuf_addr(PACKETBUF_ADDR_SENDER))) {
+      if(timer_expired(&frag_fwd[i].timer)) {
+        frag_fwd[i].len = 0;
+        return NULL;
+      }
+      return &frag_fwd[i];
+    }
+  }
+  return NULL;
+}
+/*--------------------------------------------------------------------*/
+/* Marks bytes [start, end) of a forwarded packet as forwarded, like
+   cover_fragment() does for reassembly. Returns the number of new 8-byte
+   units. */
+static uint16_t
+fwd_cover(struct sicslowpan_frag_fwd *fwd, uint16_t start, uint16_t end)
+{
+  uint16_t unit, last, count;
+
+  if(end >= fwd->len) {
+    last = (fwd->len + 7) / 8;
+  } else {
+    last = end / 8;
+  }
+  count = 0;
+  for(unit = start / 8; unit < last; unit++) {
+    if((fwd->forwarded[unit / 8] & (1 << (unit & 7))) == 0) {
+      fwd->forwarded[unit / 8] |= 1 << (unit & 7);
+      count++;
+    }
+  }
+  fwd->forwarded_units += count;
+  return count;
+}
+/*--------------------------------------------------------------------*/
+/* Sends a FRAGN of a forwarded packet, unless it only repeats fragments
+   that were sent already. data must not point into packetbuf. */
+static void
+fwd_send_fragn(struct sicslowpan_frag_fwd *fwd, uint8_t offset,
+               const uint8_t *data, uint8_t len)
+{
+  if(fwd_cover(fwd, (uint16_t)offset << 3, ((uint16_t)offset << 3) + len) == 0) {
+    PRINTF("*** Duplicate forwarded fragment - tag: %d offset: %d\n",
+           fwd->tag, offset);
+    sicslowpan_reass_stats.duplicates++;
+    return;
+  }
+  if(fwd->drop) {
+    return;
+  }
+
+  packetbuf_clear();
+  packetbuf_ptr = packetbuf_dataptr();
+  SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_DISPATCH_SIZE,
+        ((SICSLOWPAN_DISPATCH_FRAGN << 8) | fwd->len));
+  SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_TAG, fwd->out_tag);
+  PACKETBUF_FRAG_PTR[PACKETBUF_FRAG_OFFSET] = offset;
+  memcpy(packetbuf_ptr + SICSLOWPAN_FRAGN_HDR_LEN, data, len);
+  packetbuf_set_datalen(SICSLOWPAN_FRAGN_HDR_LEN + len);
+  PRINTFO("sicslowpan forward: fragment (offset %d, len %d, tag %d)\n",
+          offset, len, fwd->out_tag);
+  send_packet(&fwd->next_hop);
+}
+/*--------------------------------------------------------------------*/
+/* Returns the link layer address of the next hop of a packet, or NULL if
+   uIP has to decide */
+static const linkaddr_t *
+fwd_next_hop(uip_ipaddr_t *destipaddr)
+{
+  uip_ipaddr_t *nexthop;
+  uip_ds6_route_t *route;
+
+  if(uip_ds6_is_addr_onlink(destipaddr)) {
+    nexthop = destipaddr;
+  } else {
+    route = uip_ds6_route_lookup(destipaddr);
+    if(route != NULL) {
+      nexthop = uip_ds6_route_nexthop(route);
+    } else {
+      nexthop = uip_ds6_defrt_choose();
+    }
+  }
+  if(nexthop == NULL) {
+    return NULL;
+  }
+  return (const linkaddr_t *)uip_ds6_nbr_lladdr_from_ipaddr(nexthop);
+}
+#if UIP_CONF_IPV6_RPL
+/*--------------------------------------------------------------------*/
+/* Does the checks of the RPL hop-by-hop option that uIP does on packets
+   it forwards, and updates the option for the next hop. The packet is in
+   uip_buf. Returns 0 if the packet has to be dropped. */
+static int
+fwd_rpl_option(void)
+{
+  int ok;
+
+  uip_ext_len = 0;
+  /* the RPL option is the first one in the header, as RPL inserts it */
+  ok = rpl_verify_hbh_header(2) && rpl_update_header();
+  uip_ext_len = 0;
+  return ok;
+}
+#endif /* UIP_CONF_IPV6_RPL */
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Forwards a packet fragment by fragment once its first fragment
+ * has been uncompressed into first_frag.
+ *
+ * Only packets that uIP would merely route on are forwarded: packets that
+ * are not for us, carry no extension header other than a RPL hop-by-hop
+ * option, and whose next hop is a known neighbor. All others are
+ * reassembled as usual. The RPL option is checked and updated as uIP
+ * would, and a packet it fails is dropped fragment by fragment. The first
+ * fragment is compressed again for the next hop, and the fragments of the
+ * packet received so far are sent right after it.
+ *
+ * \return 1 if the packet is forwarded, 0 if it must be reassembled
+ */
+static int
+fwd_first_fragment(int context, struct sicslowpan_first_frag_buf *first_frag)
+{
+  struct uip_ip_hdr *ip_hdr = (struct uip_ip_hdr *)first_frag->data;
+  struct sicslowpan_frag_fwd *fwd;
+  const linkaddr_t *next_hop;
+  uint8_t proto;
+  int max_payload;
+  uint16_t sent;
+  int i;
+
+  if(first_frag->len < UIP_IPUDPH_LEN) {
+    return 0;
+  }
+  proto = ip_hdr->proto;
+#if UIP_CONF_IPV6_RPL
+  if(proto == UIP_PROTO_HBHO) {
+    struct uip_ext_hdr *ext_hdr =
+      (struct uip_ext_hdr *)(first_frag->data + UIP_IPH_LEN);
+
+    /* The root replaces the headers of the packets it forwards */
+    if(rpl_dag_root_is_root() ||
+       first_frag->len < UIP_IPH_LEN + (ext_hdr->len + 1) * 8 + UIP_UDPH_LEN) {
+      return 0;
+    }
+    proto = ext_hdr->next;
+  }
+#endif /* UIP_CONF_IPV6_RPL */
+#ifdef BORDER_ROUTER_FILTER_COAP
+  /* The filter of the border router inspects whole UDP datagrams */
+  if(proto == UIP_PROTO_UDP) {
+    return 0;
+  }
+#endif /* BORDER_ROUTER_FILTER_COAP */
+
+  if(!UIP_CONF_ROUTER ||
+     (proto != UIP_PROTO_UDP && proto != UIP_PROTO_TCP &&
+      proto != UIP_PROTO_ICMP6) ||
+     ip_hdr->ttl <= 1 ||
+     uip_is_addr_mcast(&ip_hdr->destipaddr) ||
+     uip_is_addr_linklocal(&ip_hdr->destipaddr) ||
+     uip_ds6_is_my_addr(&ip_hdr->destipaddr)) {
+    return 0;
+  }
+
+  next_hop = fwd_next_hop(&ip_hdr->destipaddr);
+  if(next_hop == NULL) {
+    return 0;
+  }
+
+  fwd = NULL;
+  for(i = 0; i < SICSLOWPAN_FRAG_FORWARD_ENTRIES; i++) {
+    /* A forwarded packet keeps its entry to recognize late duplicates
+       until the entry is needed again */
+    if(frag_fwd[i].len == 0 ||
+       frag_fwd[i].forwarded_units == (frag_fwd[i].len + 7) / 8 ||
+       timer_expired(&frag_fwd[i].timer)) {
+      fwd = &frag_fwd[i];
+      break;
+    }
+  }
+  if(fwd == NULL) {
+    PRINTF("*** No room to forward fragments - tag: %d\n", frag_info[context].tag);
+    return 0;
+  }
+
+  linkaddr_copy(&fwd->sender, packetbuf_addr(PACKETBUF_ADDR_SENDER));
+  linkaddr_copy(&fwd->next_hop, next_hop);
+  fwd->tag = frag_info[context].tag;
+  fwd->out_tag = my_tag++;
+  fwd->len = frag_info[context].len;
+  fwd->forwarded_units = 0;
+  memset(fwd->forwarded, 0, sizeof(fwd->forwarded));
+  fwd->drop = 0;
+  timer_set(&fwd->timer, SICSLOWPAN_REASS_MAXAGE * CLOCK_SECOND / 16);
+
+  /* The headers are compressed from uip_buf, which is free until a
+     packet has been reassembled */
+  memcpy(UIP_IP_BUF, first_frag->data, first_frag->len);
+  UIP_IP_BUF->ttl--;
+
+#if UIP_CONF_IPV6_RPL
+  if(ip_hdr->proto == UIP_PROTO_HBHO && !fwd_rpl_option()) {
+    PRINTF("*** RPL option error, dropping forwarded packet - tag: %d\n",
+           fwd->tag);
+    fwd->drop = 1;
+    fwd_cover(fwd, 0, first_frag->len);
+    for(i = 0; i < SICSLOWPAN_FRAGMENT_BUFFERS; i++) {
+      if(frag_buf[i].len > 0 && frag_buf[i].index == context) {
+        fwd_cover(fwd, frag_buf[i].offset << 3,
+                  (frag_buf[i].offset << 3) + frag_buf[i].len);
+      }
+    }
+    clear_fragments(context);
+    return 1;
+  }
+#endif /* UIP_CONF_IPV6_RPL */
+
+  uncomp_hdr_len = 0;
+  packetbuf_hdr_len = 0;
+  packetbuf_clear();
+  packetbuf_ptr = packetbuf_dataptr();
+#if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06
+  compress_hdr_iphc(&fwd->next_hop);
+#else /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06 */
+  compress_hdr_ipv6(&fwd->next_hop);
+#endif /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06 */
+  max_payload = get_max_payload(&fwd->next_hop);
+
+  memmove(packetbuf_ptr + SICSLOWPAN_FRAG1_HDR_LEN, packetbuf_ptr, packetbuf_hdr_len);
+  SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_DISPATCH_SIZE,
+        ((SICSLOWPAN_DISPATCH_FRAG1 << 8) | fwd->len));
+  SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_TAG, fwd->out_tag);
+  packetbuf_hdr_len += SICSLOWPAN_FRAG1_HDR_LEN;
+
+  /* The headers may compress worse than on the previous hop; the end of
+     the first fragment then follows in a FRAGN of its own */
+  packetbuf_payload_len = first_frag->len - uncomp_hdr_len;
+  if(packetbuf_payload_len > max_payload - packetbuf_hdr_len) {
+    packetbuf_payload_len = (max_payload - packetbuf_hdr_len) & 0xfffffff8;
+  }
+  memcpy(packetbuf_ptr + packetbuf_hdr_len,
+         (uint8_t *)UIP_IP_BUF + uncomp_hdr_len, packetbuf_payload_len);
+  packetbuf_set_datalen(packetbuf_payload_len + packetbuf_hdr_len);
+  PRINTFO("sicslowpan forward: first fragment (len %d, tag %d -> %d)\n",
+          packetbuf_payload_len, fwd->tag, fwd->out_tag);
+  send_packet(&fwd->next_hop);
+
+  sent = uncomp_hdr_len + packetbuf_payload_len;
+  fwd_cover(fwd, 0, sent);
+  if(sent < first_frag->len) {
+    memcpy(fwd_payload, (uint8_t *)UIP_IP_BUF + sent, first_frag->len - sent);
+    fwd_send_fragn(fwd, sent >> 3, fwd_payload, first_frag->len - sent);
+  }
+
+  for(i = 0; i < SICSLOWPAN_FRAGMENT_BUFFERS; i++) {
+    if(frag_buf[i].len > 0 && frag_buf[i].index == context) {
+      fwd_send_fragn(fwd, frag_buf[i].offset, frag_buf[i].data, frag_buf[i].len);
+    }
+  }
+  clear_fragments(context);
+
+  sicslowpan_reass_stats.forwarded++;
+  return 1;
+}
+/** @} */
+#endif /* SICSLOWPAN_FRAG_FORWARDING */
+
 /*--------------------------------------------------------------------*/
 /** \brief Process a received 6lowpan packet.
  *
@@ -1496,8 +1930,9 @@ output(const uip_lladdr_t *localdest)
  *  copied in siclowpan_buf. If the IP packet is complete it is copied
  *  to uip_buf and the IP layer is called.
  *
- * \note We do not check for overlapping sicslowpan fragments
- * (it is a SHALL in the RFC 4944 and should never happen)
+ * \note Fragments are tracked per 8-byte unit of the IP packet, so
+ * duplicate fragments are dropped and overlapping fragments only count
+ * once towards the reassembled length.
  */
 static void
 input(void)
@@ -1511,6 +1946,12 @@ input(void)
 #if SICSLOWPAN_CONF_FRAG
   uint8_t is_fragment = 0;
   int8_t frag_context = 0;
+  struct sicslowpan_first_frag_buf *first_frag = NULL;
+  uint16_t frag_len, new_units;
+  int len;
+#if SICSLOWPAN_FRAG_FORWARDING
+  struct sicslowpan_frag_fwd *fwd;
+#endif /* SICSLOWPAN_FRAG_FORWARDING */
 
   /* tag of the fragment */
   uint16_t frag_tag = 0;
@@ -1555,6 +1996,14 @@ input(void)
       first_fragment = 1;
       is_fragment = 1;
 
+#if SICSLOWPAN_FRAG_FORWARDING
+      if(fwd_lookup(frag_tag) != NULL) {
+        PRINTF("*** Duplicate forwarded first fragment - tag: %d\n", frag_tag);
+        sicslowpan_reass_stats.duplicates++;
+        return;
+      }
+#endif /* SICSLOWPAN_FRAG_FORWARDING */
+
       /* Add the fragment to the fragmentation context */
       frag_context = add_fragment(frag_tag, frag_size, frag_offset);
 
@@ -1562,7 +2011,22 @@ input(void)
         return;
       }
 
-      buffer = frag_info[frag_context].first_frag;
+      if(frag_info[frag_context].first_frag_len > 0) {
+        PRINTF("*** Duplicate first fragment - tag: %d\n", frag_tag);
+        sicslowpan_reass_stats.duplicates++;
+        return;
+      }
+
+      first_frag = get_first_frag_buf(frag_context);
+      if(first_frag == NULL && timeout_fragments(frag_context) > 0) {
+        first_frag = get_first_frag_buf(frag_context);
+      }
+      if(first_frag == NULL) {
+        PRINTF("*** Failed to store first fragment - tag: %d\n", frag_tag);
+        sicslowpan_reass_stats.buffers_exhausted++;
+        return;
+      }
+      buffer = first_frag->data;
 
       break;
     case SICSLOWPAN_DISPATCH_FRAGN:
@@ -1583,20 +2047,60 @@ input(void)
       PRINTFI("last_fragment?: packetbuf_payload_len %d frag_size %d\n",
               packetbuf_datalen() - packetbuf_hdr_len, frag_size);
 
-      /* Add the fragment to the fragmentation context (this will also
-         copy the payload) */
+      if(packetbuf_datalen() < packetbuf_hdr_len) {
+        PRINTF("SICSLOWPAN: packet dropped due to header > total packet\n");
+        return;
+      }
+      frag_len = packetbuf_datalen() - packetbuf_hdr_len;
+
+#if SICSLOWPAN_FRAG_FORWARDING
+      /* The first fragment of the packet has already been forwarded */
+      fwd = fwd_lookup(frag_tag);
+      if(fwd != NULL) {
+        memcpy(fwd_payload, packetbuf_ptr + packetbuf_hdr_len, frag_len);
+        fwd_send_fragn(fwd, frag_offset, fwd_payload, frag_len);
+        return;
+      }
+#endif /* SICSLOWPAN_FRAG_FORWARDING */
+
       frag_context = add_fragment(frag_tag, frag_size, frag_offset);
 
       if(frag_context == -1) {
         return;
       }
 
-      /* Ok - add_fragment will store the fragment automatically - so
-         we should not store more */
-      buffer = NULL;
+      new_units = cover_fragment(frag_context, (uint16_t)(frag_offset << 3),
+                                 (uint16_t)(frag_offset << 3) + frag_len, 0);
+      if(new_units == 0) {
+        PRINTF("*** Duplicate fragment - tag: %d offset: %d\n", frag_tag, frag_offset);
+        sicslowpan_reass_stats.duplicates++;
+        return;
+      }
 
-      if(frag_info[frag_context].reassembled_len >= frag_size) {
+      if(frag_info[frag_context].first_frag_len > 0 &&
+         frag_info[frag_context].covered_units + new_units ==
+         (frag_info[frag_context].len + 7) / 8) {
+        /* This fragment completes the packet: the stored fragments are
+           copied to uip and this one is copied in place behind them */
         last_fragment = 1;
+        copy_frags2uip(frag_context);
+        buffer = (uint8_t *)UIP_IP_BUF + (uint16_t)(frag_offset << 3);
+        cover_fragment(frag_context, (uint16_t)(frag_offset << 3),
+                       (uint16_t)(frag_offset << 3) + frag_len, 1);
+      } else {
+        len = store_fragment(frag_context, frag_offset);
+        if(len < 0 && timeout_fragments(frag_context) > 0) {
+          len = store_fragment(frag_context, frag_offset);
+        }
+        if(len < 0) {
+          PRINTF("*** Failed to store fragment - packet reassembly will fail tag:%d\n", frag_tag);
+          sicslowpan_reass_stats.buffers_exhausted++;
+          return;
+        }
+        cover_fragment(frag_context, (uint16_t)(frag_offset << 3),
+                       (uint16_t)(frag_offset << 3) + frag_len, 1);
+        /* The fragment is stored - so we should not store more */
+        buffer = NULL;
       }
       is_fragment = 1;
       break;
@@ -1678,15 +2182,21 @@ input(void)
   if(frag_size > 0) {
     /* Add the size of the header only for the first fragment. */
     if(first_fragment != 0) {
-      frag_info[frag_context].reassembled_len = uncomp_hdr_len + packetbuf_payload_len;
-      frag_info[frag_context].first_frag_len = uncomp_hdr_len + packetbuf_payload_len;
-    }
-    /* For the last fragment, we are OK if there is extrenous bytes at
-       the end of the packet. */
-    if(last_fragment != 0) {
-      frag_info[frag_context].reassembled_len = frag_size;
-      /* copy to uip */
-      copy_frags2uip(frag_context);
+      first_frag->len = uncomp_hdr_len + packetbuf_payload_len;
+      frag_info[frag_context].first_frag_len = first_frag->len;
+#if SICSLOWPAN_FRAG_FORWARDING
+      if(fwd_first_fragment(frag_context, first_frag)) {
+        return;
+      }
+#endif /* SICSLOWPAN_FRAG_FORWARDING */
+      cover_fragment(frag_context, 0, first_frag->len, 1);
+      /* The first fragment may also be the last one to arrive */
+      if(frag_info[frag_context].covered_units ==
+         (frag_info[frag_context].len + 7) / 8) {
+        last_fragment = 1;
+        /* copy to uip */
+        copy_frags2uip(frag_context);
+      }
     }
   }
 
@@ -321,6 +321,20 @@ struct sicslowpan_nh_compressor {
 
 int sicslowpan_get_last_rssi(void);
 
+/**
+ * Counters of the fragment reassembly, only updated when
+ * SICSLOWPAN_CONF_FRAG is enabled.
+ */
+struct sicslowpan_reass_stats {
+  unsigned long contexts_exhausted; /* packets dropped, no free context */
+  unsigned long buffers_exhausted;  /* fragments dropped, no free buffer */
+  unsigned long timeouts;           /* packets given up as incomplete */
+  unsigned long duplicates;         /* fragments received twice */
+  unsigned long forwarded;          /* packets forwarded fragment by fragment */
+};
+
+extern struct sicslowpan_reass_stats sicslowpan_reass_stats;
+
 extern const struct network_driver sicslowpan_driver;
 
 #endif /* SICSLOWPAN_H_ */
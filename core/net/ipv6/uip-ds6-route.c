@@ -75,6 +75,31 @@ MEMB(routememb, uip_ds6_route_t, UIP_DS6_ROUTE_NB);
 static int num_routes = 0;
 static void rm_routelist_callback(nbr_table_item_t *ptr);
 
+#if UIP_DS6_ROUTE_INDEX
+/* The route index hashes the bytes of each prefix that
+   uip_ipaddr_prefixcmp() compares into one of the index_buckets. A
+   lookup probes one bucket per prefix length in use, longest first,
+   so its cost depends on the number of distinct prefix lengths rather
+   than on the number of routes. */
+static uip_ds6_route_t *index_buckets[UIP_DS6_ROUTE_INDEX_BUCKETS];
+
+/* The prefix lengths in use, sorted longest first, and the number of
+   indexed routes with each length. */
+static uint8_t index_lengths[UIP_DS6_ROUTE_INDEX_LENGTHS];
+static uint16_t index_length_count[UIP_DS6_ROUTE_INDEX_LENGTHS];
+static uint8_t index_num_lengths;
+
+/* Routes whose prefix length did not fit into index_lengths are
+   marked by pointing index_next to themselves. As long as there are
+   such routes, lookups scan the route list instead. */
+#define ROUTE_IS_INDEXED(r) ((r)->index_next != (r))
+static int index_num_unindexed;
+
+#if UIP_DS6_ROUTE_REMOVE_LEAST_RECENTLY_USED
+static uint16_t index_lookup_counter;
+#endif /* UIP_DS6_ROUTE_REMOVE_LEAST_RECENTLY_USED */
+#endif /* UIP_DS6_ROUTE_INDEX */
+
 #endif /* (UIP_CONF_MAX_ROUTES != 0) */
 
 /* Default routes are held on the defaultrouterlist and their
@@ -155,6 +180,105 @@ uip_ds6_notification_rm(struct uip_ds6_notification *n)
   list_remove(notificationlist, n);
 }
 #endif
+#if (UIP_CONF_MAX_ROUTES != 0) && UIP_DS6_ROUTE_INDEX
+/*---------------------------------------------------------------------------*/
+static uint16_t
+index_bucket(const uip_ipaddr_t *addr, uint8_t length)
+{
+  uint16_t hash;
+  uint8_t i;
+
+  hash = length;
+  for(i = 0; i < (length >> 3); i++) {
+    hash = (hash << 5) + hash + addr->u8[i];
+  }
+  return hash % UIP_DS6_ROUTE_INDEX_BUCKETS;
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_add(uip_ds6_route_t *r)
+{
+  uint16_t b;
+  uint8_t i;
+
+  /* Find the slot of the route's prefix length, or insert one. */
+  for(i = 0; i < index_num_lengths && index_lengths[i] > r->length; i++);
+  if(i == index_num_lengths || index_lengths[i] != r->length) {
+    if(index_num_lengths == UIP_DS6_ROUTE_INDEX_LENGTHS) {
+      PRINTF("uip-ds6-route: no room to index prefix length %u\n",
+             r->length);
+      r->index_next = r;
+      index_num_unindexed++;
+      return;
+    }
+    memmove(&index_lengths[i + 1], &index_lengths[i],
+            (index_num_lengths - i) * sizeof(index_lengths[0]));
+    memmove(&index_length_count[i + 1], &index_length_count[i],
+            (index_num_lengths - i) * sizeof(index_length_count[0]));
+    index_lengths[i] = r->length;
+    index_length_count[i] = 0;
+    index_num_lengths++;
+  }
+  index_length_count[i]++;
+
+  b = index_bucket(&r->ipaddr, r->length);
+  r->index_next = index_buckets[b];
+  index_buckets[b] = r;
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_rm(uip_ds6_route_t *r)
+{
+  uip_ds6_route_t **p;
+  uint8_t i;
+
+  if(!ROUTE_IS_INDEXED(r)) {
+    index_num_unindexed--;
+    return;
+  }
+
+  for(p = &index_buckets[index_bucket(&r->ipaddr, r->length)];
+      *p != NULL;
+      p = &(*p)->index_next) {
+    if(*p == r) {
+      *p = r->index_next;
+      break;
+    }
+  }
+
+  for(i = 0; i < index_num_lengths; i++) {
+    if(index_lengths[i] == r->length) {
+      if(--index_length_count[i] == 0) {
+        index_num_lengths--;
+        memmove(&index_lengths[i], &index_lengths[i + 1],
+                (index_num_lengths - i) * sizeof(index_lengths[0]));
+        memmove(&index_length_count[i], &index_length_count[i + 1],
+                (index_num_lengths - i) * sizeof(index_length_count[0]));
+      }
+      break;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static uip_ds6_route_t *
+index_lookup(uip_ipaddr_t *addr)
+{
+  uip_ds6_route_t *r;
+  uint8_t i;
+
+  for(i = 0; i < index_num_lengths; i++) {
+    for(r = index_buckets[index_bucket(addr, index_lengths[i])];
+        r != NULL;
+        r = r->index_next) {
+      if(r->length == index_lengths[i] &&
+         uip_ipaddr_prefixcmp(addr, &r->ipaddr, r->length)) {
+        return r;
+      }
+    }
+  }
+  return NULL;
+}
+#endif /* (UIP_CONF_MAX_ROUTES != 0) && UIP_DS6_ROUTE_INDEX */
 /*---------------------------------------------------------------------------*/
 void
 uip_ds6_route_init(void)
@@ -162,6 +286,11 @@ uip_ds6_route_init(void)
 #if (UIP_CONF_MAX_ROUTES != 0)
   memb_init(&routememb);
   list_init(routelist);
+#if UIP_DS6_ROUTE_INDEX
+  memset(index_buckets, 0, sizeof(index_buckets));
+  index_num_lengths = 0;
+  index_num_unindexed = 0;
+#endif /* UIP_DS6_ROUTE_INDEX */
   nbr_table_register(nbr_routes,
                      (nbr_table_callback *)rm_routelist_callback);
 #endif /* (UIP_CONF_MAX_ROUTES != 0) */
@@ -264,17 +393,24 @@ uip_ds6_route_lookup(uip_ipaddr_t *addr)
 
 
   found_route = NULL;
-  longestmatch = 0;
-  for(r = uip_ds6_route_head();
-      r != NULL;
-      r = uip_ds6_route_next(r)) {
-    if(r->length >= longestmatch &&
-       uip_ipaddr_prefixcmp(addr, &r->ipaddr, r->length)) {
-      longestmatch = r->length;
-      found_route = r;
-      /* check if total match - e.g. all 128 bits do match */
-      if(longestmatch == 128) {
-	break;
+#if UIP_DS6_ROUTE_INDEX
+  if(index_num_unindexed == 0) {
+    found_route = index_lookup(addr);
+  } else
+#endif /* UIP_DS6_ROUTE_INDEX */
+  {
+    longestmatch = 0;
+    for(r = uip_ds6_route_head();
+        r != NULL;
+        r = uip_ds6_route_next(r)) {
+      if(r->length >= longestmatch &&
+         uip_ipaddr_prefixcmp(addr, &r->ipaddr, r->length)) {
+        longestmatch = r->length;
+        found_route = r;
+        /* check if total match - e.g. all 128 bits do match */
+        if(longestmatch == 128) {
+          break;
+        }
       }
     }
   }
@@ -289,6 +425,13 @@ uip_ds6_route_lookup(uip_ipaddr_t *addr)
     PRINTF("uip-ds6-route: No route found\n");
   }
 
+#if UIP_DS6_ROUTE_INDEX
+#if UIP_DS6_ROUTE_REMOVE_LEAST_RECENTLY_USED
+  if(found_route != NULL) {
+    found_route->last_lookup = ++index_lookup_counter;
+  }
+#endif /* UIP_DS6_ROUTE_REMOVE_LEAST_RECENTLY_USED */
+#else /* UIP_DS6_ROUTE_INDEX */
   if(found_route != NULL && found_route != list_head(routelist)) {
     /* If we found a route, we put it at the start of the routeslist
        list. The list is ordered by how recently we looked them up:
@@ -298,6 +441,7 @@ uip_ds6_route_lookup(uip_ipaddr_t *addr)
     list_remove(routelist, found_route);
     list_push(routelist, found_route);
   }
+#endif /* UIP_DS6_ROUTE_INDEX */
 
   return found_route;
 #else /* (UIP_CONF_MAX_ROUTES != 0) */
@@ -353,9 +497,21 @@ uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length,
       uip_ds6_route_t *oldest;
       oldest = NULL;
 #if UIP_DS6_ROUTE_REMOVE_LEAST_RECENTLY_USED
+#if UIP_DS6_ROUTE_INDEX
+      /* The indexed lookup does not reorder the route list, so find
+         the route that has gone the longest without being used. */
+      for(r = list_head(routelist); r != NULL; r = list_item_next(r)) {
+        if(oldest == NULL ||
+           (uint16_t)(index_lookup_counter - r->last_lookup) >
+           (uint16_t)(index_lookup_counter - oldest->last_lookup)) {
+          oldest = r;
+        }
+      }
+#else /* UIP_DS6_ROUTE_INDEX */
       /* Removing the oldest route entry from the route table. The
          least recently used route is the first route on the list. */
       oldest = list_tail(routelist);
+#endif /* UIP_DS6_ROUTE_INDEX */
 #endif
       if(oldest == NULL) {
         return NULL;
@@ -437,6 +593,13 @@ uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length,
   uip_ipaddr_copy(&(r->ipaddr), ipaddr);
   r->length = length;
 
+#if UIP_DS6_ROUTE_INDEX
+  index_add(r);
+#if UIP_DS6_ROUTE_REMOVE_LEAST_RECENTLY_USED
+  r->last_lookup = ++index_lookup_counter;
+#endif /* UIP_DS6_ROUTE_REMOVE_LEAST_RECENTLY_USED */
+#endif /* UIP_DS6_ROUTE_INDEX */
+
 #ifdef UIP_DS6_ROUTE_STATE_TYPE
   memset(&r->state, 0, sizeof(UIP_DS6_ROUTE_STATE_TYPE));
 #endif
@@ -479,6 +642,9 @@ uip_ds6_route_rm(uip_ds6_route_t *route)
 
     /* Remove the route from the route list */
     list_remove(routelist, route);
+#if UIP_DS6_ROUTE_INDEX
+    index_rm(route);
+#endif /* UIP_DS6_ROUTE_INDEX */
 
     /* Find the corresponding neighbor_route and remove it. */
     for(neighbor_route = list_head(route->neighbor_routes->route_list);
@@ -88,6 +88,32 @@ void uip_ds6_notification_rm(struct uip_ds6_notification *n);
 #define UIP_DS6_ROUTE_NB 4
 #endif /* UIP_CONF_MAX_ROUTES */
 
+/** \brief Keep a hash index over the routing table, bucketed by prefix
+ *  length, so that uip_ds6_route_lookup() does not scan the whole route
+ *  list. Intended for nodes that hold many routes, e.g., storing-mode
+ *  RPL roots. */
+#ifdef UIP_DS6_ROUTE_CONF_INDEX
+#define UIP_DS6_ROUTE_INDEX UIP_DS6_ROUTE_CONF_INDEX
+#else /* UIP_DS6_ROUTE_CONF_INDEX */
+#define UIP_DS6_ROUTE_INDEX 0
+#endif /* UIP_DS6_ROUTE_CONF_INDEX */
+
+/** \brief Number of hash buckets of the routing table index */
+#ifdef UIP_DS6_ROUTE_CONF_INDEX_BUCKETS
+#define UIP_DS6_ROUTE_INDEX_BUCKETS UIP_DS6_ROUTE_CONF_INDEX_BUCKETS
+#else /* UIP_DS6_ROUTE_CONF_INDEX_BUCKETS */
+#define UIP_DS6_ROUTE_INDEX_BUCKETS UIP_DS6_ROUTE_NB
+#endif /* UIP_DS6_ROUTE_CONF_INDEX_BUCKETS */
+
+/** \brief Number of distinct prefix lengths the routing table index
+ *  can track. Routes with further prefix lengths are still added, but
+ *  lookups fall back to scanning the route list while they exist. */
+#ifdef UIP_DS6_ROUTE_CONF_INDEX_LENGTHS
+#define UIP_DS6_ROUTE_INDEX_LENGTHS UIP_DS6_ROUTE_CONF_INDEX_LENGTHS
+#else /* UIP_DS6_ROUTE_CONF_INDEX_LENGTHS */
+#define UIP_DS6_ROUTE_INDEX_LENGTHS 4
+#endif /* UIP_DS6_ROUTE_CONF_INDEX_LENGTHS */
+
 /** \brief define some additional RPL related route state and
  *  neighbor callback for RPL - if not a DS6_ROUTE_STATE is already set */
 #ifndef UIP_DS6_ROUTE_STATE_TYPE
@@ -157,6 +183,16 @@ typedef struct uip_ds6_route {
 #ifdef UIP_DS6_ROUTE_STATE_TYPE
   UIP_DS6_ROUTE_STATE_TYPE state;
 #endif
+#if UIP_DS6_ROUTE_INDEX
+  /* Next route in the same bucket of the routing table index. */
+  struct uip_ds6_route *index_next;
+#if UIP_DS6_ROUTE_REMOVE_LEAST_RECENTLY_USED
+  /* Value of the lookup counter when this route was last used. The
+     indexed lookup does not reorder the route list, so this replaces
+     the list order for finding the least recently used route. */
+  uint16_t last_lookup;
+#endif /* UIP_DS6_ROUTE_REMOVE_LEAST_RECENTLY_USED */
+#endif /* UIP_DS6_ROUTE_INDEX */
   uint8_t length;
 } uip_ds6_route_t;
 
@@ -71,6 +71,9 @@ extern const struct framer DECORATED_FRAMER;
 #if AKES_NBR_WITH_GROUP_KEYS
 uint8_t adaptivesec_group_key[AES_128_KEY_LENGTH];
 #endif /* AKES_NBR_WITH_GROUP_KEYS */
+#if ADAPTIVESEC_WITH_AEAD_STATS
+struct adaptivesec_aead_stats adaptivesec_aead_stats;
+#endif /* ADAPTIVESEC_WITH_AEAD_STATS */
 
 /*---------------------------------------------------------------------------*/
 uint8_t
@@ -260,6 +263,10 @@ adaptivesec_aead(uint8_t *key, int shall_encrypt, uint8_t *result, int forward
   uint8_t m_len;
   uint8_t *a;
   uint8_t a_len;
+#if ADAPTIVESEC_WITH_AEAD_STATS
+  rtimer_clock_t start;
+  rtimer_clock_t keyed;
+#endif /* ADAPTIVESEC_WITH_AEAD_STATS */
 
   ccm_star_packetbuf_set_nonce(nonce, forward
 #if ILOS_ENABLED
@@ -282,12 +289,23 @@ adaptivesec_aead(uint8_t *key, int shall_encrypt, uint8_t *result, int forward
   }
 
   AES_128_GET_LOCK();
+#if ADAPTIVESEC_WITH_AEAD_STATS
+  start = RTIMER_NOW();
+#endif /* ADAPTIVESEC_WITH_AEAD_STATS */
   CCM_STAR.set_key(key);
+#if ADAPTIVESEC_WITH_AEAD_STATS
+  keyed = RTIMER_NOW();
+#endif /* ADAPTIVESEC_WITH_AEAD_STATS */
   CCM_STAR.aead(nonce,
       m, m_len,
       a, a_len,
       result, adaptivesec_mic_len(),
       forward);
+#if ADAPTIVESEC_WITH_AEAD_STATS
+  adaptivesec_aead_stats.operations++;
+  adaptivesec_aead_stats.set_key_ticks += rtimer_delta(start, keyed);
+  adaptivesec_aead_stats.aead_ticks += rtimer_delta(keyed, RTIMER_NOW());
+#endif /* ADAPTIVESEC_WITH_AEAD_STATS */
   AES_128_RELEASE_LOCK();
 }
 /*---------------------------------------------------------------------------*/
@@ -85,6 +85,26 @@
 #define ADAPTIVESEC_ENABLED 0
 #endif /* ADAPTIVESEC_CONF_ENABLED */
 
+#ifdef ADAPTIVESEC_CONF_WITH_AEAD_STATS
+#define ADAPTIVESEC_WITH_AEAD_STATS ADAPTIVESEC_CONF_WITH_AEAD_STATS
+#else /* ADAPTIVESEC_CONF_WITH_AEAD_STATS */
+#define ADAPTIVESEC_WITH_AEAD_STATS 0
+#endif /* ADAPTIVESEC_CONF_WITH_AEAD_STATS */
+
+#if ADAPTIVESEC_WITH_AEAD_STATS
+/**
+ * Time spent in adaptivesec_aead(), in rtimer ticks. Securing a frame
+ * takes one operation, verifying a broadcast may take several.
+ */
+struct adaptivesec_aead_stats {
+  unsigned long operations;
+  unsigned long set_key_ticks;
+  unsigned long aead_ticks;
+};
+
+extern struct adaptivesec_aead_stats adaptivesec_aead_stats;
+#endif /* ADAPTIVESEC_WITH_AEAD_STATS */
+
 enum adaptivesec_verify {
   ADAPTIVESEC_VERIFY_SUCCESS,
   ADAPTIVESEC_VERIFY_INAUTHENTIC,
@@ -58,6 +58,18 @@
 #define MAX_BUFFERED_MICS 5
 #endif /* CORESEC_STRATEGY_CONF_MAX_BUFFERED_MICS */
 
+/*
+ * Stores the CCM*-MIC announced by each neighbor at the neighbor's local
+ * index instead of in a ring of MAX_BUFFERED_MICS. Verifying a broadcast
+ * then compares a single stored CCM*-MIC and ANNOUNCEs from many
+ * neighbors no longer evict each other's CCM*-MICs.
+ */
+#ifdef CORESEC_STRATEGY_CONF_WITH_INDEXED_MICS
+#define WITH_INDEXED_MICS CORESEC_STRATEGY_CONF_WITH_INDEXED_MICS
+#else /* CORESEC_STRATEGY_CONF_WITH_INDEXED_MICS */
+#define WITH_INDEXED_MICS 0
+#endif /* CORESEC_STRATEGY_CONF_WITH_INDEXED_MICS */
+
 #define WITH_BROADCAST_ENCRYPTION (ADAPTIVESEC_BROADCAST_SEC_LVL & (1 << 2))
 
 #define DEBUG 0
@@ -74,8 +86,13 @@ struct mic {
 
 #if AKES_NBR_WITH_PAIRWISE_KEYS && AKES_NBR_WITH_INDICES && !POTR_ENABLED
 
+#if WITH_INDEXED_MICS
+static struct mic mics[NBR_TABLE_MAX_NEIGHBORS];
+static uint8_t has_mic[NBR_TABLE_MAX_NEIGHBORS];
+#else /* WITH_INDEXED_MICS */
 static struct mic mics[MAX_BUFFERED_MICS];
 static uint8_t next_mic_index;
+#endif /* WITH_INDEXED_MICS */
 static struct cmd_broker_subscription subscription;
 
 /*---------------------------------------------------------------------------*/
@@ -180,6 +197,13 @@ send(mac_callback_t sent, void *ptr)
 static int
 is_mic_stored(uint8_t *mic)
 {
+#if WITH_INDEXED_MICS
+  uint8_t index;
+
+  index = akes_nbr_get_sender_entry()->local_index;
+  return has_mic[index]
+      && !memcmp(mic, mics[index].u8, ADAPTIVESEC_BROADCAST_MIC_LEN);
+#else /* WITH_INDEXED_MICS */
   uint8_t i;
 
   for(i = 0; i < MAX_BUFFERED_MICS; i++) {
@@ -188,6 +212,24 @@ is_mic_stored(uint8_t *mic)
     }
   }
   return 0;
+#endif /* WITH_INDEXED_MICS */
+}
+/*---------------------------------------------------------------------------*/
+static void
+store_mic(uint8_t *mic)
+{
+#if WITH_INDEXED_MICS
+  uint8_t index;
+
+  index = akes_nbr_get_sender_entry()->local_index;
+  memcpy(mics[index].u8, mic, ADAPTIVESEC_BROADCAST_MIC_LEN);
+  has_mic[index] = 1;
+#else /* WITH_INDEXED_MICS */
+  memcpy(mics[next_mic_index].u8, mic, ADAPTIVESEC_BROADCAST_MIC_LEN);
+  if(++next_mic_index == MAX_BUFFERED_MICS) {
+    next_mic_index = 0;
+  }
+#endif /* WITH_INDEXED_MICS */
 }
 /*---------------------------------------------------------------------------*/
 static enum cmd_broker_result
@@ -226,11 +268,7 @@ on_command(uint8_t cmd_id, uint8_t *payload)
     return CMD_BROKER_ERROR;
   }
 
-  /* store CCM*-MIC */
-  memcpy(mics[next_mic_index].u8, payload, ADAPTIVESEC_BROADCAST_MIC_LEN);
-  if(++next_mic_index == MAX_BUFFERED_MICS) {
-    next_mic_index = 0;
-  }
+  store_mic(payload);
 
   return CMD_BROKER_CONSUMED;
 }
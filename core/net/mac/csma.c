@@ -47,6 +47,7 @@
 #include "lib/random.h"
 
 #include "net/netstack.h"
+#include "net/nbr-table.h"
 
 #include "lib/list.h"
 #include "lib/memb.h"
@@ -102,12 +103,17 @@ struct qbuf_metadata {
 
 /* Every neighbor has its own packet queue */
 struct neighbor_queue {
+#if !CSMA_WITH_NBR_TABLE
   struct neighbor_queue *next;
   linkaddr_t addr;
+#endif /* !CSMA_WITH_NBR_TABLE */
   struct ctimer transmit_timer;
   uint8_t transmissions;
   uint8_t collisions;
   LIST_STRUCT(queued_packet_list);
+#if CSMA_WITH_STATS
+  struct csma_neighbor_stats stats;
+#endif /* CSMA_WITH_STATS */
 };
 
 /* The maximum number of co-existing neighbor queues */
@@ -125,10 +131,27 @@ struct neighbor_queue {
 #endif /* CSMA_CONF_MAX_PACKET_PER_NEIGHBOR */
 
 #define MAX_QUEUED_PACKETS QUEUEBUF_NUM
+#if CSMA_WITH_NBR_TABLE
+/*
+ * Queues are locked while they hold packets. Empty queues are kept, along
+ * with their statistics, until the neighbor table needs the space.
+ */
+NBR_TABLE(struct neighbor_queue, neighbor_queues);
+#else /* CSMA_WITH_NBR_TABLE */
 MEMB(neighbor_memb, struct neighbor_queue, CSMA_MAX_NEIGHBOR_QUEUES);
+LIST(neighbor_list);
+#endif /* CSMA_WITH_NBR_TABLE */
 MEMB(packet_memb, struct rdc_buf_list, MAX_QUEUED_PACKETS);
 MEMB(metadata_memb, struct qbuf_metadata, MAX_QUEUED_PACKETS);
-LIST(neighbor_list);
+
+#if CSMA_WITH_STATS
+static struct csma_stats stats;
+#define STATS_ADD(n, field, value) (n)->stats.field += (value)
+#define STATS_INC(field) stats.field++
+#else /* CSMA_WITH_STATS */
+#define STATS_ADD(n, field, value)
+#define STATS_INC(field)
+#endif /* CSMA_WITH_STATS */
 
 static void packet_sent(void *ptr, int status, int num_transmissions);
 static void transmit_packet_list(void *ptr);
@@ -136,6 +159,9 @@ static void transmit_packet_list(void *ptr);
 static struct neighbor_queue *
 neighbor_queue_from_addr(const linkaddr_t *addr)
 {
+#if CSMA_WITH_NBR_TABLE
+  return nbr_table_get_from_lladdr(neighbor_queues, addr);
+#else /* CSMA_WITH_NBR_TABLE */
   struct neighbor_queue *n = list_head(neighbor_list);
   while(n != NULL) {
     if(linkaddr_cmp(&n->addr, addr)) {
@@ -144,6 +170,51 @@ neighbor_queue_from_addr(const linkaddr_t *addr)
     n = list_item_next(n);
   }
   return NULL;
+#endif /* CSMA_WITH_NBR_TABLE */
+}
+/*---------------------------------------------------------------------------*/
+static struct neighbor_queue *
+neighbor_queue_new(const linkaddr_t *addr)
+{
+  struct neighbor_queue *n;
+
+#if CSMA_WITH_NBR_TABLE
+  n = nbr_table_add_lladdr(neighbor_queues, addr, NBR_TABLE_REASON_MAC, NULL);
+#else /* CSMA_WITH_NBR_TABLE */
+  n = memb_alloc(&neighbor_memb);
+  if(n != NULL) {
+    linkaddr_copy(&n->addr, addr);
+#if CSMA_WITH_STATS
+    memset(&n->stats, 0, sizeof(n->stats));
+#endif /* CSMA_WITH_STATS */
+    /* Add neighbor to the list */
+    list_add(neighbor_list, n);
+  }
+#endif /* CSMA_WITH_NBR_TABLE */
+  if(n != NULL) {
+    n->transmissions = 0;
+    n->collisions = CSMA_MIN_BE;
+    /* Init packet list for this neighbor */
+    LIST_STRUCT_INIT(n, queued_packet_list);
+  }
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+/* Called once the queue of n ran empty */
+static void
+neighbor_queue_free(struct neighbor_queue *n)
+{
+  ctimer_stop(&n->transmit_timer);
+#if CSMA_WITH_NBR_TABLE
+#if CSMA_WITH_STATS
+  nbr_table_unlock(neighbor_queues, n);
+#else /* CSMA_WITH_STATS */
+  nbr_table_remove(neighbor_queues, n);
+#endif /* CSMA_WITH_STATS */
+#else /* CSMA_WITH_NBR_TABLE */
+  list_remove(neighbor_list, n);
+  memb_free(&neighbor_memb, n);
+#endif /* CSMA_WITH_NBR_TABLE */
 }
 /*---------------------------------------------------------------------------*/
 static clock_time_t
@@ -218,9 +289,7 @@ free_packet(struct neighbor_queue *n, struct rdc_buf_list *p, int status)
       schedule_transmission(n);
     } else {
       /* This was the last packet in the queue, we free the neighbor */
-      ctimer_stop(&n->transmit_timer);
-      list_remove(neighbor_list, n);
-      memb_free(&neighbor_memb, n);
+      neighbor_queue_free(n);
     }
   }
 }
@@ -246,11 +315,22 @@ tx_done(int status, struct rdc_buf_list *q, struct neighbor_queue *n)
   case MAC_TX_NOACK:
     PRINTF("csma: drop with status %d after %d transmissions, %d collisions\n",
                  status, n->transmissions, n->collisions);
+    if(status == MAC_TX_NOACK) {
+      STATS_INC(noack);
+    } else {
+      STATS_INC(collision);
+    }
+    STATS_ADD(n, drops, 1);
     break;
   default:
     PRINTF("csma: rexmit failed %d: %d\n", n->transmissions, status);
+    STATS_INC(err);
+    STATS_ADD(n, drops, 1);
     break;
   }
+  if(ntx > 1) {
+    STATS_ADD(n, retransmissions, ntx - 1);
+  }
 
   free_packet(n, q, status);
   mac_call_sent_callback(sent, cptr, status, ntx);
@@ -344,6 +424,10 @@ packet_sent(void *ptr, int status, int num_transmissions)
     return;
   }
 
+  if(status != MAC_TX_DEFERRED) {
+    STATS_ADD(n, transmissions, num_transmissions);
+  }
+
   switch(status) {
   case MAC_TX_OK:
     tx_ok(q, n, num_transmissions);
@@ -373,22 +457,24 @@ send_packet(mac_callback_t sent, void *ptr)
   n = neighbor_queue_from_addr(addr);
   if(n == NULL) {
     /* Allocate a new neighbor entry */
-    n = memb_alloc(&neighbor_memb);
-    if(n != NULL) {
-      /* Init neighbor entry */
-      linkaddr_copy(&n->addr, addr);
-      n->transmissions = 0;
-      n->collisions = CSMA_MIN_BE;
-      /* Init packet list for this neighbor */
-      LIST_STRUCT_INIT(n, queued_packet_list);
-      /* Add neighbor to the list */
-      list_add(neighbor_list, n);
-    }
+    n = neighbor_queue_new(addr);
   }
 
   if(n != NULL) {
     /* Add packet to the neighbor's queue */
-    if(list_length(n->queued_packet_list) < CSMA_MAX_PACKET_PER_NEIGHBOR) {
+    if(list_length(n->queued_packet_list) >= CSMA_MAX_PACKET_PER_NEIGHBOR) {
+      PRINTF("csma: Neighbor queue full\n");
+      STATS_INC(queue_full);
+      STATS_ADD(n, drops, 1);
+#if CSMA_WITH_FAIR_SHARE
+    } else if(memb_numfree(&packet_memb)
+        && (list_length(n->queued_packet_list)
+            >= CSMA_FAIR_SHARE_ALPHA * memb_numfree(&packet_memb))) {
+      PRINTF("csma: Neighbor exceeds its fair share\n");
+      STATS_INC(fair_share);
+      STATS_ADD(n, drops, 1);
+#endif /* CSMA_WITH_FAIR_SHARE */
+    } else {
       q = memb_alloc(&packet_memb);
       if(q != NULL) {
         q->ptr = memb_alloc(&metadata_memb);
@@ -420,6 +506,9 @@ send_packet(mac_callback_t sent, void *ptr)
                    list_length(n->queued_packet_list), memb_numfree(&packet_memb));
             /* If q is the first packet in the neighbor's queue, send asap */
             if(list_head(n->queued_packet_list) == q) {
+#if CSMA_WITH_NBR_TABLE
+              nbr_table_lock(neighbor_queues, n);
+#endif /* CSMA_WITH_NBR_TABLE */
               schedule_transmission(n);
             }
             return;
@@ -430,17 +519,17 @@ send_packet(mac_callback_t sent, void *ptr)
         memb_free(&packet_memb, q);
         PRINTF("csma: could not allocate queuebuf, dropping packet\n");
       }
+      STATS_INC(no_buffer);
+      STATS_ADD(n, drops, 1);
       /* The packet allocation failed. Remove and free neighbor entry if empty. */
       if(list_length(n->queued_packet_list) == 0) {
-        list_remove(neighbor_list, n);
-        memb_free(&neighbor_memb, n);
+        neighbor_queue_free(n);
       }
-    } else {
-      PRINTF("csma: Neighbor queue full\n");
     }
     PRINTF("csma: could not allocate packet, dropping packet\n");
   } else {
     PRINTF("csma: could not allocate neighbor, dropping packet\n");
+    STATS_INC(no_queue);
   }
   mac_call_sent_callback(sent, ptr, MAC_TX_ERR, 1);
 }
@@ -472,12 +561,60 @@ channel_check_interval(void)
   return 0;
 }
 /*---------------------------------------------------------------------------*/
+#if CSMA_WITH_NBR_TABLE
+/* Called when the neighbor table needs the space of a queue */
+static void
+neighbor_queue_removed(nbr_table_item_t *item)
+{
+  struct neighbor_queue *n = item;
+  struct rdc_buf_list *q;
+  struct qbuf_metadata *metadata;
+
+  ctimer_stop(&n->transmit_timer);
+  while((q = list_pop(n->queued_packet_list)) != NULL) {
+    metadata = q->ptr;
+    queuebuf_free(q->buf);
+    memb_free(&packet_memb, q);
+    STATS_INC(no_queue);
+    mac_call_sent_callback(metadata->sent, metadata->cptr, MAC_TX_ERR, 0);
+    memb_free(&metadata_memb, metadata);
+  }
+}
+#endif /* CSMA_WITH_NBR_TABLE */
+/*---------------------------------------------------------------------------*/
+#if CSMA_WITH_STATS
+const struct csma_stats *
+csma_get_stats(void)
+{
+  return &stats;
+}
+/*---------------------------------------------------------------------------*/
+int
+csma_get_neighbor_stats(const linkaddr_t *addr,
+    struct csma_neighbor_stats *neighbor_stats)
+{
+  struct neighbor_queue *n;
+
+  n = neighbor_queue_from_addr(addr);
+  if(n == NULL) {
+    return 0;
+  }
+  *neighbor_stats = n->stats;
+  neighbor_stats->queue_length = list_length(n->queued_packet_list);
+  return 1;
+}
+#endif /* CSMA_WITH_STATS */
+/*---------------------------------------------------------------------------*/
 static void
 init(void)
 {
   memb_init(&packet_memb);
   memb_init(&metadata_memb);
+#if CSMA_WITH_NBR_TABLE
+  nbr_table_register(neighbor_queues, neighbor_queue_removed);
+#else /* CSMA_WITH_NBR_TABLE */
   memb_init(&neighbor_memb);
+#endif /* CSMA_WITH_NBR_TABLE */
 }
 /*---------------------------------------------------------------------------*/
 const struct mac_driver csma_driver = {
@@ -42,10 +42,75 @@
 #define CSMA_H_
 
 #include "net/mac/mac.h"
+#include "net/linkaddr.h"
 #include "dev/radio.h"
 
+/* Keep the neighbor queues in a neighbor table instead of a list */
+#ifdef CSMA_CONF_WITH_NBR_TABLE
+#define CSMA_WITH_NBR_TABLE CSMA_CONF_WITH_NBR_TABLE
+#else /* CSMA_CONF_WITH_NBR_TABLE */
+#define CSMA_WITH_NBR_TABLE 0
+#endif /* CSMA_CONF_WITH_NBR_TABLE */
+
+/* Keep one neighbor from taking up the packets shared by all queues */
+#ifdef CSMA_CONF_WITH_FAIR_SHARE
+#define CSMA_WITH_FAIR_SHARE CSMA_CONF_WITH_FAIR_SHARE
+#else /* CSMA_CONF_WITH_FAIR_SHARE */
+#define CSMA_WITH_FAIR_SHARE 0
+#endif /* CSMA_CONF_WITH_FAIR_SHARE */
+
+/*
+ * With fair share, a neighbor queue may only grow while it is shorter than
+ * CSMA_FAIR_SHARE_ALPHA times the number of free packets. A lone neighbor
+ * can thus take up CSMA_FAIR_SHARE_ALPHA / (CSMA_FAIR_SHARE_ALPHA + 1) of
+ * the packets and the rest stays free for other neighbors.
+ */
+#ifdef CSMA_CONF_FAIR_SHARE_ALPHA
+#define CSMA_FAIR_SHARE_ALPHA CSMA_CONF_FAIR_SHARE_ALPHA
+#else /* CSMA_CONF_FAIR_SHARE_ALPHA */
+#define CSMA_FAIR_SHARE_ALPHA 2
+#endif /* CSMA_CONF_FAIR_SHARE_ALPHA */
+
+#ifdef CSMA_CONF_WITH_STATS
+#define CSMA_WITH_STATS CSMA_CONF_WITH_STATS
+#else /* CSMA_CONF_WITH_STATS */
+#define CSMA_WITH_STATS 0
+#endif /* CSMA_CONF_WITH_STATS */
+
+/* Dropped packets by reason */
+struct csma_stats {
+  uint16_t no_queue;
+  uint16_t queue_full;
+  uint16_t fair_share;
+  uint16_t no_buffer;
+  uint16_t noack;
+  uint16_t collision;
+  uint16_t err;
+};
+
+struct csma_neighbor_stats {
+  uint8_t queue_length;
+  uint16_t transmissions;
+  uint16_t retransmissions;
+  uint16_t drops;
+};
+
 extern const struct mac_driver csma_driver;
 
 const struct mac_driver *csma_init(const struct mac_driver *r);
 
+#if CSMA_WITH_STATS
+const struct csma_stats *csma_get_stats(void);
+
+/**
+ * \brief Gets the statistics of a neighbor.
+ * \retval 0 if CSMA has no queue for that neighbor
+ *
+ * Without CSMA_CONF_WITH_NBR_TABLE, the statistics of a neighbor are
+ * lost as soon as its queue runs empty.
+ */
+int csma_get_neighbor_stats(const linkaddr_t *addr,
+    struct csma_neighbor_stats *stats);
+#endif /* CSMA_WITH_STATS */
+
 #endif /* CSMA_H_ */
@@ -47,6 +47,7 @@
 #include "lib/memb.h"
 #include "lib/random.h"
 #include "net/queuebuf.h"
+#include "net/nbr-table.h"
 #include "net/mac/rdc.h"
 #include "net/mac/tsch/tsch.h"
 #include "net/mac/tsch/tsch-private.h"
@@ -54,6 +55,10 @@
 #include "net/mac/tsch/tsch-schedule.h"
 #include "net/mac/tsch/tsch-slot-operation.h"
 #include "net/mac/tsch/tsch-log.h"
+#if TSCH_QUEUE_SCHEDULER == TSCH_QUEUE_SCHEDULER_PRIORITY
+#include "net/ip/uip.h"
+#include "net/ipv6/uip-icmp6.h"
+#endif /* TSCH_QUEUE_SCHEDULER == TSCH_QUEUE_SCHEDULER_PRIORITY */
 #include <string.h>
 
 #if TSCH_LOG_LEVEL >= 1
@@ -77,6 +82,146 @@ LIST(neighbor_list);
 struct tsch_neighbor *n_broadcast;
 struct tsch_neighbor *n_eb;
 
+#if TSCH_QUEUE_SCHEDULER != TSCH_QUEUE_SCHEDULER_FIRST
+/* Neighbors we have no Tx link to, with packets and an expired backoff, in the
+ * order they will be served in shared slots. The list is only modified from
+ * the slot operation, or with the lock taken. Neighbors that stop being ready
+ * are removed when the list is next walked */
+static struct tsch_neighbor *ready_head;
+static struct tsch_neighbor *ready_tail;
+/* Neighbors that may have become ready, added by tsch_queue_notify_ready()
+ * and moved to the ready list by the slot operation */
+#define READY_PENDING_NUM 8
+static struct tsch_neighbor *ready_pending_array[READY_PENDING_NUM];
+static struct ringbufindex ready_pending_ringbuf;
+/* Set when ready_pending_ringbuf was full: look at all neighbors */
+static volatile uint8_t ready_rescan;
+#if TSCH_QUEUE_SCHEDULER == TSCH_QUEUE_SCHEDULER_PRIORITY
+/* Control packets that may still be sent before a waiting data packet */
+static uint8_t control_credit = TSCH_QUEUE_CONTROL_WEIGHT;
+#endif /* TSCH_QUEUE_SCHEDULER == TSCH_QUEUE_SCHEDULER_PRIORITY */
+#endif /* TSCH_QUEUE_SCHEDULER != TSCH_QUEUE_SCHEDULER_FIRST */
+
+#if TSCH_QUEUE_WITH_STATS
+/* Per-neighbor queue statistics */
+NBR_TABLE(struct tsch_queue_stats, queue_stats);
+#endif /* TSCH_QUEUE_WITH_STATS */
+
+#if TSCH_QUEUE_SCHEDULER != TSCH_QUEUE_SCHEDULER_FIRST
+/*---------------------------------------------------------------------------*/
+/* May the neighbor be served in a shared slot? */
+static int
+ready_nbr_is_ready(const struct tsch_neighbor *n)
+{
+  return !n->is_broadcast && n->tx_links_count == 0
+         && n->backoff_window == 0 && !ringbufindex_empty(&n->tx_ringbuf);
+}
+/*---------------------------------------------------------------------------*/
+/* Append a neighbor to the ready list if it is ready and not there yet */
+static void
+ready_add(struct tsch_neighbor *n)
+{
+  if(!n->is_ready && ready_nbr_is_ready(n)) {
+    n->is_ready = 1;
+    n->next_ready = NULL;
+    if(ready_tail != NULL) {
+      ready_tail->next_ready = n;
+    } else {
+      ready_head = n;
+    }
+    ready_tail = n;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Remove a neighbor from the ready list, given the neighbor before it */
+static void
+ready_unlink(struct tsch_neighbor *prev, struct tsch_neighbor *n)
+{
+  if(prev != NULL) {
+    prev->next_ready = n->next_ready;
+  } else {
+    ready_head = n->next_ready;
+  }
+  if(ready_tail == n) {
+    ready_tail = prev;
+  }
+  n->is_ready = 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Move the neighbors notified since the last shared slot to the ready list */
+static void
+ready_update(void)
+{
+  int16_t get_index;
+  struct tsch_neighbor *n;
+
+  while((get_index = ringbufindex_peek_get(&ready_pending_ringbuf)) != -1) {
+    ready_add(ready_pending_array[get_index]);
+    ringbufindex_get(&ready_pending_ringbuf);
+  }
+  if(ready_rescan) {
+    ready_rescan = 0;
+    for(n = list_head(neighbor_list); n != NULL; n = list_item_next(n)) {
+      ready_add(n);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Tell the shared slot scheduler that a neighbor may have become ready */
+void
+tsch_queue_notify_ready(struct tsch_neighbor *n)
+{
+  int16_t put_index = ringbufindex_peek_put(&ready_pending_ringbuf);
+  if(put_index != -1) {
+    ready_pending_array[put_index] = n;
+    ringbufindex_put(&ready_pending_ringbuf);
+  } else {
+    ready_rescan = 1;
+  }
+}
+#endif /* TSCH_QUEUE_SCHEDULER != TSCH_QUEUE_SCHEDULER_FIRST */
+#if TSCH_QUEUE_WITH_STATS
+/*---------------------------------------------------------------------------*/
+/* Account for a packet that has been sent or given up */
+static void
+update_stats(const struct tsch_packet *p)
+{
+  const linkaddr_t *addr = queuebuf_addr(p->qb, PACKETBUF_ADDR_RECEIVER);
+  struct tsch_queue_stats *stats;
+  clock_time_t latency;
+
+  if(linkaddr_cmp(addr, &linkaddr_null)) {
+    /* Broadcast */
+    return;
+  }
+  stats = nbr_table_get_from_lladdr(queue_stats, addr);
+  if(stats == NULL) {
+    stats = nbr_table_add_lladdr(queue_stats, addr, NBR_TABLE_REASON_MAC, NULL);
+    if(stats == NULL) {
+      return;
+    }
+    memset(stats, 0, sizeof(struct tsch_queue_stats));
+  }
+  if(p->ret == MAC_TX_OK) {
+    latency = clock_time() - p->enqueued;
+    stats->sent++;
+    stats->latency_sum += latency;
+    if(latency > stats->max_latency) {
+      stats->max_latency = latency;
+    }
+  } else {
+    stats->dropped++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Returns the queue statistics of a neighbor */
+const struct tsch_queue_stats *
+tsch_queue_get_stats(const linkaddr_t *addr)
+{
+  return nbr_table_get_from_lladdr(queue_stats, addr);
+}
+#endif /* TSCH_QUEUE_WITH_STATS */
+
 /*---------------------------------------------------------------------------*/
 /* Add a TSCH neighbor */
 struct tsch_neighbor *
@@ -216,6 +361,20 @@ tsch_queue_remove_nbr(struct tsch_neighbor *n)
       /* Remove neighbor from list */
       list_remove(neighbor_list, n);
 
+#if TSCH_QUEUE_SCHEDULER != TSCH_QUEUE_SCHEDULER_FIRST
+      /* No slot operation runs: clear any reference to the neighbor */
+      ready_update();
+      if(n->is_ready) {
+        struct tsch_neighbor *prev = NULL;
+        struct tsch_neighbor *curr = ready_head;
+        while(curr != n) {
+          prev = curr;
+          curr = curr->next_ready;
+        }
+        ready_unlink(prev, n);
+      }
+#endif /* TSCH_QUEUE_SCHEDULER != TSCH_QUEUE_SCHEDULER_FIRST */
+
       tsch_release_lock();
 
       /* Flush queue */
@@ -251,9 +410,19 @@ tsch_queue_add_packet(const linkaddr_t *addr, mac_callback_t sent, void *ptr)
             p->ptr = ptr;
             p->ret = MAC_TX_DEFERRED;
             p->transmissions = 0;
+#if TSCH_QUEUE_SCHEDULER == TSCH_QUEUE_SCHEDULER_PRIORITY
+            p->is_control = packetbuf_attr(PACKETBUF_ATTR_NETWORK_ID) == UIP_PROTO_ICMP6
+              && (packetbuf_attr(PACKETBUF_ATTR_CHANNEL) >> 8) == ICMP6_RPL;
+#endif /* TSCH_QUEUE_SCHEDULER == TSCH_QUEUE_SCHEDULER_PRIORITY */
+#if TSCH_QUEUE_WITH_STATS
+            p->enqueued = clock_time();
+#endif /* TSCH_QUEUE_WITH_STATS */
             /* Add to ringbuf (actual add committed through atomic operation) */
             n->tx_array[put_index] = p;
             ringbufindex_put(&n->tx_ringbuf);
+#if TSCH_QUEUE_SCHEDULER != TSCH_QUEUE_SCHEDULER_FIRST
+            tsch_queue_notify_ready(n);
+#endif /* TSCH_QUEUE_SCHEDULER != TSCH_QUEUE_SCHEDULER_FIRST */
             PRINTF("TSCH-queue: packet is added put_index=%u, packet=%p\n",
                    put_index, p);
             return p;
@@ -306,6 +475,11 @@ void
 tsch_queue_free_packet(struct tsch_packet *p)
 {
   if(p != NULL) {
+#if TSCH_QUEUE_WITH_STATS
+    if(p->ret != MAC_TX_DEFERRED) {
+      update_stats(p);
+    }
+#endif /* TSCH_QUEUE_WITH_STATS */
     queuebuf_free(p->qb);
     memb_free(&packet_memb, p);
   }
@@ -399,6 +573,79 @@ tsch_queue_get_packet_for_dest_addr(const linkaddr_t *addr, struct tsch_link *li
 struct tsch_packet *
 tsch_queue_get_unicast_packet_for_any(struct tsch_neighbor **n, struct tsch_link *link)
 {
+#if TSCH_QUEUE_SCHEDULER != TSCH_QUEUE_SCHEDULER_FIRST
+  if(!tsch_is_locked()) {
+    struct tsch_neighbor *prev = NULL;
+    struct tsch_neighbor *curr_nbr;
+    struct tsch_neighbor *next_nbr;
+    struct tsch_neighbor *best_prev = NULL;
+    struct tsch_neighbor *best_nbr = NULL;
+    struct tsch_packet *best = NULL;
+    struct tsch_packet *p;
+#if TSCH_QUEUE_SCHEDULER == TSCH_QUEUE_SCHEDULER_PRIORITY
+    struct tsch_neighbor *control_prev = NULL;
+    struct tsch_neighbor *control_nbr = NULL;
+    struct tsch_packet *control = NULL;
+#endif /* TSCH_QUEUE_SCHEDULER == TSCH_QUEUE_SCHEDULER_PRIORITY */
+
+    ready_update();
+    for(curr_nbr = ready_head; curr_nbr != NULL; curr_nbr = next_nbr) {
+      next_nbr = curr_nbr->next_ready;
+      if(!ready_nbr_is_ready(curr_nbr)) {
+        ready_unlink(prev, curr_nbr);
+        continue;
+      }
+      p = tsch_queue_get_packet_for_nbr(curr_nbr, link);
+      if(p != NULL) {
+#if TSCH_QUEUE_SCHEDULER == TSCH_QUEUE_SCHEDULER_PRIORITY
+        if(p->is_control) {
+          if(control == NULL) {
+            control = p;
+            control_nbr = curr_nbr;
+            control_prev = prev;
+          }
+        } else if(best == NULL) {
+          best = p;
+          best_nbr = curr_nbr;
+          best_prev = prev;
+        }
+        if(best != NULL && (control != NULL || control_credit == 0)) {
+          break;
+        }
+#else /* TSCH_QUEUE_SCHEDULER == TSCH_QUEUE_SCHEDULER_PRIORITY */
+        best = p;
+        best_nbr = curr_nbr;
+        best_prev = prev;
+        break;
+#endif /* TSCH_QUEUE_SCHEDULER == TSCH_QUEUE_SCHEDULER_PRIORITY */
+      }
+      prev = curr_nbr;
+    }
+
+#if TSCH_QUEUE_SCHEDULER == TSCH_QUEUE_SCHEDULER_PRIORITY
+    if(control != NULL && (best == NULL || control_credit > 0)) {
+      if(best != NULL) {
+        control_credit--;
+      }
+      best = control;
+      best_nbr = control_nbr;
+      best_prev = control_prev;
+    } else if(best != NULL) {
+      control_credit = TSCH_QUEUE_CONTROL_WEIGHT;
+    }
+#endif /* TSCH_QUEUE_SCHEDULER == TSCH_QUEUE_SCHEDULER_PRIORITY */
+
+    if(best != NULL) {
+      /* Serve the other ready neighbors first next time */
+      ready_unlink(best_prev, best_nbr);
+      ready_add(best_nbr);
+      if(n != NULL) {
+        *n = best_nbr;
+      }
+      return best;
+    }
+  }
+#else /* TSCH_QUEUE_SCHEDULER != TSCH_QUEUE_SCHEDULER_FIRST */
   if(!tsch_is_locked()) {
     struct tsch_neighbor *curr_nbr = list_head(neighbor_list);
     struct tsch_packet *p = NULL;
@@ -416,6 +663,7 @@ tsch_queue_get_unicast_packet_for_any(struct tsch_neighbor **n, struct tsch_link
       curr_nbr = list_item_next(curr_nbr);
     }
   }
+#endif /* TSCH_QUEUE_SCHEDULER != TSCH_QUEUE_SCHEDULER_FIRST */
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
@@ -461,6 +709,11 @@ tsch_queue_update_all_backoff_windows(const linkaddr_t *dest_addr)
          && ((n->tx_links_count == 0 && is_broadcast)
              || (n->tx_links_count > 0 && linkaddr_cmp(dest_addr, &n->addr)))) {
         n->backoff_window--;
+#if TSCH_QUEUE_SCHEDULER != TSCH_QUEUE_SCHEDULER_FIRST
+        if(n->backoff_window == 0) {
+          ready_add(n);
+        }
+#endif /* TSCH_QUEUE_SCHEDULER != TSCH_QUEUE_SCHEDULER_FIRST */
       }
       n = list_item_next(n);
     }
@@ -474,6 +727,14 @@ tsch_queue_init(void)
   list_init(neighbor_list);
   memb_init(&neighbor_memb);
   memb_init(&packet_memb);
+#if TSCH_QUEUE_SCHEDULER != TSCH_QUEUE_SCHEDULER_FIRST
+  ready_head = ready_tail = NULL;
+  ringbufindex_init(&ready_pending_ringbuf, READY_PENDING_NUM);
+  ready_rescan = 0;
+#endif /* TSCH_QUEUE_SCHEDULER != TSCH_QUEUE_SCHEDULER_FIRST */
+#if TSCH_QUEUE_WITH_STATS
+  nbr_table_register(queue_stats, NULL);
+#endif /* TSCH_QUEUE_WITH_STATS */
   /* Add virtual EB and the broadcast neighbors */
   n_eb = tsch_queue_add_nbr(&tsch_eb_address);
   n_broadcast = tsch_queue_add_nbr(&tsch_broadcast_address);
@@ -97,6 +97,36 @@
 #define TSCH_MAC_MAX_FRAME_RETRIES 8
 #endif
 
+/* How the neighbor to send to in a shared slot is picked among the neighbors
+ * we have no Tx link to. FIRST takes the first one in the neighbor list that
+ * has a packet. ROUND_ROBIN keeps a list of the neighbors with packets and an
+ * expired backoff, and serves them in turn. PRIORITY does the same, but sends
+ * RPL control packets first: TSCH_QUEUE_CONTROL_WEIGHT of them for every data
+ * packet while both are waiting */
+#define TSCH_QUEUE_SCHEDULER_FIRST       0
+#define TSCH_QUEUE_SCHEDULER_ROUND_ROBIN 1
+#define TSCH_QUEUE_SCHEDULER_PRIORITY    2
+
+#ifdef TSCH_QUEUE_CONF_SCHEDULER
+#define TSCH_QUEUE_SCHEDULER TSCH_QUEUE_CONF_SCHEDULER
+#else
+#define TSCH_QUEUE_SCHEDULER TSCH_QUEUE_SCHEDULER_FIRST
+#endif
+
+#ifdef TSCH_QUEUE_CONF_CONTROL_WEIGHT
+#define TSCH_QUEUE_CONTROL_WEIGHT TSCH_QUEUE_CONF_CONTROL_WEIGHT
+#else
+#define TSCH_QUEUE_CONTROL_WEIGHT 4
+#endif
+
+/* Count the packets sent to and dropped for each neighbor, and their
+ * queueing latency. See tsch_queue_get_stats() */
+#ifdef TSCH_QUEUE_CONF_WITH_STATS
+#define TSCH_QUEUE_WITH_STATS TSCH_QUEUE_CONF_WITH_STATS
+#else
+#define TSCH_QUEUE_WITH_STATS 0
+#endif
+
 /*********** Callbacks *********/
 
 /* Called by TSCH when switching time source */
@@ -121,6 +151,12 @@ struct tsch_packet {
   uint8_t ret; /* status -- MAC return code */
   uint8_t header_len; /* length of header and header IEs (needed for link-layer security) */
   uint8_t tsch_sync_ie_offset; /* Offset within the frame used for quick update of EB ASN and join priority */
+#if TSCH_QUEUE_SCHEDULER == TSCH_QUEUE_SCHEDULER_PRIORITY
+  uint8_t is_control; /* is this an RPL control packet? */
+#endif /* TSCH_QUEUE_SCHEDULER == TSCH_QUEUE_SCHEDULER_PRIORITY */
+#if TSCH_QUEUE_WITH_STATS
+  clock_time_t enqueued; /* time when the packet was added to the queue */
+#endif /* TSCH_QUEUE_WITH_STATS */
 };
 
 /* TSCH neighbor information */
@@ -135,6 +171,10 @@ struct tsch_neighbor {
   uint8_t last_backoff_window; /* Last CSMA backoff window */
   uint8_t tx_links_count; /* How many links do we have to this neighbor? */
   uint8_t dedicated_tx_links_count; /* How many dedicated links do we have to this neighbor? */
+#if TSCH_QUEUE_SCHEDULER != TSCH_QUEUE_SCHEDULER_FIRST
+  uint8_t is_ready; /* is this neighbor in the list of neighbors ready for shared slots? */
+  struct tsch_neighbor *next_ready; /* next neighbor in that list */
+#endif /* TSCH_QUEUE_SCHEDULER != TSCH_QUEUE_SCHEDULER_FIRST */
   /* Array for the ringbuf. Contains pointers to packets.
    * Its size must be a power of two to allow for atomic put */
   struct tsch_packet *tx_array[TSCH_QUEUE_NUM_PER_NEIGHBOR];
@@ -142,6 +182,16 @@ struct tsch_neighbor {
   struct ringbufindex tx_ringbuf;
 };
 
+#if TSCH_QUEUE_WITH_STATS
+/* Queue statistics of a neighbor */
+struct tsch_queue_stats {
+  uint32_t sent; /* packets sent successfully */
+  uint32_t dropped; /* packets given up after retries or flushed */
+  uint32_t latency_sum; /* sum of the queueing latency of sent packets, in clock ticks */
+  clock_time_t max_latency; /* highest queueing latency of a sent packet */
+};
+#endif /* TSCH_QUEUE_WITH_STATS */
+
 /***** External Variables *****/
 
 /* Broadcast and EB virtual neighbors */
@@ -188,6 +238,15 @@ void tsch_queue_backoff_reset(struct tsch_neighbor *n);
 void tsch_queue_backoff_inc(struct tsch_neighbor *n);
 /* Decrement backoff window for all queues directed at dest_addr */
 void tsch_queue_update_all_backoff_windows(const linkaddr_t *dest_addr);
+#if TSCH_QUEUE_SCHEDULER != TSCH_QUEUE_SCHEDULER_FIRST
+/* Tell the shared slot scheduler that a neighbor may have packets to send in
+ * shared slots, for instance because we no longer have a Tx link to it */
+void tsch_queue_notify_ready(struct tsch_neighbor *n);
+#endif /* TSCH_QUEUE_SCHEDULER != TSCH_QUEUE_SCHEDULER_FIRST */
+#if TSCH_QUEUE_WITH_STATS
+/* Returns the queue statistics of a neighbor, NULL if none */
+const struct tsch_queue_stats *tsch_queue_get_stats(const linkaddr_t *addr);
+#endif /* TSCH_QUEUE_WITH_STATS */
 /* Initialize TSCH queue module */
 void tsch_queue_init(void);
 
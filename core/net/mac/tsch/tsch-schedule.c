@@ -68,6 +68,80 @@ MEMB(link_memb, struct tsch_link, TSCH_SCHEDULE_MAX_LINKS);
 MEMB(slotframe_memb, struct tsch_slotframe, TSCH_SCHEDULE_MAX_SLOTFRAMES);
 /* List of slotframes (each slotframe holds its own list of links) */
 LIST(slotframe_list);
+#if TSCH_SCHEDULE_WITH_TIMESLOT_INDEX
+/* Links of all slotframes. The links of a slotframe are stored contiguously,
+ * sorted by timeslot, starting from the index_start of the slotframe */
+static struct tsch_link *link_index[TSCH_SCHEDULE_MAX_LINKS];
+static uint16_t link_index_count;
+
+/*---------------------------------------------------------------------------*/
+/* Returns the position of the first link of a slotframe with a timeslot
+ * greater than or equal to a given timeslot */
+static uint16_t
+index_search(const struct tsch_slotframe *sf, uint16_t timeslot)
+{
+  uint16_t low = sf->index_start;
+  uint16_t high = sf->index_start + sf->links_count;
+  while(low < high) {
+    uint16_t mid = low + (high - low) / 2;
+    if(link_index[mid]->timeslot < timeslot) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+}
+/*---------------------------------------------------------------------------*/
+/* Inserts a link in the index. Call with the lock taken */
+static void
+index_add(struct tsch_slotframe *slotframe, struct tsch_link *l)
+{
+  struct tsch_slotframe *sf;
+  uint16_t pos;
+
+  if(slotframe->links_count == 0) {
+    slotframe->index_start = link_index_count;
+  }
+  pos = index_search(slotframe, l->timeslot);
+  memmove(&link_index[pos + 1], &link_index[pos],
+          (link_index_count - pos) * sizeof(link_index[0]));
+  link_index[pos] = l;
+  link_index_count++;
+  /* Shift the slotframes stored after the insertion point */
+  for(sf = list_head(slotframe_list); sf != NULL; sf = list_item_next(sf)) {
+    if(sf != slotframe && sf->links_count > 0 && sf->index_start >= pos) {
+      sf->index_start++;
+    }
+  }
+  slotframe->links_count++;
+}
+/*---------------------------------------------------------------------------*/
+/* Removes a link from the index. Call with the lock taken */
+static void
+index_remove(struct tsch_slotframe *slotframe, struct tsch_link *l)
+{
+  struct tsch_slotframe *sf;
+  uint16_t pos;
+
+  for(pos = slotframe->index_start;
+      pos < slotframe->index_start + slotframe->links_count; pos++) {
+    if(link_index[pos] == l) {
+      link_index_count--;
+      memmove(&link_index[pos], &link_index[pos + 1],
+              (link_index_count - pos) * sizeof(link_index[0]));
+      for(sf = list_head(slotframe_list); sf != NULL; sf = list_item_next(sf)) {
+        if(sf != slotframe && sf->links_count > 0 && sf->index_start > pos) {
+          sf->index_start--;
+        }
+      }
+      slotframe->links_count--;
+      return;
+    }
+  }
+}
+#endif /* TSCH_SCHEDULE_WITH_TIMESLOT_INDEX */
+/*---------------------------------------------------------------------------*/
 
 /* Adds and returns a slotframe (NULL if failure) */
 struct tsch_slotframe *
@@ -89,6 +163,9 @@ tsch_schedule_add_slotframe(uint16_t handle, uint16_t size)
       sf->handle = handle;
       TSCH_ASN_DIVISOR_INIT(sf->size, size);
       LIST_STRUCT_INIT(sf, links_list);
+#if TSCH_SCHEDULE_WITH_TIMESLOT_INDEX
+      sf->links_count = 0;
+#endif /* TSCH_SCHEDULE_WITH_TIMESLOT_INDEX */
       /* Add the slotframe to the global list */
       list_add(slotframe_list, sf);
     }
@@ -209,6 +286,9 @@ tsch_schedule_add_link(struct tsch_slotframe *slotframe,
           address = &linkaddr_null;
         }
         linkaddr_copy(&l->addr, address);
+#if TSCH_SCHEDULE_WITH_TIMESLOT_INDEX
+        index_add(slotframe, l);
+#endif /* TSCH_SCHEDULE_WITH_TIMESLOT_INDEX */
 
         PRINTF("TSCH-schedule: add_link %u %u %u %u %u %u\n",
                slotframe->handle, link_options, link_type, timeslot, channel_offset, TSCH_LOG_ID_FROM_LINKADDR(address));
@@ -256,6 +336,9 @@ tsch_schedule_remove_link(struct tsch_slotframe *slotframe, struct tsch_link *l)
              TSCH_LOG_ID_FROM_LINKADDR(&l->addr));
 
       list_remove(slotframe->links_list, l);
+#if TSCH_SCHEDULE_WITH_TIMESLOT_INDEX
+      index_remove(slotframe, l);
+#endif /* TSCH_SCHEDULE_WITH_TIMESLOT_INDEX */
       memb_free(&link_memb, l);
 
       /* Release the lock before we update the neighbor (will take the lock) */
@@ -269,6 +352,12 @@ tsch_schedule_remove_link(struct tsch_slotframe *slotframe, struct tsch_link *l)
           if(!(link_options & LINK_OPTION_SHARED)) {
             n->dedicated_tx_links_count--;
           }
+#if TSCH_QUEUE_SCHEDULER != TSCH_QUEUE_SCHEDULER_FIRST
+          if(n->tx_links_count == 0) {
+            /* Queued packets can now go in shared slots */
+            tsch_queue_notify_ready(n);
+          }
+#endif /* TSCH_QUEUE_SCHEDULER != TSCH_QUEUE_SCHEDULER_FIRST */
         }
       }
 
@@ -294,6 +383,16 @@ tsch_schedule_get_link_by_timeslot(struct tsch_slotframe *slotframe, uint16_t ti
 {
   if(!tsch_is_locked()) {
     if(slotframe != NULL) {
+#if TSCH_SCHEDULE_WITH_TIMESLOT_INDEX
+      if(slotframe->links_count > 0) {
+        uint16_t pos = index_search(slotframe, timeslot);
+        if(pos < slotframe->index_start + slotframe->links_count
+           && link_index[pos]->timeslot == timeslot) {
+          return link_index[pos];
+        }
+      }
+      return NULL;
+#else /* TSCH_SCHEDULE_WITH_TIMESLOT_INDEX */
       struct tsch_link *l = list_head(slotframe->links_list);
       /* Loop over all items. Assume there is max one link per timeslot */
       while(l != NULL) {
@@ -303,11 +402,58 @@ tsch_schedule_get_link_by_timeslot(struct tsch_slotframe *slotframe, uint16_t ti
         l = list_item_next(l);
       }
       return l;
+#endif /* TSCH_SCHEDULE_WITH_TIMESLOT_INDEX */
     }
   }
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
+/* Compares a link that is time_to_timeslot away with the best link found so
+ * far, and updates the best link and its backup */
+static void
+select_link(struct tsch_link *l, uint16_t time_to_timeslot,
+            struct tsch_link **curr_best, uint16_t *time_to_curr_best,
+            struct tsch_link **curr_backup)
+{
+  if(*curr_best == NULL || time_to_timeslot < *time_to_curr_best) {
+    *time_to_curr_best = time_to_timeslot;
+    *curr_best = l;
+    *curr_backup = NULL;
+  } else if(time_to_timeslot == *time_to_curr_best) {
+    struct tsch_link *new_best = NULL;
+    /* Two links are overlapping, we need to select one of them.
+     * By standard: prioritize Tx links first, second by lowest handle */
+    if(((*curr_best)->link_options & LINK_OPTION_TX) == (l->link_options & LINK_OPTION_TX)) {
+      /* Both or neither links have Tx, select the one with lowest handle */
+      if(l->slotframe_handle < (*curr_best)->slotframe_handle) {
+        new_best = l;
+      }
+    } else {
+      /* Select the link that has the Tx option */
+      if(l->link_options & LINK_OPTION_TX) {
+        new_best = l;
+      }
+    }
+
+    /* Maintain backup_link */
+    if(*curr_backup == NULL) {
+      /* Check if 'l' best can be used as backup */
+      if(new_best != l && (l->link_options & LINK_OPTION_RX)) { /* Does 'l' have Rx flag? */
+        *curr_backup = l;
+      }
+      /* Check if curr_best can be used as backup */
+      if(new_best != *curr_best && ((*curr_best)->link_options & LINK_OPTION_RX)) { /* Does curr_best have Rx flag? */
+        *curr_backup = *curr_best;
+      }
+    }
+
+    /* Maintain curr_best */
+    if(new_best != NULL) {
+      *curr_best = new_best;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
 /* Returns the next active link after a given ASN, and a backup link (for the same ASN, with Rx flag) */
 struct tsch_link *
 tsch_schedule_get_next_active_link(struct tsch_asn_t *asn, uint16_t *time_offset,
@@ -325,52 +471,33 @@ tsch_schedule_get_next_active_link(struct tsch_asn_t *asn, uint16_t *time_offset
     while(sf != NULL) {
       /* Get timeslot from ASN, given the slotframe length */
       uint16_t timeslot = TSCH_ASN_MOD(*asn, sf->size);
+#if TSCH_SCHEDULE_WITH_TIMESLOT_INDEX
+      if(sf->links_count > 0) {
+        /* Only the first link after the timeslot, or when wrapping around,
+         * the first link of the slotframe can be the earliest one */
+        uint16_t pos = index_search(sf, timeslot + 1);
+        struct tsch_link *first = link_index[sf->index_start];
+        if(pos < sf->index_start + sf->links_count) {
+          select_link(link_index[pos], link_index[pos]->timeslot - timeslot,
+                      &curr_best, &time_to_curr_best, &curr_backup);
+        }
+        if(first->timeslot <= timeslot) {
+          select_link(first, sf->size.val + first->timeslot - timeslot,
+                      &curr_best, &time_to_curr_best, &curr_backup);
+        }
+      }
+#else /* TSCH_SCHEDULE_WITH_TIMESLOT_INDEX */
       struct tsch_link *l = list_head(sf->links_list);
       while(l != NULL) {
         uint16_t time_to_timeslot =
           l->timeslot > timeslot ?
           l->timeslot - timeslot :
           sf->size.val + l->timeslot - timeslot;
-        if(curr_best == NULL || time_to_timeslot < time_to_curr_best) {
-          time_to_curr_best = time_to_timeslot;
-          curr_best = l;
-          curr_backup = NULL;
-        } else if(time_to_timeslot == time_to_curr_best) {
-          struct tsch_link *new_best = NULL;
-          /* Two links are overlapping, we need to select one of them.
-           * By standard: prioritize Tx links first, second by lowest handle */
-          if((curr_best->link_options & LINK_OPTION_TX) == (l->link_options & LINK_OPTION_TX)) {
-            /* Both or neither links have Tx, select the one with lowest handle */
-            if(l->slotframe_handle < curr_best->slotframe_handle) {
-              new_best = l;
-            }
-          } else {
-            /* Select the link that has the Tx option */
-            if(l->link_options & LINK_OPTION_TX) {
-              new_best = l;
-            }
-          }
-
-          /* Maintain backup_link */
-          if(curr_backup == NULL) {
-            /* Check if 'l' best can be used as backup */
-            if(new_best != l && (l->link_options & LINK_OPTION_RX)) { /* Does 'l' have Rx flag? */
-              curr_backup = l;
-            }
-            /* Check if curr_best can be used as backup */
-            if(new_best != curr_best && (curr_best->link_options & LINK_OPTION_RX)) { /* Does curr_best have Rx flag? */
-              curr_backup = curr_best;
-            }
-          }
-
-          /* Maintain curr_best */
-          if(new_best != NULL) {
-            curr_best = new_best;
-          }
-        }
-
+        select_link(l, time_to_timeslot,
+                    &curr_best, &time_to_curr_best, &curr_backup);
         l = list_item_next(l);
       }
+#endif /* TSCH_SCHEDULE_WITH_TIMESLOT_INDEX */
       sf = list_item_next(sf);
     }
     if(time_offset != NULL) {
@@ -391,6 +518,9 @@ tsch_schedule_init(void)
     memb_init(&link_memb);
     memb_init(&slotframe_memb);
     list_init(slotframe_list);
+#if TSCH_SCHEDULE_WITH_TIMESLOT_INDEX
+    link_index_count = 0;
+#endif /* TSCH_SCHEDULE_WITH_TIMESLOT_INDEX */
     tsch_release_lock();
     return 1;
   } else {
@@ -72,6 +72,15 @@
 #define TSCH_SCHEDULE_MAX_LINKS 32
 #endif
 
+/* Keep the links of each slotframe sorted by timeslot, so that looking for
+ * the next active link takes a binary search per slotframe instead of a walk
+ * over all its links */
+#ifdef TSCH_SCHEDULE_CONF_WITH_TIMESLOT_INDEX
+#define TSCH_SCHEDULE_WITH_TIMESLOT_INDEX TSCH_SCHEDULE_CONF_WITH_TIMESLOT_INDEX
+#else
+#define TSCH_SCHEDULE_WITH_TIMESLOT_INDEX 0
+#endif
+
 /********** Constants *********/
 
 /* Link options */
@@ -122,6 +131,12 @@ struct tsch_slotframe {
   struct tsch_asn_divisor_t size;
   /* List of links belonging to this slotframe */
   LIST_STRUCT(links_list);
+#if TSCH_SCHEDULE_WITH_TIMESLOT_INDEX
+  /* Position of the first link of this slotframe in the timeslot index,
+   * and number of links (the index is valid only if links_count > 0) */
+  uint16_t index_start;
+  uint16_t links_count;
+#endif /* TSCH_SCHEDULE_WITH_TIMESLOT_INDEX */
 };
 
 /********** Functions *********/
@@ -86,6 +86,17 @@ static unsigned num_tables;
 MEMB(neighbor_addr_mem, nbr_table_key_t, NBR_TABLE_MAX_NEIGHBORS);
 LIST(nbr_table_keys);
 
+#if NBR_TABLE_WITH_HASH_INDEX
+/* Hash index over the keys, using linear probing. Each slot holds the
+ * neighbor index plus one, zero marks an empty slot */
+#if NBR_TABLE_MAX_NEIGHBORS < 255
+typedef uint8_t hash_slot_t;
+#else /* NBR_TABLE_MAX_NEIGHBORS < 255 */
+typedef uint16_t hash_slot_t;
+#endif /* NBR_TABLE_MAX_NEIGHBORS < 255 */
+static hash_slot_t hash_index[NBR_TABLE_HASH_INDEX_SIZE];
+#endif /* NBR_TABLE_WITH_HASH_INDEX */
+
 /*---------------------------------------------------------------------------*/
 /* Get a key from a neighbor index */
 static nbr_table_key_t *
@@ -128,17 +139,96 @@ key_from_item(nbr_table_t *table, const nbr_table_item_t *item)
 {
   return key_from_index(index_from_item(table, item));
 }
+#if NBR_TABLE_WITH_HASH_INDEX
+/*---------------------------------------------------------------------------*/
+/* Get the preferred hash index slot of a link-layer address */
+static int
+hash_home(const linkaddr_t *lladdr)
+{
+  uint16_t hash;
+  int i;
+
+  hash = 0;
+  for(i = 0; i < LINKADDR_SIZE; i++) {
+    hash = (hash << 5) + hash + lladdr->u8[i];
+  }
+  return hash % NBR_TABLE_HASH_INDEX_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+/* Add a key to the hash index */
+static void
+hash_add(nbr_table_key_t *key)
+{
+  int slot;
+
+  slot = hash_home(&key->lladdr);
+  while(hash_index[slot] != 0) {
+    slot = (slot + 1) % NBR_TABLE_HASH_INDEX_SIZE;
+  }
+  hash_index[slot] = index_from_key(key) + 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Remove a key from the hash index. Later entries of the same probe
+ * sequence are shifted back, so that no tombstones are needed */
+static void
+hash_remove(nbr_table_key_t *key)
+{
+  int hole;
+  int slot;
+  int home;
+
+  hole = hash_home(&key->lladdr);
+  while(hash_index[hole] != index_from_key(key) + 1) {
+    if(hash_index[hole] == 0) {
+      return;
+    }
+    hole = (hole + 1) % NBR_TABLE_HASH_INDEX_SIZE;
+  }
+
+  slot = hole;
+  while(1) {
+    slot = (slot + 1) % NBR_TABLE_HASH_INDEX_SIZE;
+    if(hash_index[slot] == 0) {
+      break;
+    }
+    home = hash_home(&key_from_index(hash_index[slot] - 1)->lladdr);
+    /* Leave the entry where it is if its home lies cyclically in
+     * (hole, slot] */
+    if(hole <= slot
+       ? (hole < home && home <= slot)
+       : (hole < home || home <= slot)) {
+      continue;
+    }
+    hash_index[hole] = hash_index[slot];
+    hole = slot;
+  }
+  hash_index[hole] = 0;
+}
+#endif /* NBR_TABLE_WITH_HASH_INDEX */
 /*---------------------------------------------------------------------------*/
 /* Get the index of a neighbor from its link-layer address */
 static int
 index_from_lladdr(const linkaddr_t *lladdr)
 {
+#if NBR_TABLE_WITH_HASH_INDEX
+  int slot;
+#else /* NBR_TABLE_WITH_HASH_INDEX */
   nbr_table_key_t *key;
+#endif /* NBR_TABLE_WITH_HASH_INDEX */
   /* Allow lladdr-free insertion, useful e.g. for IPv6 ND.
    * Only one such entry is possible at a time, indexed by linkaddr_null. */
   if(lladdr == NULL) {
     lladdr = &linkaddr_null;
   }
+#if NBR_TABLE_WITH_HASH_INDEX
+  slot = hash_home(lladdr);
+  while(hash_index[slot] != 0) {
+    if(linkaddr_cmp(lladdr, &key_from_index(hash_index[slot] - 1)->lladdr)) {
+      return hash_index[slot] - 1;
+    }
+    slot = (slot + 1) % NBR_TABLE_HASH_INDEX_SIZE;
+  }
+#else /* NBR_TABLE_WITH_HASH_INDEX */
   key = list_head(nbr_table_keys);
   while(key != NULL) {
     if(lladdr && linkaddr_cmp(lladdr, &key->lladdr)) {
@@ -146,6 +236,7 @@ index_from_lladdr(const linkaddr_t *lladdr)
     }
     key = list_item_next(key);
   }
+#endif /* NBR_TABLE_WITH_HASH_INDEX */
   return -1;
 }
 /*---------------------------------------------------------------------------*/
@@ -198,6 +289,9 @@ remove_key(nbr_table_key_t *least_used_key)
   used_map[index_from_key(least_used_key)] = 0;
   /* Remove neighbor from list */
   list_remove(nbr_table_keys, least_used_key);
+#if NBR_TABLE_WITH_HASH_INDEX
+  hash_remove(least_used_key);
+#endif /* NBR_TABLE_WITH_HASH_INDEX */
 }
 /*---------------------------------------------------------------------------*/
 static nbr_table_key_t *
@@ -369,6 +463,9 @@ nbr_table_add_lladdr(nbr_table_t *table, const linkaddr_t *lladdr, nbr_table_rea
 
     /* Set link-layer address */
     linkaddr_copy(&key->lladdr, lladdr);
+#if NBR_TABLE_WITH_HASH_INDEX
+    hash_add(key);
+#endif /* NBR_TABLE_WITH_HASH_INDEX */
   }
 
   /* Get item in the current table */
@@ -466,11 +563,17 @@ nbr_table_update_lladdr(const linkaddr_t *old_addr, const linkaddr_t *new_addr,
     return 0;
   }
   key = key_from_index(index);
+#if NBR_TABLE_WITH_HASH_INDEX
+  hash_remove(key);
+#endif /* NBR_TABLE_WITH_HASH_INDEX */
   /**
    * Copy the new lladdr into the key - since we know that there is no
    * conflicting entry.
    */
   memcpy(&key->lladdr, new_addr, sizeof(linkaddr_t));
+#if NBR_TABLE_WITH_HASH_INDEX
+  hash_add(key);
+#endif /* NBR_TABLE_WITH_HASH_INDEX */
   NBR_TABLE_RELEASE_LOCK();
   return 1;
 }
@@ -46,6 +46,28 @@
 #define NBR_TABLE_MAX_NEIGHBORS 8
 #endif /* NBR_TABLE_CONF_MAX_NEIGHBORS */
 
+/* Keep an open-addressing hash index over the link-layer addresses of
+ * the neighbors, so that looking up a neighbor does not scan the whole
+ * key list */
+#ifdef NBR_TABLE_CONF_WITH_HASH_INDEX
+#define NBR_TABLE_WITH_HASH_INDEX NBR_TABLE_CONF_WITH_HASH_INDEX
+#else /* NBR_TABLE_CONF_WITH_HASH_INDEX */
+#define NBR_TABLE_WITH_HASH_INDEX 0
+#endif /* NBR_TABLE_CONF_WITH_HASH_INDEX */
+
+/* Number of slots of the hash index. Should be well above
+ * NBR_TABLE_MAX_NEIGHBORS to keep probe sequences short */
+#ifdef NBR_TABLE_CONF_HASH_INDEX_SIZE
+#define NBR_TABLE_HASH_INDEX_SIZE NBR_TABLE_CONF_HASH_INDEX_SIZE
+#else /* NBR_TABLE_CONF_HASH_INDEX_SIZE */
+#define NBR_TABLE_HASH_INDEX_SIZE (2 * NBR_TABLE_MAX_NEIGHBORS)
+#endif /* NBR_TABLE_CONF_HASH_INDEX_SIZE */
+
+/* Lookups stop at an empty slot, so a full table must leave one */
+#if NBR_TABLE_WITH_HASH_INDEX && NBR_TABLE_HASH_INDEX_SIZE <= NBR_TABLE_MAX_NEIGHBORS
+#error "NBR_TABLE_HASH_INDEX_SIZE must be greater than NBR_TABLE_MAX_NEIGHBORS"
+#endif
+
 #ifndef NBR_TABLE_CONF_WITH_LOCKING
 #define NBR_TABLE_CONF_WITH_LOCKING 0
 #endif /* NBR_TABLE_CONF_WITH_LOCKING */
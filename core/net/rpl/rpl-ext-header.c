@@ -310,6 +310,26 @@ rpl_process_srh_header(void)
   return 0;
 }
 /*---------------------------------------------------------------------------*/
+#if RPL_NS_SRH_CACHE_SIZE
+/* A source routing header as last inserted towards dest */
+struct srh_cache_entry {
+  rpl_ns_node_t *dest;
+  rpl_ns_node_t *next_hop;
+  uint16_t generation;
+  uint8_t ext_len;
+  uint8_t header[RPL_NS_SRH_CACHE_HEADER_LEN];
+};
+static struct srh_cache_entry srh_cache[RPL_NS_SRH_CACHE_SIZE];
+/*---------------------------------------------------------------------------*/
+static struct srh_cache_entry *
+srh_cache_entry(const rpl_ns_node_t *dest)
+{
+  /* nodes are allocated from an array, so neighboring ones do not collide */
+  return &srh_cache[((uintptr_t)dest / sizeof(rpl_ns_node_t))
+      % RPL_NS_SRH_CACHE_SIZE];
+}
+#endif /* RPL_NS_SRH_CACHE_SIZE */
+/*---------------------------------------------------------------------------*/
 static int
 count_matching_bytes(const void *p1, const void *p2, size_t n)
 {
@@ -337,6 +357,9 @@ insert_srh_header(void)
   rpl_ns_node_t *node;
   rpl_dag_t *dag;
   uip_ipaddr_t node_addr;
+#if RPL_NS_SRH_CACHE_SIZE
+  struct srh_cache_entry *entry;
+#endif /* RPL_NS_SRH_CACHE_SIZE */
 
   PRINTF("RPL: SRH creating source routing header with destination ");
   PRINT6ADDR(&UIP_IP_BUF->destipaddr);
@@ -364,6 +387,26 @@ insert_srh_header(void)
     return 0;
   }
 
+#if RPL_NS_SRH_CACHE_SIZE
+  /* No parent changed since the cached header was built */
+  entry = srh_cache_entry(dest_node);
+  if(entry->dest == dest_node
+     && entry->generation == rpl_ns_generation()) {
+    ext_len = entry->ext_len;
+    if(uip_len + ext_len > UIP_BUFSIZE) {
+      PRINTF("RPL: Packet too long: impossible to add source routing header (%u bytes)\n", ext_len);
+      return 1;
+    }
+    memmove(uip_buf + uip_l2_l3_hdr_len + ext_len,
+        uip_buf + uip_l2_l3_hdr_len, uip_len - UIP_IPH_LEN);
+    memcpy(uip_buf + uip_l2_l3_hdr_len, entry->header, ext_len);
+    UIP_RH_BUF->next = UIP_IP_BUF->proto;
+    UIP_IP_BUF->proto = UIP_PROTO_ROUTING;
+    node = entry->next_hop;
+    goto finish;
+  }
+#endif /* RPL_NS_SRH_CACHE_SIZE */
+
   if(!rpl_ns_is_node_reachable(dag, &UIP_IP_BUF->destipaddr)) {
     PRINTF("RPL: SRH no path found to destination\n");
     return 0;
@@ -445,6 +488,17 @@ insert_srh_header(void)
     node = node->parent;
   }
 
+#if RPL_NS_SRH_CACHE_SIZE
+  if(ext_len <= RPL_NS_SRH_CACHE_HEADER_LEN) {
+    entry->dest = dest_node;
+    entry->next_hop = node;
+    entry->generation = rpl_ns_generation();
+    entry->ext_len = ext_len;
+    memcpy(entry->header, UIP_RH_BUF, ext_len);
+  }
+
+finish:
+#endif /* RPL_NS_SRH_CACHE_SIZE */
   /* The next hop (i.e. node whose parent is the root) is placed as the current IPv6 destination */
   rpl_ns_get_node_global_addr(&node_addr, node);
   uip_ipaddr_copy(&UIP_IP_BUF->destipaddr, &node_addr);
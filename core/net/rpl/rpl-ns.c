@@ -59,10 +59,24 @@
 /* Total number of nodes */
 static int num_nodes;
 
+/* Incremented whenever a parent changes or a node goes away */
+static uint16_t generation;
+
 /* Every known node in the network */
 LIST(nodelist);
 MEMB(nodememb, rpl_ns_node_t, RPL_NS_LINK_NUM);
 
+#if RPL_NS_WITH_HASH_INDEX
+/* Hash index over the link identifiers, using linear probing. Each slot
+ * holds the node index plus one, zero marks an empty slot */
+#if RPL_NS_LINK_NUM < 255
+typedef uint8_t hash_slot_t;
+#else /* RPL_NS_LINK_NUM < 255 */
+typedef uint16_t hash_slot_t;
+#endif /* RPL_NS_LINK_NUM < 255 */
+static hash_slot_t hash_index[RPL_NS_HASH_INDEX_SIZE];
+#endif /* RPL_NS_WITH_HASH_INDEX */
+
 /*---------------------------------------------------------------------------*/
 int
 rpl_ns_num_nodes(void)
@@ -80,17 +94,113 @@ node_matches_address(const rpl_dag_t *dag, const rpl_ns_node_t *node, const uip_
       && !memcmp(addr, &node->dag->dag_id, 8)
       && !memcmp(((const unsigned char *)addr) + 8, node->link_identifier, 8);
 }
+#if RPL_NS_WITH_HASH_INDEX
+/*---------------------------------------------------------------------------*/
+static rpl_ns_node_t *
+node_from_index(int index)
+{
+  return &((rpl_ns_node_t *)nodememb.mem)[index];
+}
+/*---------------------------------------------------------------------------*/
+static int
+index_from_node(const rpl_ns_node_t *node)
+{
+  return node - (rpl_ns_node_t *)nodememb.mem;
+}
+/*---------------------------------------------------------------------------*/
+/* Get the preferred hash index slot of a link identifier. FNV-1a, as
+ * link identifiers often differ in their last bytes only and a plain
+ * multiplicative hash would put consecutive ones into clusters */
+static int
+hash_home(const unsigned char *link_identifier)
+{
+  uint32_t hash;
+  int i;
+
+  hash = 2166136261UL;
+  for(i = 0; i < 8; i++) {
+    hash ^= link_identifier[i];
+    hash *= 16777619UL;
+  }
+  return hash % RPL_NS_HASH_INDEX_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+static void
+hash_add(const rpl_ns_node_t *node)
+{
+  int slot;
+
+  slot = hash_home(node->link_identifier);
+  while(hash_index[slot] != 0) {
+    slot = (slot + 1) % RPL_NS_HASH_INDEX_SIZE;
+  }
+  hash_index[slot] = index_from_node(node) + 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Remove a node from the hash index. Later entries of the same probe
+ * sequence are shifted back, so that no tombstones are needed */
+static void
+hash_remove(const rpl_ns_node_t *node)
+{
+  int hole;
+  int slot;
+  int home;
+
+  hole = hash_home(node->link_identifier);
+  while(hash_index[hole] != index_from_node(node) + 1) {
+    if(hash_index[hole] == 0) {
+      return;
+    }
+    hole = (hole + 1) % RPL_NS_HASH_INDEX_SIZE;
+  }
+
+  slot = hole;
+  while(1) {
+    slot = (slot + 1) % RPL_NS_HASH_INDEX_SIZE;
+    if(hash_index[slot] == 0) {
+      break;
+    }
+    home = hash_home(node_from_index(hash_index[slot] - 1)->link_identifier);
+    /* Leave the entry where it is if its home lies cyclically in
+     * (hole, slot] */
+    if(hole <= slot
+       ? (hole < home && home <= slot)
+       : (hole < home || home <= slot)) {
+      continue;
+    }
+    hash_index[hole] = hash_index[slot];
+    hole = slot;
+  }
+  hash_index[hole] = 0;
+}
+#endif /* RPL_NS_WITH_HASH_INDEX */
 /*---------------------------------------------------------------------------*/
 rpl_ns_node_t *
 rpl_ns_get_node(const rpl_dag_t *dag, const uip_ipaddr_t *addr)
 {
   rpl_ns_node_t *l;
+#if RPL_NS_WITH_HASH_INDEX
+  int slot;
+
+  if(addr == NULL) {
+    return NULL;
+  }
+  slot = hash_home(((const unsigned char *)addr) + 8);
+  while(hash_index[slot] != 0) {
+    l = node_from_index(hash_index[slot] - 1);
+    if(node_matches_address(dag, l, addr)) {
+      return l;
+    }
+    slot = (slot + 1) % RPL_NS_HASH_INDEX_SIZE;
+  }
+#else /* RPL_NS_WITH_HASH_INDEX */
   for(l = list_head(nodelist); l != NULL; l = list_item_next(l)) {
     /* Compare prefix and node identifier */
     if(node_matches_address(dag, l, addr)) {
       return l;
     }
   }
+#endif /* RPL_NS_WITH_HASH_INDEX */
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
@@ -114,6 +224,7 @@ rpl_ns_expire_parent(rpl_dag_t *dag, const uip_ipaddr_t *child, const uip_ipaddr
   /* Check if parent matches */
   if(l != NULL && node_matches_address(dag, l->parent, parent)) {
     l->lifetime = RPL_NOPATH_REMOVAL_DELAY;
+    generation++;
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -123,6 +234,7 @@ rpl_ns_update_node(rpl_dag_t *dag, const uip_ipaddr_t *child, const uip_ipaddr_t
   rpl_ns_node_t *child_node = rpl_ns_get_node(dag, child);
   rpl_ns_node_t *parent_node = rpl_ns_get_node(dag, parent);
   rpl_ns_node_t *old_parent_node;
+  rpl_ns_node_t *previous_parent_node;
 
   if(parent != NULL) {
     /* No node for the parent, add one with infinite lifetime */
@@ -142,14 +254,23 @@ rpl_ns_update_node(rpl_dag_t *dag, const uip_ipaddr_t *child, const uip_ipaddr_t
       return NULL;
     }
     child_node->parent = NULL;
+    child_node->dag = NULL;
+    memcpy(child_node->link_identifier, ((const unsigned char *)child) + 8, 8);
     list_add(nodelist, child_node);
+#if RPL_NS_WITH_HASH_INDEX
+    hash_add(child_node);
+#endif /* RPL_NS_WITH_HASH_INDEX */
     num_nodes++;
   }
 
+  if(child_node->dag != dag) {
+    generation++;
+  }
+  previous_parent_node = child_node->parent;
+
   /* Initialize node */
   child_node->dag = dag;
   child_node->lifetime = lifetime;
-  memcpy(child_node->link_identifier, ((const unsigned char *)child) + 8, 8);
 
   /* Is the node reachable before the update? */
   if(rpl_ns_is_node_reachable(dag, child)) {
@@ -167,6 +288,10 @@ rpl_ns_update_node(rpl_dag_t *dag, const uip_ipaddr_t *child, const uip_ipaddr_t
     child_node->parent = parent_node;
   }
 
+  if(child_node->parent != previous_parent_node) {
+    generation++;
+  }
+
   return child_node;
 }
 /*---------------------------------------------------------------------------*/
@@ -174,8 +299,12 @@ void
 rpl_ns_init(void)
 {
   num_nodes = 0;
+  generation++;
   memb_init(&nodememb);
   list_init(nodelist);
+#if RPL_NS_WITH_HASH_INDEX
+  memset(hash_index, 0, sizeof(hash_index));
+#endif /* RPL_NS_WITH_HASH_INDEX */
 }
 /*---------------------------------------------------------------------------*/
 rpl_ns_node_t *
@@ -203,6 +332,7 @@ void
 rpl_ns_periodic(void)
 {
   rpl_ns_node_t *l;
+  rpl_ns_node_t *next;
   /* First pass, decrement lifetime for all nodes with non-infinite lifetime */
   for(l = list_head(nodelist); l != NULL; l = list_item_next(l)) {
     /* Don't touch infinite lifetime nodes */
@@ -211,7 +341,8 @@ rpl_ns_periodic(void)
     }
   }
   /* Second pass, for all expire nodes, deallocate them iff no child points to them */
-  for(l = list_head(nodelist); l != NULL; l = list_item_next(l)) {
+  for(l = list_head(nodelist); l != NULL; l = next) {
+    next = list_item_next(l);
     if(l->lifetime == 0) {
       rpl_ns_node_t *l2;
       for(l2 = list_head(nodelist); l2 != NULL; l2 = list_item_next(l2)) {
@@ -219,12 +350,24 @@ rpl_ns_periodic(void)
           break;
         }
       }
-      /* No child found, deallocate node */
-      list_remove(nodelist, l);
-      memb_free(&nodememb, l);
-      num_nodes--;
+      if(l2 == NULL) {
+        /* No child found, deallocate node */
+        list_remove(nodelist, l);
+#if RPL_NS_WITH_HASH_INDEX
+        hash_remove(l);
+#endif /* RPL_NS_WITH_HASH_INDEX */
+        memb_free(&nodememb, l);
+        num_nodes--;
+        generation++;
+      }
     }
   }
 }
+/*---------------------------------------------------------------------------*/
+uint16_t
+rpl_ns_generation(void)
+{
+  return generation;
+}
 
 #endif /* RPL_WITH_NON_STORING */
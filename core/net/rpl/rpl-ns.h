@@ -49,6 +49,37 @@
 #define RPL_NS_LINK_NUM 32
 #endif /* RPL_NS_CONF_LINK_NUM */
 
+/* Keep an open-addressing hash index over the link identifiers of the
+ * nodes, so that looking up a node does not scan the whole node list */
+#ifdef RPL_NS_CONF_WITH_HASH_INDEX
+#define RPL_NS_WITH_HASH_INDEX RPL_NS_CONF_WITH_HASH_INDEX
+#else /* RPL_NS_CONF_WITH_HASH_INDEX */
+#define RPL_NS_WITH_HASH_INDEX 0
+#endif /* RPL_NS_CONF_WITH_HASH_INDEX */
+
+/* Number of slots of the hash index. Should be well above
+ * RPL_NS_LINK_NUM to keep probe sequences short */
+#ifdef RPL_NS_CONF_HASH_INDEX_SIZE
+#define RPL_NS_HASH_INDEX_SIZE RPL_NS_CONF_HASH_INDEX_SIZE
+#else /* RPL_NS_CONF_HASH_INDEX_SIZE */
+#define RPL_NS_HASH_INDEX_SIZE (2 * RPL_NS_LINK_NUM)
+#endif /* RPL_NS_CONF_HASH_INDEX_SIZE */
+
+/* Number of source routing headers the root keeps ready for reuse, one
+ * per destination. 0 builds the header anew for every downward packet */
+#ifdef RPL_NS_CONF_SRH_CACHE_SIZE
+#define RPL_NS_SRH_CACHE_SIZE RPL_NS_CONF_SRH_CACHE_SIZE
+#else /* RPL_NS_CONF_SRH_CACHE_SIZE */
+#define RPL_NS_SRH_CACHE_SIZE 0
+#endif /* RPL_NS_CONF_SRH_CACHE_SIZE */
+
+/* Longest source routing header, in bytes, that is cached */
+#ifdef RPL_NS_CONF_SRH_CACHE_HEADER_LEN
+#define RPL_NS_SRH_CACHE_HEADER_LEN RPL_NS_CONF_SRH_CACHE_HEADER_LEN
+#else /* RPL_NS_CONF_SRH_CACHE_HEADER_LEN */
+#define RPL_NS_SRH_CACHE_HEADER_LEN 48
+#endif /* RPL_NS_CONF_SRH_CACHE_HEADER_LEN */
+
 typedef struct rpl_ns_node {
   struct rpl_ns_node *next;
   uint32_t lifetime;
@@ -68,5 +99,7 @@ rpl_ns_node_t *rpl_ns_get_node(const rpl_dag_t *dag, const uip_ipaddr_t *addr);
 int rpl_ns_is_node_reachable(const rpl_dag_t *dag, const uip_ipaddr_t *addr);
 void rpl_ns_get_node_global_addr(uip_ipaddr_t *addr, rpl_ns_node_t *node);
 void rpl_ns_periodic(void);
+/* Changes whenever a source route to any node may have changed */
+uint16_t rpl_ns_generation(void);
 
 #endif /* RPL_NS_H */
@@ -52,18 +52,88 @@
 static struct etimer *timerlist;
 static clock_time_t next_expiration;
 
+#if ETIMER_SORTED
+/* The last timer on the sorted list. Timers that are set with the same
+   interval over and over typically go here. */
+static struct etimer *timerlist_tail;
+
+/* Check if time a comes before time b, taking wraps into account */
+#define TIME_BEFORE(a, b) \
+  ((clock_time_t)((a) - (b)) > (clock_time_t)(~(clock_time_t)0 >> 1))
+#endif /* ETIMER_SORTED */
+
 PROCESS(etimer_process, "Event timer");
+#if ETIMER_SORTED
+/*---------------------------------------------------------------------------*/
+static void
+insert_sorted(struct etimer *timer)
+{
+  clock_time_t expiration;
+  struct etimer *t;
+
+  expiration = etimer_expiration_time(timer);
+
+  if(timerlist == NULL) {
+    timer->next = NULL;
+    timerlist = timerlist_tail = timer;
+  } else if(!TIME_BEFORE(expiration, etimer_expiration_time(timerlist_tail))) {
+    timer->next = NULL;
+    timerlist_tail->next = timer;
+    timerlist_tail = timer;
+  } else if(TIME_BEFORE(expiration, etimer_expiration_time(timerlist))) {
+    timer->next = timerlist;
+    timerlist = timer;
+  } else {
+    /* The timer goes somewhere between the head and the tail. */
+    for(t = timerlist;
+        !TIME_BEFORE(expiration, etimer_expiration_time(t->next));
+        t = t->next);
+    timer->next = t->next;
+    t->next = timer;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+remove_sorted(struct etimer *timer)
+{
+  struct etimer *t;
+
+  if(timer == timerlist) {
+    timerlist = timer->next;
+    if(timerlist == NULL) {
+      timerlist_tail = NULL;
+    }
+    return 1;
+  }
+
+  for(t = timerlist; t != NULL && t->next != timer; t = t->next);
+  if(t == NULL) {
+    return 0;
+  }
+  t->next = timer->next;
+  if(timer == timerlist_tail) {
+    timerlist_tail = t;
+  }
+  return 1;
+}
+#endif /* ETIMER_SORTED */
 /*---------------------------------------------------------------------------*/
 static void
 update_time(void)
 {
+#if !ETIMER_SORTED
   clock_time_t tdist;
   clock_time_t now;
   struct etimer *t;
+#endif /* !ETIMER_SORTED */
 
   if (timerlist == NULL) {
     next_expiration = 0;
   } else {
+#if ETIMER_SORTED
+    /* The head of the list is the next timer to expire. */
+    next_expiration = etimer_expiration_time(timerlist);
+#else /* ETIMER_SORTED */
     now = clock_time();
     t = timerlist;
     /* Must calculate distance to next time into account due to wraps */
@@ -74,6 +144,7 @@ update_time(void)
       }
     }
     next_expiration = now + tdist;
+#endif /* ETIMER_SORTED */
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -84,6 +155,9 @@ PROCESS_THREAD(etimer_process, ev, data)
   PROCESS_BEGIN();
 
   timerlist = NULL;
+#if ETIMER_SORTED
+  timerlist_tail = NULL;
+#endif /* ETIMER_SORTED */
   
   while(1) {
     PROCESS_YIELD();
@@ -91,6 +165,23 @@ PROCESS_THREAD(etimer_process, ev, data)
     if(ev == PROCESS_EVENT_EXITED) {
       struct process *p = data;
 
+#if ETIMER_SORTED
+      u = NULL;
+      for(t = timerlist; t != NULL; t = t->next) {
+        if(t->p == p) {
+          if(u != NULL) {
+            u->next = t->next;
+          } else {
+            timerlist = t->next;
+          }
+        } else {
+          u = t;
+        }
+      }
+      timerlist_tail = u;
+      update_time();
+#else /* ETIMER_SORTED */
+
       while(timerlist != NULL && timerlist->p == p) {
 	timerlist = timerlist->next;
       }
@@ -104,11 +195,33 @@ PROCESS_THREAD(etimer_process, ev, data)
 	    t = t->next;
 	}
       }
+#endif /* ETIMER_SORTED */
       continue;
     } else if(ev != PROCESS_EVENT_POLL) {
       continue;
     }
 
+#if ETIMER_SORTED
+    /* Expired timers are at the head of the list. */
+    while(timerlist != NULL && timer_expired(&timerlist->timer)) {
+      t = timerlist;
+      if(process_post(t->p, PROCESS_EVENT_TIMER, t) != PROCESS_ERR_OK) {
+        etimer_request_poll();
+        break;
+      }
+      /* Reset the process ID of the event timer, to signal that the
+         etimer has expired. This is later checked in the
+         etimer_expired() function. */
+      t->p = PROCESS_NONE;
+      timerlist = t->next;
+      if(timerlist == NULL) {
+        timerlist_tail = NULL;
+      }
+      t->next = NULL;
+    }
+    update_time();
+#else /* ETIMER_SORTED */
+
   again:
     
     u = NULL;
@@ -135,6 +248,7 @@ PROCESS_THREAD(etimer_process, ev, data)
       }
       u = t;
     }
+#endif /* ETIMER_SORTED */
     
   }
   
@@ -150,6 +264,18 @@ etimer_request_poll(void)
 static void
 add_timer(struct etimer *timer)
 {
+#if ETIMER_SORTED
+  etimer_request_poll();
+
+  /* The expiration time may have changed, so take the timer off the
+     list and insert it anew. */
+  if(timer->p != PROCESS_NONE) {
+    remove_sorted(timer);
+  }
+  timer->p = PROCESS_CURRENT();
+  insert_sorted(timer);
+  update_time();
+#else /* ETIMER_SORTED */
   struct etimer *t;
 
   etimer_request_poll();
@@ -171,6 +297,7 @@ add_timer(struct etimer *timer)
   timerlist = timer;
 
   update_time();
+#endif /* ETIMER_SORTED */
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -205,7 +332,17 @@ etimer_restart(struct etimer *et)
 void
 etimer_adjust(struct etimer *et, int timediff)
 {
+#if ETIMER_SORTED
+  /* Move the timer to its new position on the sorted list. */
+  int on_list = et->p != PROCESS_NONE && remove_sorted(et);
+#endif /* ETIMER_SORTED */
+
   et->timer.start += timediff;
+#if ETIMER_SORTED
+  if(on_list) {
+    insert_sorted(et);
+  }
+#endif /* ETIMER_SORTED */
   update_time();
 }
 /*---------------------------------------------------------------------------*/
@@ -242,6 +379,11 @@ etimer_next_expiration_time(void)
 void
 etimer_stop(struct etimer *et)
 {
+#if ETIMER_SORTED
+  if(remove_sorted(et)) {
+    update_time();
+  }
+#else /* ETIMER_SORTED */
   struct etimer *t;
 
   /* First check if et is the first event timer on the list. */
@@ -262,6 +404,7 @@ etimer_stop(struct etimer *et)
       update_time();
     }
   }
+#endif /* ETIMER_SORTED */
 
   /* Remove the next pointer from the item to be removed. */
   et->next = NULL;
@@ -65,6 +65,18 @@
 #include "sys/timer.h"
 #include "sys/process.h"
 
+/**
+ * If enabled, the list of active event timers is kept sorted by
+ * expiration time. Finding the next timer to expire and handling
+ * expired timers then only looks at the head of the list, at the cost
+ * of a sorted insertion when a timer is set.
+ */
+#ifdef ETIMER_CONF_SORTED
+#define ETIMER_SORTED ETIMER_CONF_SORTED
+#else /* ETIMER_CONF_SORTED */
+#define ETIMER_SORTED 0
+#endif /* ETIMER_CONF_SORTED */
+
 /**
  * A timer.
  *
@@ -47,6 +47,9 @@
 
 #include "sys/process.h"
 #include "sys/arg.h"
+#if PROCESS_STATS_PER_PROCESS
+#include "sys/rtimer.h"
+#endif /* PROCESS_STATS_PER_PROCESS */
 
 /*
  * Pointer to the currently running process structure.
@@ -65,15 +68,52 @@ struct event_data {
   struct process *p;
 };
 
-static process_num_events_t nevents, fevent;
-static struct event_data events[PROCESS_CONF_NUMEVENTS];
+/*
+ * One event queue per priority.
+ */
+struct event_queue {
+  process_num_events_t nevents, fevent;
+  struct event_data events[PROCESS_CONF_NUMEVENTS];
+};
+
+static struct event_queue queues[PROCESS_NUM_PRIORITIES];
+
+/* The total number of queued events, which can exceed one queue's range */
+static unsigned int nevents;
 
 #if PROCESS_CONF_STATS
-process_num_events_t process_maxevents;
+unsigned int process_maxevents;
+unsigned long process_droppedevents;
 #endif
 
+#if PROCESS_SUBSCRIPTIONS
+struct subscription {
+  struct process *p;
+  process_event_t ev;
+};
+
+/* Subscriptions with a NULL process are unused */
+static struct subscription subscriptions[PROCESS_NUM_SUBSCRIPTIONS];
+#endif /* PROCESS_SUBSCRIPTIONS */
+
 static volatile unsigned char poll_requested;
 
+#if PROCESS_POLL_QUEUE
+/*
+ * Queue of the processes that have requested to be polled, linked
+ * through their next_poll field.
+ */
+static struct process *poll_queue_head, *poll_queue_tail;
+
+#ifdef PROCESS_CONF_POLL_QUEUE_LOCK
+#define POLL_QUEUE_LOCK()   PROCESS_CONF_POLL_QUEUE_LOCK()
+#define POLL_QUEUE_UNLOCK() PROCESS_CONF_POLL_QUEUE_UNLOCK()
+#else /* PROCESS_CONF_POLL_QUEUE_LOCK */
+#define POLL_QUEUE_LOCK()
+#define POLL_QUEUE_UNLOCK()
+#endif /* PROCESS_CONF_POLL_QUEUE_LOCK */
+#endif /* PROCESS_POLL_QUEUE */
+
 #define PROCESS_STATE_NONE        0
 #define PROCESS_STATE_RUNNING     1
 #define PROCESS_STATE_CALLED      2
@@ -139,6 +179,18 @@ exit_process(struct process *p, struct process *fromprocess)
     /* Process was running */
     p->state = PROCESS_STATE_NONE;
 
+#if PROCESS_SUBSCRIPTIONS
+    {
+      int i;
+      for(i = 0; p->subscriptions > 0 && i < PROCESS_NUM_SUBSCRIPTIONS; i++) {
+        if(subscriptions[i].p == p) {
+          subscriptions[i].p = NULL;
+          p->subscriptions--;
+        }
+      }
+    }
+#endif /* PROCESS_SUBSCRIPTIONS */
+
     /*
      * Post a synchronous event to all processes to inform them that
      * this process is about to exit. This will allow services to
@@ -175,6 +227,9 @@ static void
 call_process(struct process *p, process_event_t ev, process_data_t data)
 {
   int ret;
+#if PROCESS_STATS_PER_PROCESS
+  rtimer_clock_t start;
+#endif /* PROCESS_STATS_PER_PROCESS */
 
 #if DEBUG
   if(p->state == PROCESS_STATE_CALLED) {
@@ -187,7 +242,19 @@ call_process(struct process *p, process_event_t ev, process_data_t data)
     PRINTF("process: calling process '%s' with event %d\n", PROCESS_NAME_STRING(p), ev);
     process_current = p;
     p->state = PROCESS_STATE_CALLED;
+#if PROCESS_STATS_PER_PROCESS
+    if(ev == PROCESS_EVENT_POLL) {
+      p->polls++;
+    } else {
+      p->events++;
+    }
+    start = RTIMER_NOW();
+    ret = p->thread(&p->pt, ev, data);
+    /* Includes the time spent in processes called synchronously */
+    p->runtime += (rtimer_clock_t)(RTIMER_NOW() - start);
+#else /* PROCESS_STATS_PER_PROCESS */
     ret = p->thread(&p->pt, ev, data);
+#endif /* PROCESS_STATS_PER_PROCESS */
     if(ret == PT_EXITED ||
        ret == PT_ENDED ||
        ev == PROCESS_EVENT_EXIT) {
@@ -207,14 +274,28 @@ process_exit(struct process *p)
 void
 process_init(void)
 {
+  int i;
+
   lastevent = PROCESS_EVENT_MAX;
 
-  nevents = fevent = 0;
+  nevents = 0;
+  for(i = 0; i < PROCESS_NUM_PRIORITIES; i++) {
+    queues[i].nevents = queues[i].fevent = 0;
+  }
 #if PROCESS_CONF_STATS
   process_maxevents = 0;
+  process_droppedevents = 0;
 #endif /* PROCESS_CONF_STATS */
+#if PROCESS_SUBSCRIPTIONS
+  for(i = 0; i < PROCESS_NUM_SUBSCRIPTIONS; i++) {
+    subscriptions[i].p = NULL;
+  }
+#endif /* PROCESS_SUBSCRIPTIONS */
 
   process_current = process_list = NULL;
+#if PROCESS_POLL_QUEUE
+  poll_queue_head = poll_queue_tail = NULL;
+#endif /* PROCESS_POLL_QUEUE */
 }
 /*---------------------------------------------------------------------------*/
 /*
@@ -225,6 +306,28 @@ static void
 do_poll(void)
 {
   struct process *p;
+#if PROCESS_POLL_QUEUE
+  struct process *next;
+
+  poll_requested = 0;
+  /* Take the queued processes. Processes that request a poll while
+     the queue is being served are queued anew and served next time. */
+  POLL_QUEUE_LOCK();
+  p = poll_queue_head;
+  poll_queue_head = poll_queue_tail = NULL;
+  POLL_QUEUE_UNLOCK();
+
+  /* Call the processes that needs to be polled. */
+  for(; p != NULL; p = next) {
+    next = p->next_poll;
+    p->needspoll = 0;
+    /* The process may have exited after requesting the poll. */
+    if(process_is_running(p)) {
+      p->state = PROCESS_STATE_RUNNING;
+      call_process(p, PROCESS_EVENT_POLL, NULL);
+    }
+  }
+#else /* PROCESS_POLL_QUEUE */
 
   poll_requested = 0;
   /* Call the processes that needs to be polled. */
@@ -235,7 +338,29 @@ do_poll(void)
       call_process(p, PROCESS_EVENT_POLL, NULL);
     }
   }
+#endif /* PROCESS_POLL_QUEUE */
 }
+#if PROCESS_SUBSCRIPTIONS
+/*---------------------------------------------------------------------------*/
+/*
+ * Check if a broadcast event should be delivered to a process.
+ */
+static int
+is_subscribed(struct process *p, process_event_t ev)
+{
+  int i;
+
+  if(p->subscriptions == 0) {
+    return 1;
+  }
+  for(i = 0; i < PROCESS_NUM_SUBSCRIPTIONS; i++) {
+    if(subscriptions[i].p == p && subscriptions[i].ev == ev) {
+      return 1;
+    }
+  }
+  return 0;
+}
+#endif /* PROCESS_SUBSCRIPTIONS */
 /*---------------------------------------------------------------------------*/
 /*
  * Process the next event in the event queue and deliver it to
@@ -249,6 +374,7 @@ do_event(void)
   process_data_t data;
   struct process *receiver;
   struct process *p;
+  struct event_queue *q;
   
   /*
    * If there are any events in the queue, take the first one and walk
@@ -259,16 +385,23 @@ do_event(void)
    */
 
   if(nevents > 0) {
+
+    /* Take the event from the highest-priority non-empty queue. */
+    q = &queues[PROCESS_NUM_PRIORITIES - 1];
+    while(q->nevents == 0) {
+      q--;
+    }
     
     /* There are events that we should deliver. */
-    ev = events[fevent].ev;
+    ev = q->events[q->fevent].ev;
     
-    data = events[fevent].data;
-    receiver = events[fevent].p;
+    data = q->events[q->fevent].data;
+    receiver = q->events[q->fevent].p;
 
     /* Since we have seen the new event, we move pointer upwards
        and decrease the number of events. */
-    fevent = (fevent + 1) % PROCESS_CONF_NUMEVENTS;
+    q->fevent = (q->fevent + 1) % PROCESS_CONF_NUMEVENTS;
+    --q->nevents;
     --nevents;
 
     /* If this is a broadcast event, we deliver it to all events, in
@@ -281,6 +414,11 @@ do_event(void)
 	if(poll_requested) {
 	  do_poll();
 	}
+#if PROCESS_SUBSCRIPTIONS
+	if(!is_subscribed(p, ev)) {
+	  continue;
+	}
+#endif /* PROCESS_SUBSCRIPTIONS */
 	call_process(p, ev, data);
       }
     } else {
@@ -322,17 +460,27 @@ int
 process_post(struct process *p, process_event_t ev, process_data_t data)
 {
   process_num_events_t snum;
+  struct event_queue *q;
 
   if(PROCESS_CURRENT() == NULL) {
-    PRINTF("process_post: NULL process posts event %d to process '%s', nevents %d\n",
+    PRINTF("process_post: NULL process posts event %d to process '%s', nevents %u\n",
 	   ev,PROCESS_NAME_STRING(p), nevents);
   } else {
-    PRINTF("process_post: Process '%s' posts event %d to process '%s', nevents %d\n",
+    PRINTF("process_post: Process '%s' posts event %d to process '%s', nevents %u\n",
 	   PROCESS_NAME_STRING(PROCESS_CURRENT()), ev,
 	   p == PROCESS_BROADCAST? "<broadcast>": PROCESS_NAME_STRING(p), nevents);
   }
-  
-  if(nevents == PROCESS_CONF_NUMEVENTS) {
+
+#if PROCESS_NUM_PRIORITIES > 1
+  q = &queues[p == PROCESS_BROADCAST ? PROCESS_PRIORITY_LOWEST : p->priority];
+#else /* PROCESS_NUM_PRIORITIES > 1 */
+  q = &queues[0];
+#endif /* PROCESS_NUM_PRIORITIES > 1 */
+
+  if(q->nevents == PROCESS_CONF_NUMEVENTS) {
+#if PROCESS_CONF_STATS
+    process_droppedevents++;
+#endif /* PROCESS_CONF_STATS */
 #if DEBUG
     if(p == PROCESS_BROADCAST) {
       printf("soft panic: event queue is full when broadcast event %d was posted from %s\n", ev, PROCESS_NAME_STRING(process_current));
@@ -343,10 +491,11 @@ process_post(struct process *p, process_event_t ev, process_data_t data)
     return PROCESS_ERR_FULL;
   }
   
-  snum = (process_num_events_t)(fevent + nevents) % PROCESS_CONF_NUMEVENTS;
-  events[snum].ev = ev;
-  events[snum].data = data;
-  events[snum].p = p;
+  snum = (process_num_events_t)(q->fevent + q->nevents) % PROCESS_CONF_NUMEVENTS;
+  q->events[snum].ev = ev;
+  q->events[snum].data = data;
+  q->events[snum].p = p;
+  ++q->nevents;
   ++nevents;
 
 #if PROCESS_CONF_STATS
@@ -373,11 +522,75 @@ process_poll(struct process *p)
   if(p != NULL) {
     if(p->state == PROCESS_STATE_RUNNING ||
        p->state == PROCESS_STATE_CALLED) {
+#if PROCESS_POLL_QUEUE
+      POLL_QUEUE_LOCK();
+      /* A process with a pending poll is already on the queue. */
+      if(!p->needspoll) {
+        p->needspoll = 1;
+        p->next_poll = NULL;
+        if(poll_queue_tail == NULL) {
+          poll_queue_head = p;
+        } else {
+          poll_queue_tail->next_poll = p;
+        }
+        poll_queue_tail = p;
+      }
+      POLL_QUEUE_UNLOCK();
+#else /* PROCESS_POLL_QUEUE */
       p->needspoll = 1;
+#endif /* PROCESS_POLL_QUEUE */
       poll_requested = 1;
     }
   }
 }
+#if PROCESS_NUM_PRIORITIES > 1
+/*---------------------------------------------------------------------------*/
+void
+process_set_priority(struct process *p, unsigned char priority)
+{
+  p->priority = priority < PROCESS_NUM_PRIORITIES ?
+    priority : PROCESS_PRIORITY_HIGHEST;
+}
+#endif /* PROCESS_NUM_PRIORITIES > 1 */
+#if PROCESS_SUBSCRIPTIONS
+/*---------------------------------------------------------------------------*/
+int
+process_subscribe(struct process *p, process_event_t ev)
+{
+  int i;
+  int free_slot = -1;
+
+  for(i = 0; i < PROCESS_NUM_SUBSCRIPTIONS; i++) {
+    if(subscriptions[i].p == p && subscriptions[i].ev == ev) {
+      return PROCESS_ERR_OK;
+    }
+    if(subscriptions[i].p == NULL && free_slot == -1) {
+      free_slot = i;
+    }
+  }
+  if(free_slot == -1) {
+    return PROCESS_ERR_FULL;
+  }
+  subscriptions[free_slot].p = p;
+  subscriptions[free_slot].ev = ev;
+  p->subscriptions++;
+  return PROCESS_ERR_OK;
+}
+/*---------------------------------------------------------------------------*/
+void
+process_unsubscribe(struct process *p, process_event_t ev)
+{
+  int i;
+
+  for(i = 0; i < PROCESS_NUM_SUBSCRIPTIONS; i++) {
+    if(subscriptions[i].p == p && subscriptions[i].ev == ev) {
+      subscriptions[i].p = NULL;
+      p->subscriptions--;
+      return;
+    }
+  }
+}
+#endif /* PROCESS_SUBSCRIPTIONS */
 /*---------------------------------------------------------------------------*/
 int
 process_is_running(struct process *p)
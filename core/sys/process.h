@@ -88,6 +88,68 @@ typedef unsigned char process_num_events_t;
 #define PROCESS_CONF_NUMEVENTS 32
 #endif /* PROCESS_CONF_NUMEVENTS */
 
+/*
+ * If enabled, process_poll() puts the process on a queue of pending
+ * polls, so that the scheduler only visits the processes that asked to
+ * be polled instead of scanning the whole process list. Platforms that
+ * call process_poll() from interrupt handlers must define
+ * PROCESS_CONF_POLL_QUEUE_LOCK() and PROCESS_CONF_POLL_QUEUE_UNLOCK()
+ * to disable and restore interrupts.
+ */
+#ifdef PROCESS_CONF_POLL_QUEUE
+#define PROCESS_POLL_QUEUE PROCESS_CONF_POLL_QUEUE
+#else /* PROCESS_CONF_POLL_QUEUE */
+#define PROCESS_POLL_QUEUE 0
+#endif /* PROCESS_CONF_POLL_QUEUE */
+
+/*
+ * Number of event priorities. Each priority has its own event queue of
+ * PROCESS_CONF_NUMEVENTS entries, and events are taken from the
+ * highest-priority non-empty queue first. An event gets the priority of
+ * the receiving process, see process_set_priority(). Broadcast events
+ * get the lowest priority.
+ *
+ * Every priority adds a full event queue, so the RAM used for queued
+ * events is PROCESS_NUM_PRIORITIES times that of a single queue.
+ */
+#ifdef PROCESS_CONF_NUM_PRIORITIES
+#define PROCESS_NUM_PRIORITIES PROCESS_CONF_NUM_PRIORITIES
+#else /* PROCESS_CONF_NUM_PRIORITIES */
+#define PROCESS_NUM_PRIORITIES 1
+#endif /* PROCESS_CONF_NUM_PRIORITIES */
+
+#define PROCESS_PRIORITY_LOWEST  0
+#define PROCESS_PRIORITY_HIGHEST (PROCESS_NUM_PRIORITIES - 1)
+
+/*
+ * If enabled, processes can subscribe to broadcast events with
+ * process_subscribe(). A process that has subscribed to any event only
+ * receives the broadcast events it has subscribed to, other processes
+ * keep receiving all broadcast events.
+ */
+#ifdef PROCESS_CONF_SUBSCRIPTIONS
+#define PROCESS_SUBSCRIPTIONS PROCESS_CONF_SUBSCRIPTIONS
+#else /* PROCESS_CONF_SUBSCRIPTIONS */
+#define PROCESS_SUBSCRIPTIONS 0
+#endif /* PROCESS_CONF_SUBSCRIPTIONS */
+
+/* Maximum number of broadcast subscriptions in the system */
+#ifdef PROCESS_CONF_NUM_SUBSCRIPTIONS
+#define PROCESS_NUM_SUBSCRIPTIONS PROCESS_CONF_NUM_SUBSCRIPTIONS
+#else /* PROCESS_CONF_NUM_SUBSCRIPTIONS */
+#define PROCESS_NUM_SUBSCRIPTIONS 8
+#endif /* PROCESS_CONF_NUM_SUBSCRIPTIONS */
+
+/*
+ * If enabled, each process counts the events and polls delivered to it
+ * and the time it has spent running, in rtimer ticks.
+ */
+#ifdef PROCESS_CONF_STATS_PER_PROCESS
+#define PROCESS_STATS_PER_PROCESS PROCESS_CONF_STATS_PER_PROCESS
+#else /* PROCESS_CONF_STATS_PER_PROCESS */
+#define PROCESS_STATS_PER_PROCESS 0
+#endif /* PROCESS_CONF_STATS_PER_PROCESS */
+
 #define PROCESS_EVENT_NONE            0x80
 #define PROCESS_EVENT_INIT            0x81
 #define PROCESS_EVENT_POLL            0x82
@@ -323,6 +385,18 @@ struct process {
   PT_THREAD((* thread)(struct pt *, process_event_t, process_data_t));
   struct pt pt;
   unsigned char state, needspoll;
+#if PROCESS_POLL_QUEUE
+  struct process *next_poll;
+#endif /* PROCESS_POLL_QUEUE */
+#if PROCESS_STATS_PER_PROCESS
+  unsigned long events, polls, runtime;
+#endif /* PROCESS_STATS_PER_PROCESS */
+#if PROCESS_NUM_PRIORITIES > 1
+  unsigned char priority;
+#endif /* PROCESS_NUM_PRIORITIES > 1 */
+#if PROCESS_SUBSCRIPTIONS
+  unsigned char subscriptions;
+#endif /* PROCESS_SUBSCRIPTIONS */
 };
 
 /**
@@ -452,6 +526,42 @@ process_current = p
  */
 CCIF process_event_t process_alloc_event(void);
 
+#if PROCESS_NUM_PRIORITIES > 1
+/**
+ * \brief      Set the priority of the events posted to a process.
+ * \param p    The process.
+ * \param priority The priority, between PROCESS_PRIORITY_LOWEST and
+ *             PROCESS_PRIORITY_HIGHEST.
+ *
+ *             Events posted to a process with a higher priority are
+ *             delivered before any event of a lower priority.
+ */
+void process_set_priority(struct process *p, unsigned char priority);
+#endif /* PROCESS_NUM_PRIORITIES > 1 */
+
+#if PROCESS_SUBSCRIPTIONS
+/**
+ * \brief      Subscribe a process to a broadcast event.
+ * \param p    The process.
+ * \param ev   The event.
+ * \retval PROCESS_ERR_OK The subscription was added.
+ * \retval PROCESS_ERR_FULL There was no room for the subscription.
+ *
+ *             Once a process has subscribed to an event, it only
+ *             receives the broadcast events it has subscribed to.
+ *             Events posted to the process itself are not affected.
+ *             The subscriptions of a process are removed when it exits.
+ */
+int process_subscribe(struct process *p, process_event_t ev);
+
+/**
+ * \brief      Remove the subscription of a process to a broadcast event.
+ * \param p    The process.
+ * \param ev   The event.
+ */
+void process_unsubscribe(struct process *p, process_event_t ev);
+#endif /* PROCESS_SUBSCRIPTIONS */
+
 /** @} */
 
 /**
@@ -523,6 +633,13 @@ int process_nevents(void);
 
 CCIF extern struct process *process_list;
 
+#if PROCESS_CONF_STATS
+/* The highest number of events that have been queued at a time */
+extern unsigned int process_maxevents;
+/* The number of events that were not posted because the queue was full */
+extern unsigned long process_droppedevents;
+#endif /* PROCESS_CONF_STATS */
+
 #define PROCESS_LIST() process_list
 
 #endif /* PROCESS_H_ */
@@ -44,6 +44,7 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 /*---------------------------------------------------------------------------*/
 #define MODULE_NAME     "cc2538-aes-128"
 
@@ -54,6 +55,12 @@
 #define PRINTF(...)
 #endif
 /*---------------------------------------------------------------------------*/
+/* Copies of the keys in the key areas, to tell which key an area holds */
+static uint8_t slot_keys[CC2538_AES_128_KEY_SLOTS][AES_128_KEY_LENGTH];
+static uint16_t slot_last_used[CC2538_AES_128_KEY_SLOTS];
+static uint16_t use_count;
+static uint8_t current_slot;
+/*---------------------------------------------------------------------------*/
 static uint8_t
 enable_crypto(void)
 {
@@ -76,19 +83,51 @@ static void
 set_key(const uint8_t *key)
 {
   uint8_t crypto_enabled, ret;
+  uint8_t slot, i;
 
   crypto_enabled = enable_crypto();
 
-  ret = aes_load_keys(key, AES_KEY_STORE_SIZE_KEY_SIZE_128, 1,
-                      CC2538_AES_128_KEY_AREA);
-  if(ret != CRYPTO_SUCCESS) {
-    PRINTF("%s: aes_load_keys() error %u\n", MODULE_NAME, ret);
-    sys_ctrl_reset();
+  use_count++;
+  /* The key store loses its content in PM2 and PM3, in which case the
+     written flag of the area is cleared */
+  for(slot = 0; slot < CC2538_AES_128_KEY_SLOTS; slot++) {
+    if((REG(AES_KEY_STORE_WRITTEN_AREA)
+        & (1 << (CC2538_AES_128_KEY_AREA + slot)))
+       && !memcmp(slot_keys[slot], key, AES_128_KEY_LENGTH)) {
+      break;
+    }
   }
 
+  if(slot == CC2538_AES_128_KEY_SLOTS) {
+    /* take the least recently used area */
+    slot = 0;
+    for(i = 1; i < CC2538_AES_128_KEY_SLOTS; i++) {
+      if((uint16_t)(use_count - slot_last_used[i])
+         > (uint16_t)(use_count - slot_last_used[slot])) {
+        slot = i;
+      }
+    }
+
+    ret = aes_load_keys(key, AES_KEY_STORE_SIZE_KEY_SIZE_128, 1,
+                        CC2538_AES_128_KEY_AREA + slot);
+    if(ret != CRYPTO_SUCCESS) {
+      PRINTF("%s: aes_load_keys() error %u\n", MODULE_NAME, ret);
+      sys_ctrl_reset();
+    }
+    memcpy(slot_keys[slot], key, AES_128_KEY_LENGTH);
+  }
+  slot_last_used[slot] = use_count;
+  current_slot = slot;
+
   restore_crypto(crypto_enabled);
 }
 /*---------------------------------------------------------------------------*/
+uint8_t
+cc2538_aes_128_get_key_area(void)
+{
+  return CC2538_AES_128_KEY_AREA + current_slot;
+}
+/*---------------------------------------------------------------------------*/
 static void
 encrypt(uint8_t *plaintext_and_result)
 {
@@ -97,7 +136,7 @@ encrypt(uint8_t *plaintext_and_result)
 
   crypto_enabled = enable_crypto();
 
-  ret = ecb_crypt_start(true, CC2538_AES_128_KEY_AREA, plaintext_and_result,
+  ret = ecb_crypt_start(true, cc2538_aes_128_get_key_area(), plaintext_and_result,
                         plaintext_and_result, AES_128_BLOCK_SIZE, NULL);
   if(ret != CRYPTO_SUCCESS) {
     PRINTF("%s: ecb_crypt_start() error %u\n", MODULE_NAME, ret);
@@ -121,7 +160,7 @@ decrypt(uint8_t *plaintext_and_result)
 
   crypto_enabled = enable_crypto();
 
-  ret = ecb_crypt_start(false, CC2538_AES_128_KEY_AREA, plaintext_and_result,
+  ret = ecb_crypt_start(false, cc2538_aes_128_get_key_area(), plaintext_and_result,
                         plaintext_and_result, AES_128_BLOCK_SIZE, NULL);
   if(ret != CRYPTO_SUCCESS) {
     PRINTF("%s: ecb_crypt_start() error %u\n", MODULE_NAME, ret);
@@ -52,9 +52,25 @@
 #else
 #define CC2538_AES_128_KEY_AREA         0
 #endif
+
+/*
+ * Number of key areas, starting at CC2538_AES_128_KEY_AREA, that hold the
+ * most recently used keys. Setting a key that is still in one of them only
+ * selects that area instead of loading the key store again.
+ */
+#ifdef CC2538_AES_128_CONF_KEY_SLOTS
+#define CC2538_AES_128_KEY_SLOTS        CC2538_AES_128_CONF_KEY_SLOTS
+#else
+#define CC2538_AES_128_KEY_SLOTS        1
+#endif
 /*---------------------------------------------------------------------------*/
 extern const struct aes_128_driver cc2538_aes_128_driver;
 
+/**
+ * \brief Returns the key area that holds the key set last.
+ */
+uint8_t cc2538_aes_128_get_key_area(void);
+
 #endif /* CC2538_AES_128_H_ */
 
 /**
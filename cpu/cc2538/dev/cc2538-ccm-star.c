@@ -88,7 +88,7 @@ aead(const uint8_t *nonce, uint8_t *m, uint8_t m_len, const uint8_t *a,
   crypto_enabled = enable_crypto();
 
   if(forward) {
-    ret = ccm_auth_encrypt_start(CCM_STAR_LEN_LEN, CC2538_AES_128_KEY_AREA,
+    ret = ccm_auth_encrypt_start(CCM_STAR_LEN_LEN, cc2538_aes_128_get_key_area(),
                                  nonce, a, a_len, m, m_len, m, mic_len, NULL);
     if(ret != CRYPTO_SUCCESS) {
       PRINTF("%s: ccm_auth_encrypt_start() error %u\n", MODULE_NAME, ret);
@@ -103,7 +103,7 @@ aead(const uint8_t *nonce, uint8_t *m, uint8_t m_len, const uint8_t *a,
     }
   } else {
     cdata_len = m_len + mic_len;
-    ret = ccm_auth_decrypt_start(CCM_STAR_LEN_LEN, CC2538_AES_128_KEY_AREA,
+    ret = ccm_auth_decrypt_start(CCM_STAR_LEN_LEN, cc2538_aes_128_get_key_area(),
                                  nonce, a, a_len, m, cdata_len, m, mic_len,
                                  NULL);
     if(ret != CRYPTO_SUCCESS) {
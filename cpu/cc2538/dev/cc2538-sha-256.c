@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2026, Hasso-Plattner-Institut.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+/**
+ * \addtogroup cc2538-sha256
+ * @{
+ *
+ * \file
+ *         Implementation of the SHA-256 driver for the CC2538 SoC
+ */
+#include "contiki.h"
+#include "dev/sha256.h"
+#include "dev/cc2538-sha-256.h"
+#include "dev/sys-ctrl.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+/*---------------------------------------------------------------------------*/
+#define MODULE_NAME     "cc2538-sha-256"
+
+#define DEBUG 0
+#if DEBUG
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+/*---------------------------------------------------------------------------*/
+/* The hash engine keeps its state in sha256_state_t, which is converted
+   from and to the driver-independent context around each call. */
+static void
+load_state(sha256_state_t *state, const sha_256_context_t *ctx)
+{
+  state->length = ctx->bit_count;
+  memcpy(state->state, ctx->state, sizeof(state->state));
+  state->curlen = ctx->buf_len;
+  memcpy(state->buf, ctx->buf, ctx->buf_len);
+  state->new_digest = ctx->bit_count == 0;
+  state->final_digest = false;
+}
+/*---------------------------------------------------------------------------*/
+static void
+store_state(sha_256_context_t *ctx, const sha256_state_t *state)
+{
+  ctx->bit_count = state->length;
+  memcpy(ctx->state, state->state, sizeof(ctx->state));
+  ctx->buf_len = state->curlen;
+  memcpy(ctx->buf, state->buf, state->curlen);
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+enable_crypto(void)
+{
+  uint8_t enabled = CRYPTO_IS_ENABLED();
+  if(!enabled) {
+    crypto_enable();
+  }
+  return enabled;
+}
+/*---------------------------------------------------------------------------*/
+static void
+restore_crypto(uint8_t enabled)
+{
+  if(!enabled) {
+    crypto_disable();
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+init(sha_256_context_t *ctx)
+{
+  ctx->bit_count = 0;
+  ctx->buf_len = 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+update(sha_256_context_t *ctx, const uint8_t *data, size_t len)
+{
+  sha256_state_t state;
+  uint8_t crypto_enabled, ret;
+
+  crypto_enabled = enable_crypto();
+
+  load_state(&state, ctx);
+  ret = sha256_process(&state, data, len);
+  if(ret != CRYPTO_SUCCESS) {
+    PRINTF("%s: sha256_process() error %u\n", MODULE_NAME, ret);
+    sys_ctrl_reset();
+  }
+  store_state(ctx, &state);
+
+  restore_crypto(crypto_enabled);
+}
+/*---------------------------------------------------------------------------*/
+static void
+finalize(sha_256_context_t *ctx, uint8_t digest[SHA_256_DIGEST_LENGTH])
+{
+  sha256_state_t state;
+  uint8_t crypto_enabled, ret;
+
+  crypto_enabled = enable_crypto();
+
+  load_state(&state, ctx);
+  ret = sha256_done(&state, digest);
+  if(ret != CRYPTO_SUCCESS) {
+    PRINTF("%s: sha256_done() error %u\n", MODULE_NAME, ret);
+    sys_ctrl_reset();
+  }
+
+  restore_crypto(crypto_enabled);
+}
+/*---------------------------------------------------------------------------*/
+const struct sha_256_driver cc2538_sha_256_driver = {
+  init,
+  update,
+  finalize
+};
+/*---------------------------------------------------------------------------*/
+/** @} */
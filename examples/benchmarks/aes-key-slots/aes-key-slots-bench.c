@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2026, Hasso-Plattner-Institut.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Measures CCM* per frame when frames alternate between the
+ *         pairwise keys of several neighbors, as with adaptivesec's
+ *         coresec strategy, against the number of key slots of the
+ *         software AES (AES_128_CONF_KEY_SLOTS).
+ */
+
+#include "contiki.h"
+#include "lib/aes-128.h"
+#include "lib/ccm-star.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MEASUREMENT_DURATION (CLOCK_SECOND / 4)
+#define NUM_FRAMES 16
+#define HEADER_LEN 21
+#define PAYLOAD_LEN 40
+#define MIC_LEN 8
+
+static const int neighbor_counts[] = { 1, 2, 4, 8, 16 };
+
+#define MAX_NEIGHBORS 16
+
+static uint8_t keys[MAX_NEIGHBORS][AES_128_KEY_LENGTH];
+static uint8_t frames[NUM_FRAMES][HEADER_LEN + PAYLOAD_LEN];
+static uint8_t expected_mics[MAX_NEIGHBORS][NUM_FRAMES][MIC_LEN];
+
+PROCESS(aes_key_slots_bench_process, "AES key slots benchmark");
+AUTOSTART_PROCESSES(&aes_key_slots_bench_process);
+/*---------------------------------------------------------------------------*/
+static void
+secure(int neighbor, int frame, uint8_t *mic)
+{
+  uint8_t nonce[CCM_STAR_NONCE_LENGTH];
+  uint8_t m[PAYLOAD_LEN];
+
+  memset(nonce, 0, sizeof(nonce));
+  nonce[7] = neighbor;
+  nonce[11] = frame;
+  memcpy(m, frames[frame] + HEADER_LEN, PAYLOAD_LEN);
+  CCM_STAR.set_key(keys[neighbor]);
+  CCM_STAR.aead(nonce, m, PAYLOAD_LEN, frames[frame], HEADER_LEN,
+                mic, MIC_LEN, 1);
+}
+/*---------------------------------------------------------------------------*/
+/* Returns the number of frames per second, or 0 on a wrong MIC */
+static unsigned long
+measure(int neighbors)
+{
+  uint8_t mic[MIC_LEN];
+  unsigned long count;
+  clock_time_t start;
+  clock_time_t elapsed;
+  int frame;
+  int n;
+
+  count = 0;
+  start = clock_time();
+  do {
+    /* One frame per neighbor in turn */
+    for(frame = 0; frame < NUM_FRAMES; frame++) {
+      for(n = 0; n < neighbors; n++) {
+        secure(n, frame, mic);
+        if(memcmp(mic, expected_mics[n][frame], MIC_LEN)) {
+          return 0;
+        }
+      }
+    }
+    count += NUM_FRAMES * neighbors;
+    elapsed = clock_time() - start;
+  } while(elapsed < MEASUREMENT_DURATION);
+
+  return count * CLOCK_SECOND / elapsed;
+}
+/*---------------------------------------------------------------------------*/
+/* Returns the number of key switches per second */
+static unsigned long
+measure_set_key(int neighbors)
+{
+  unsigned long count;
+  clock_time_t start;
+  clock_time_t elapsed;
+  int n;
+
+  count = 0;
+  start = clock_time();
+  do {
+    for(n = 0; n < neighbors; n++) {
+      CCM_STAR.set_key(keys[n]);
+    }
+    count += neighbors;
+    elapsed = clock_time() - start;
+  } while(elapsed < MEASUREMENT_DURATION);
+
+  return count * CLOCK_SECOND / elapsed;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(aes_key_slots_bench_process, ev, data)
+{
+  unsigned long rate;
+  int frame;
+  int s;
+  int n;
+
+  PROCESS_BEGIN();
+
+  for(n = 0; n < MAX_NEIGHBORS; n++) {
+    for(s = 0; s < AES_128_KEY_LENGTH; s++) {
+      keys[n][s] = rand();
+    }
+  }
+  for(frame = 0; frame < NUM_FRAMES; frame++) {
+    for(s = 0; s < HEADER_LEN + PAYLOAD_LEN; s++) {
+      frames[frame][s] = rand();
+    }
+  }
+
+  /* All frames of one neighbor at a time need each key only once */
+  for(n = 0; n < MAX_NEIGHBORS; n++) {
+    for(frame = 0; frame < NUM_FRAMES; frame++) {
+      secure(n, frame, expected_mics[n][frame]);
+    }
+  }
+
+  printf("neighbors, frames/s, ns per frame, ns per set_key (%d key slots)\n",
+         AES_128_CONF_KEY_SLOTS);
+  for(s = 0; s < sizeof(neighbor_counts) / sizeof(neighbor_counts[0]); s++) {
+    rate = measure(neighbor_counts[s]);
+    if(rate == 0) {
+      printf("wrong MIC with %d neighbors\n", neighbor_counts[s]);
+      exit(1);
+    }
+    printf("%d, %lu, %lu, %lu\n", neighbor_counts[s], rate, 1000000000UL / rate,
+           1000000000UL / measure_set_key(neighbor_counts[s]));
+  }
+
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
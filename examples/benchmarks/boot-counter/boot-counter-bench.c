@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2026, Hasso-Plattner-Institut.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Measures the write latency and the flash sector erases of
+ *         100000 boot counter increments in Coffee, written with
+ *         persistent_counter_increment() and by removing and recreating
+ *         the counter file, as er-coap did before. Then checks that
+ *         persistent_counter_init() recovers the latest value.
+ */
+
+#include "contiki.h"
+#include "cfs/cfs.h"
+#include "cfs/cfs-coffee.h"
+#include "lib/persistent-counter.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define INCREMENTS 100000UL
+#define FILENAME "counter"
+#define SPARE_FILENAME "counter.bak"
+
+static unsigned long erases;
+
+PROCESS(boot_counter_bench_process, "Boot counter benchmark");
+AUTOSTART_PROCESSES(&boot_counter_bench_process);
+/*---------------------------------------------------------------------------*/
+int __real_xmem_erase(long nbytes, unsigned long offset);
+
+int
+__wrap_xmem_erase(long nbytes, unsigned long offset)
+{
+  erases++;
+  return __real_xmem_erase(nbytes, offset);
+}
+/*---------------------------------------------------------------------------*/
+static int
+rewrite(uint16_t value)
+{
+  int fd;
+
+  cfs_remove(FILENAME);
+  fd = cfs_open(FILENAME, CFS_WRITE);
+  if(fd < 0) {
+    return 0;
+  }
+  cfs_write(fd, &value, sizeof(value));
+  cfs_close(fd);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+report(const char *name, clock_time_t elapsed)
+{
+  printf("%s\t%lu\t%lu\n", name,
+         (unsigned long)(elapsed * 1000000UL / CLOCK_SECOND * 1000 / INCREMENTS),
+         erases);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(boot_counter_bench_process, ev, data)
+{
+  static struct persistent_counter counter;
+  clock_time_t start;
+  unsigned long i;
+
+  PROCESS_BEGIN();
+
+  printf("method\twrite latency (ns)\tsector erases\n");
+
+  cfs_coffee_format();
+  erases = 0;
+  start = clock_time();
+  for(i = 1; i <= INCREMENTS; i++) {
+    if(!rewrite(i)) {
+      printf("rewriting the counter failed\n");
+      exit(1);
+    }
+  }
+  report("rewrite", clock_time() - start);
+
+  cfs_coffee_format();
+  erases = 0;
+  persistent_counter_init(&counter, FILENAME, SPARE_FILENAME);
+  start = clock_time();
+  for(i = 1; i <= INCREMENTS; i++) {
+    if(!persistent_counter_increment(&counter)) {
+      printf("appending to the counter failed\n");
+      exit(1);
+    }
+  }
+  report("append", clock_time() - start);
+
+  if(!persistent_counter_init(&counter, FILENAME, SPARE_FILENAME)
+     || persistent_counter_get(&counter) != INCREMENTS) {
+    printf("recovered %lu instead of %lu\n",
+           (unsigned long)persistent_counter_get(&counter), INCREMENTS);
+    exit(1);
+  }
+
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2026, Hasso-Plattner-Institut.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Measures the throughput of uip_chksum_add() in bytes per
+ *         second and checks it, and uip_chksum_adjust(), against a
+ *         straightforward byte pair implementation. Build with
+ *         DEFINES=UIP_CONF_CHKSUM_WIDE=0 to measure the 16-bit loop.
+ */
+
+#include "contiki.h"
+#include "net/ip/uip-chksum.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BUFFER_SIZE 1280
+#define MEASUREMENT_DURATION (CLOCK_SECOND / 4)
+#define BATCH_SIZE 64
+#define NUM_CHECKS 10000
+
+/* One extra byte to sum an unaligned buffer */
+static uint8_t buffer[BUFFER_SIZE + 1];
+static uint16_t length;
+static volatile uint16_t sink;
+
+PROCESS(chksum_bench_process, "Checksum benchmark");
+AUTOSTART_PROCESSES(&chksum_bench_process);
+/*---------------------------------------------------------------------------*/
+static uint16_t
+reference_chksum(uint16_t sum, const uint8_t *data, uint16_t len)
+{
+  uint16_t t;
+
+  while(len >= 2) {
+    t = (data[0] << 8) + data[1];
+    sum += t;
+    if(sum < t) {
+      sum++;
+    }
+    data += 2;
+    len -= 2;
+  }
+  if(len == 1) {
+    t = data[0] << 8;
+    sum += t;
+    if(sum < t) {
+      sum++;
+    }
+  }
+  return sum;
+}
+/*---------------------------------------------------------------------------*/
+static void
+op_reference(void)
+{
+  sink = reference_chksum(0, buffer, length);
+}
+/*---------------------------------------------------------------------------*/
+static void
+op_chksum(void)
+{
+  sink = uip_chksum_add(0, buffer, length);
+}
+/*---------------------------------------------------------------------------*/
+static void
+op_chksum_unaligned(void)
+{
+  sink = uip_chksum_add(0, buffer + 1, length);
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+measure(void (*op)(void))
+{
+  unsigned long ops;
+  clock_time_t start;
+  clock_time_t elapsed;
+  int i;
+
+  ops = 0;
+  start = clock_time();
+  do {
+    for(i = 0; i < BATCH_SIZE; i++) {
+      op();
+    }
+    ops += BATCH_SIZE;
+    elapsed = clock_time() - start;
+  } while(elapsed < MEASUREMENT_DURATION);
+
+  return ops * length / elapsed * CLOCK_SECOND;
+}
+/*---------------------------------------------------------------------------*/
+static int
+check_sums(void)
+{
+  uint16_t offset, len, sum;
+  int i;
+
+  for(i = 0; i < NUM_CHECKS; i++) {
+    offset = rand() % 8;
+    len = rand() % (BUFFER_SIZE - 8);
+    sum = rand();
+    if(uip_chksum_add(sum, buffer + offset, len) !=
+       reference_chksum(sum, buffer + offset, len)) {
+      printf("sum mismatch: offset %u len %u\n", offset, len);
+      return 0;
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+check_adjust(void)
+{
+  uint8_t packet[64];
+  uint16_t chksum, old_sum, new_sum;
+  int i, j;
+
+  for(i = 0; i < NUM_CHECKS; i++) {
+    for(j = 0; j < sizeof(packet); j++) {
+      packet[j] = rand();
+    }
+    chksum = ~reference_chksum(0, packet, sizeof(packet));
+
+    /* Rewrite the first 16 bytes, like an address translator would */
+    old_sum = uip_chksum_add(0, packet, 16);
+    for(j = 0; j < 16; j++) {
+      packet[j] = rand();
+    }
+    new_sum = uip_chksum_add(0, packet, 16);
+
+    chksum = uip_chksum_adjust(chksum, old_sum, new_sum);
+    if(reference_chksum(chksum, packet, sizeof(packet)) != 0xffff) {
+      printf("adjust mismatch\n");
+      return 0;
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(chksum_bench_process, ev, data)
+{
+  static const uint16_t lengths[] = { 40, 127, 1280 };
+  int i;
+
+  PROCESS_BEGIN();
+
+  for(i = 0; i < sizeof(buffer); i++) {
+    buffer[i] = rand();
+  }
+
+  printf("32-bit words %s\n", UIP_CHKSUM_WIDE ? "enabled" : "disabled");
+  if(!check_sums() || !check_adjust()) {
+    exit(1);
+  }
+
+  printf("length\treference\tuip_chksum_add\tunaligned (bytes/s)\n");
+  for(i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+    length = lengths[i];
+    printf("%u", length);
+    printf("\t%lu", measure(op_reference));
+    printf("\t%lu", measure(op_chksum));
+    printf("\t%lu\n", measure(op_chksum_unaligned));
+  }
+
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
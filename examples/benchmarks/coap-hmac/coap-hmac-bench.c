@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) 2026, Hasso-Plattner-Institut.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Measures how many CoAP messages per second can be
+ *         authenticated with HMAC-SHA256 and checks the results. The
+ *         reference computes the key pads for every message, like
+ *         coap_calculate_hmac() did before it cached the hash states.
+ */
+
+#include "contiki.h"
+#include "lib/sha-256.h"
+#include "er-coap.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MEASUREMENT_DURATION (CLOCK_SECOND / 4)
+#define BATCH_SIZE 16
+#define MAX_MESSAGE_LEN 256
+/* Where the HMAC option value sits in the verified messages */
+#define HMAC_POSITION 8
+
+/* Same key as coap_psk_1 in er-coap-psk.h */
+static const uint8_t psk[] = {
+  0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+  0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F
+};
+
+static uint8_t message[MAX_MESSAGE_LEN];
+static uint16_t message_len;
+static uint8_t hmac[SHA_256_DIGEST_LENGTH];
+
+PROCESS(coap_hmac_bench_process, "CoAP HMAC benchmark");
+AUTOSTART_PROCESSES(&coap_hmac_bench_process);
+/*---------------------------------------------------------------------------*/
+static void
+reference_hmac(uint8_t *result, const uint8_t *key, uint8_t key_len,
+               const uint8_t *data, size_t data_len)
+{
+  sha_256_context_t ctx;
+  uint8_t k_ipad[SHA_256_BLOCK_SIZE];
+  uint8_t k_opad[SHA_256_BLOCK_SIZE];
+  uint8_t i;
+
+  memset(k_ipad, 0, sizeof(k_ipad));
+  memcpy(k_ipad, key, key_len);
+  memcpy(k_opad, k_ipad, sizeof(k_opad));
+  for(i = 0; i < SHA_256_BLOCK_SIZE; i++) {
+    k_ipad[i] ^= 0x36;
+    k_opad[i] ^= 0x5c;
+  }
+
+  SHA_256.init(&ctx);
+  SHA_256.update(&ctx, k_ipad, sizeof(k_ipad));
+  SHA_256.update(&ctx, data, data_len);
+  SHA_256.finalize(&ctx, result);
+
+  SHA_256.init(&ctx);
+  SHA_256.update(&ctx, k_opad, sizeof(k_opad));
+  SHA_256.update(&ctx, result, SHA_256_DIGEST_LENGTH);
+  SHA_256.finalize(&ctx, result);
+}
+/*---------------------------------------------------------------------------*/
+static void
+op_reference(void)
+{
+  reference_hmac(hmac, psk, sizeof(psk), message, message_len);
+}
+/*---------------------------------------------------------------------------*/
+static void
+op_calculate(void)
+{
+  coap_calculate_hmac(hmac, message, message_len);
+}
+/*---------------------------------------------------------------------------*/
+static void
+op_verify(void)
+{
+  if(!coap_is_valid_hmac(message, HMAC_POSITION, message_len)) {
+    printf("coap_is_valid_hmac() rejected a valid HMAC\n");
+    exit(1);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+sign_message(void)
+{
+  static uint8_t unsigned_message[MAX_MESSAGE_LEN];
+  uint16_t after_hmac;
+
+  after_hmac = HMAC_POSITION + COAP_HEADER_HMAC_LENGTH;
+  memcpy(unsigned_message, message, HMAC_POSITION);
+  memcpy(unsigned_message + HMAC_POSITION, message + after_hmac,
+         message_len - after_hmac);
+  reference_hmac(hmac, psk, sizeof(psk),
+                 unsigned_message, message_len - COAP_HEADER_HMAC_LENGTH);
+  memcpy(message + HMAC_POSITION, hmac, COAP_HEADER_HMAC_LENGTH);
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+measure(void (*op)(void))
+{
+  unsigned long ops;
+  clock_time_t start;
+  clock_time_t elapsed;
+  int i;
+
+  ops = 0;
+  start = clock_time();
+  do {
+    for(i = 0; i < BATCH_SIZE; i++) {
+      op();
+    }
+    ops += BATCH_SIZE;
+    elapsed = clock_time() - start;
+  } while(elapsed < MEASUREMENT_DURATION);
+
+  return ops * CLOCK_SECOND / elapsed;
+}
+/*---------------------------------------------------------------------------*/
+static int
+check_sha_256(void)
+{
+  /* FIPS 180-4 example "abc" and RFC 4231 test case 2 */
+  static const uint8_t abc_digest[] = {
+    0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea,
+    0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+    0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c,
+    0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad
+  };
+  static const uint8_t jefe_hmac[] = {
+    0x5b, 0xdc, 0xc1, 0x46, 0xbf, 0x60, 0x75, 0x4e,
+    0x6a, 0x04, 0x24, 0x26, 0x08, 0x95, 0x75, 0xc7,
+    0x5a, 0x00, 0x3f, 0x08, 0x9d, 0x27, 0x39, 0x83,
+    0x9d, 0xec, 0x58, 0xb9, 0x64, 0xec, 0x38, 0x43
+  };
+  static const char jefe_data[] = "what do ya want for nothing?";
+  sha_256_context_t ctx;
+  uint8_t digest[SHA_256_DIGEST_LENGTH];
+
+  SHA_256.init(&ctx);
+  SHA_256.update(&ctx, (const uint8_t *)"abc", 3);
+  SHA_256.finalize(&ctx, digest);
+  if(memcmp(digest, abc_digest, sizeof(digest))) {
+    printf("SHA-256 mismatch\n");
+    return 0;
+  }
+
+  reference_hmac(digest, (const uint8_t *)"Jefe", 4,
+                 (const uint8_t *)jefe_data, sizeof(jefe_data) - 1);
+  if(memcmp(digest, jefe_hmac, sizeof(digest))) {
+    printf("HMAC-SHA256 mismatch\n");
+    return 0;
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+check_hmac(void)
+{
+  uint8_t expected[SHA_256_DIGEST_LENGTH];
+  uint16_t len;
+
+  /* Lengths around the SHA-256 block and padding boundaries */
+  for(len = 0; len <= 130; len++) {
+    reference_hmac(expected, psk, sizeof(psk), message, len);
+    coap_calculate_hmac(hmac, message, len);
+    if(memcmp(hmac, expected, sizeof(hmac))) {
+      printf("coap_calculate_hmac() mismatch at length %u\n", len);
+      return 0;
+    }
+  }
+
+  message_len = 64;
+  sign_message();
+  if(!coap_is_valid_hmac(message, HMAC_POSITION, message_len)) {
+    printf("coap_is_valid_hmac() rejected a valid HMAC\n");
+    return 0;
+  }
+  message[message_len - 1] ^= 1;
+  if(coap_is_valid_hmac(message, HMAC_POSITION, message_len)) {
+    printf("coap_is_valid_hmac() accepted a modified message\n");
+    return 0;
+  }
+  message[message_len - 1] ^= 1;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(coap_hmac_bench_process, ev, data)
+{
+  static const uint16_t lengths[] = { 32, 64, 128, 256 };
+  int i;
+
+  PROCESS_BEGIN();
+
+  for(i = 0; i < sizeof(message); i++) {
+    message[i] = rand();
+  }
+
+  if(!check_sha_256() || !check_hmac()) {
+    exit(1);
+  }
+
+  printf("length\treference\tcoap_calculate_hmac\tcoap_is_valid_hmac"
+         " (messages/s)\n");
+  for(i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+    message_len = lengths[i];
+    printf("%u", message_len);
+    printf("\t%lu", measure(op_reference));
+    printf("\t%lu", measure(op_calculate));
+    sign_message();
+    printf("\t%lu\n", measure(op_verify));
+  }
+
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
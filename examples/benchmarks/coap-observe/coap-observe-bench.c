@@ -0,0 +1,271 @@
+/*
+ * Copyright (c) 2026, Hasso-Plattner-Institut.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Measures what one state change of a resource with 20 observers
+ *         costs: the CPU time of coap_notify_observers(), the handler
+ *         calls, and the packets sent. Four of the observers never
+ *         acknowledge their confirmable notifications. Build with
+ *         DEFINES=COAP_OBSERVE_BATCH_NOTIFICATIONS=0 to measure one
+ *         notification per observer.
+ */
+
+#include "contiki.h"
+#include "contiki-net.h"
+#include "er-coap.h"
+#include "er-coap-engine.h"
+#include "er-coap-observe.h"
+#include "er-coap-transactions.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MEASUREMENT_DURATION (CLOCK_SECOND * 2)
+#define BATCH_SIZE 10
+#define NUM_OBSERVERS 20
+#define NUM_SLOW_OBSERVERS 4
+#define STATE_CHANGES 400
+#define FIRST_PORT 6000
+#define CLIENT_ADDR "fe80::1"
+
+static uip_ipaddr_t client_addr;
+static unsigned long handler_calls;
+static unsigned long reading;
+
+/* Confirmable notifications to acknowledge once the notification is out */
+static uint16_t acks[NUM_OBSERVERS * 2];
+static uint8_t ack_count;
+
+/* Packets sent in the current measurement */
+static unsigned long packets;
+static unsigned long con_packets;
+static unsigned long bad_hmacs;
+static unsigned long received[NUM_OBSERVERS];
+static uint8_t verify;
+static uint8_t ack_slow;
+
+static void res_get_handler(void *request, void *response, uint8_t *buffer,
+                            uint16_t preferred_size, int32_t *offset);
+EVENT_RESOURCE(res_sensor, "title=\"Sensor\";obs", res_get_handler, NULL,
+               NULL, NULL, NULL);
+
+PROCESS(coap_observe_bench_process, "CoAP observe benchmark");
+AUTOSTART_PROCESSES(&coap_observe_bench_process);
+/*---------------------------------------------------------------------------*/
+static void
+res_get_handler(void *request, void *response, uint8_t *buffer,
+                uint16_t preferred_size, int32_t *offset)
+{
+  int len;
+
+  handler_calls++;
+  len = snprintf((char *)buffer, preferred_size,
+                 "{\"temp\":%lu,\"hum\":%lu}", reading % 40, reading % 100);
+  coap_set_header_content_format(response, APPLICATION_JSON);
+  coap_set_payload(response, buffer, len);
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+count_output(const uip_lladdr_t *lladdr)
+{
+  coap_scan_t scan;
+  uint8_t *data;
+  uint16_t len;
+  uint16_t observer;
+
+  if(UIP_IP_BUF->proto != UIP_PROTO_UDP) {
+    return 0;
+  }
+  data = &uip_buf[UIP_LLH_LEN + UIP_IPUDPH_LEN];
+  len = uip_ntohs(UIP_UDP_BUF->udplen) - UIP_UDPH_LEN;
+  observer = uip_ntohs(UIP_UDP_BUF->destport) - FIRST_PORT;
+  if(observer >= NUM_OBSERVERS || coap_scan_message(&scan, data, len)
+     != NO_ERROR) {
+    return 0;
+  }
+
+  packets++;
+  received[observer]++;
+  if(scan.type == COAP_TYPE_CON) {
+    con_packets++;
+    if(ack_slow || observer >= NUM_SLOW_OBSERVERS) {
+      acks[ack_count++] = scan.mid;
+    }
+  }
+  if(verify && !coap_is_valid_hmac(data, scan.hmac_position, len)) {
+    bad_hmacs++;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Handles the ACKs of the fast observers like the engine does */
+static void
+acknowledge(void)
+{
+  coap_transaction_t *t;
+
+  while(ack_count > 0) {
+    t = coap_get_transaction_by_mid(acks[--ack_count]);
+    if(t) {
+      coap_clear_transaction(t);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+state_change(void)
+{
+  reading++;
+  coap_notify_observers(&res_sensor);
+  acknowledge();
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_observers(void)
+{
+  coap_packet_t request[1];
+  coap_packet_t response[1];
+  uint8_t token[COAP_TOKEN_LEN];
+  uint16_t i;
+
+  for(i = 0; i < NUM_OBSERVERS; i++) {
+    /* Tokens of all lengths from 0 to 8 bytes */
+    memset(token, i, sizeof(token));
+    coap_init_message(request, COAP_TYPE_CON, COAP_GET, i);
+    coap_set_header_uri_path(request, "sensor");
+    coap_set_header_observe(request, 0);
+    coap_set_token(request, token, i % (COAP_TOKEN_LEN + 1));
+    coap_init_message(response, COAP_TYPE_ACK, CONTENT_2_05, i);
+
+    uip_ipaddr_copy(&UIP_IP_BUF->srcipaddr, &client_addr);
+    UIP_UDP_BUF->srcport = uip_htons(FIRST_PORT + i);
+    coap_observe_handler(&res_sensor, request, response);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+reset_counters(void)
+{
+  handler_calls = 0;
+  packets = 0;
+  con_packets = 0;
+  bad_hmacs = 0;
+  memset(received, 0, sizeof(received));
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(coap_observe_bench_process, ev, data)
+{
+  static struct etimer et;
+  static unsigned long changes;
+  static unsigned long fast_received;
+  static clock_time_t start;
+  static clock_time_t elapsed;
+  uip_lladdr_t lladdr;
+  int i;
+
+  PROCESS_BEGIN();
+
+  rest_init_engine();
+  rest_activate_resource(&res_sensor, "sensor");
+
+  uiplib_ip6addrconv(CLIENT_ADDR, &client_addr);
+  memset(&lladdr, 0x01, sizeof(lladdr));
+  uip_ds6_nbr_add(&client_addr, &lladdr, 0, NBR_REACHABLE,
+                  NBR_TABLE_REASON_UNDEFINED, NULL);
+  tcpip_set_outputfunc(count_output);
+
+  /* Let the engine start before the first notification */
+  etimer_set(&et, 1);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+  add_observers();
+
+  printf("Batched notifications: %d, %d observers, %d of them slow\n",
+         COAP_OBSERVE_BATCH_NOTIFICATIONS, NUM_OBSERVERS,
+         NUM_SLOW_OBSERVERS);
+
+  /* CPU time, with all observers acknowledging */
+  reset_counters();
+  ack_slow = 1;
+  changes = 0;
+  start = clock_time();
+  do {
+    for(i = 0; i < BATCH_SIZE; i++) {
+      state_change();
+    }
+    changes += BATCH_SIZE;
+    elapsed = clock_time() - start;
+  } while(elapsed < MEASUREMENT_DURATION);
+  printf("All observers acknowledging:\n");
+  printf("  CPU time per state change: %lu ns\n",
+         (unsigned long)(elapsed * (1000000000UL / CLOCK_SECOND) / changes));
+  printf("  handler calls per state change: %lu\n", handler_calls / changes);
+  printf("  packets per state change: %lu\n", packets / changes);
+
+
+  /*
+   * State changes at 200 Hz. The run ends before the first retransmission:
+   * the software AES driver cannot decrypt, which retransmitting an
+   * encrypted notification needs.
+   */
+  reset_counters();
+  ack_slow = 0;
+  verify = 1;
+  for(changes = 0; changes < STATE_CHANGES; changes++) {
+    state_change();
+    etimer_set(&et, CLOCK_SECOND / 200);
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+    acknowledge();
+  }
+  fast_received = 0;
+  for(i = NUM_SLOW_OBSERVERS; i < NUM_OBSERVERS; i++) {
+    fast_received += received[i];
+  }
+  printf("%u state changes, slow observers not acknowledging:\n",
+         STATE_CHANGES);
+  printf("  handler calls per state change: %lu.%02lu\n",
+         handler_calls / STATE_CHANGES,
+         handler_calls * 100 / STATE_CHANGES % 100);
+  printf("  packets per state change: %lu.%02lu, CON: %lu\n",
+         packets / STATE_CHANGES, packets * 100 / STATE_CHANGES % 100,
+         con_packets);
+  printf("  notifications to fast observers: %lu of %lu\n", fast_received,
+         (unsigned long)STATE_CHANGES * (NUM_OBSERVERS - NUM_SLOW_OBSERVERS));
+  printf("  packets to each slow observer: %lu\n", received[0]);
+  printf("  packets with a bad HMAC: %lu\n", bad_hmacs);
+
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
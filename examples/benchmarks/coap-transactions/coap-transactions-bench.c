@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2026, Hasso-Plattner-Institut.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Measures the CoAP transaction and observer lookups with 64
+ *         concurrent confirmable requests and 64 observers: ACK lookups
+ *         by MID, retransmission timer polls, ACKs that free a transaction
+ *         for a new request, and RSTs that cancel an observation. Then
+ *         checks that no request is retransmitted early. Build with
+ *         DEFINES=COAP_WITH_HASH_INDEX=0 to measure the transaction and
+ *         observer lists.
+ */
+
+#include "contiki.h"
+#include "contiki-net.h"
+#include "er-coap.h"
+#include "er-coap-engine.h"
+#include "er-coap-observe.h"
+#include "er-coap-transactions.h"
+#include "lib/random.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MEASUREMENT_DURATION (CLOCK_SECOND / 2)
+#define BATCH_SIZE 100
+#define NUM_CLIENTS 64
+#define FIRST_PORT 6000
+#define CLIENT_ADDR "fe80::1"
+#define RETRANSMISSION_WAIT (CLOCK_SECOND * 10)
+
+static uip_ipaddr_t client_addr;
+static uint16_t mids[NUM_CLIENTS];
+
+/* Requests seen by the network, per client */
+static uint16_t last_mid[NUM_CLIENTS];
+static clock_time_t last_sent[NUM_CLIENTS];
+static unsigned long retransmissions;
+static unsigned long early_retransmissions;
+
+static void res_get_handler(void *request, void *response, uint8_t *buffer,
+                            uint16_t preferred_size, int32_t *offset);
+EVENT_RESOURCE(res_sensor, "title=\"Sensor\";obs", res_get_handler, NULL,
+               NULL, NULL, NULL);
+
+PROCESS(coap_transactions_bench_process, "CoAP transactions benchmark");
+AUTOSTART_PROCESSES(&coap_transactions_bench_process);
+/*---------------------------------------------------------------------------*/
+static void
+res_get_handler(void *request, void *response, uint8_t *buffer,
+                uint16_t preferred_size, int32_t *offset)
+{
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+count_output(const uip_lladdr_t *lladdr)
+{
+  coap_scan_t scan;
+  uint16_t client;
+
+  if(UIP_IP_BUF->proto != UIP_PROTO_UDP) {
+    return 0;
+  }
+  client = uip_ntohs(UIP_UDP_BUF->destport) - FIRST_PORT;
+  if(client >= NUM_CLIENTS
+     || coap_scan_message(&scan, &uip_buf[UIP_LLH_LEN + UIP_IPUDPH_LEN],
+                          uip_ntohs(UIP_UDP_BUF->udplen) - UIP_UDPH_LEN)
+     != NO_ERROR) {
+    return 0;
+  }
+
+  if(scan.mid == last_mid[client]) {
+    retransmissions++;
+    if(clock_time() - last_sent[client] < COAP_RESPONSE_TIMEOUT_TICKS) {
+      early_retransmissions++;
+    }
+  }
+  last_mid[client] = scan.mid;
+  last_sent[client] = clock_time();
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Sends a confirmable request that waits for an ACK */
+static void
+send_request(int client)
+{
+  coap_packet_t request[1];
+  coap_transaction_t *t;
+
+  t = coap_new_transaction(coap_get_mid(), &client_addr,
+                           uip_htons(FIRST_PORT + client));
+  if(t == NULL) {
+    printf("No transaction for client %d\n", client);
+    exit(1);
+  }
+  coap_init_message(request, COAP_TYPE_CON, COAP_GET, t->mid);
+  coap_set_header_uri_path(request, "sensor");
+  t->packet_len = coap_serialize_message(request, t->packet);
+  mids[client] = t->mid;
+  coap_send_transaction(t);
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_observer(int client)
+{
+  coap_packet_t request[1];
+  coap_packet_t response[1];
+  uint8_t token[2];
+
+  token[0] = client;
+  token[1] = client >> 8;
+  coap_init_message(request, COAP_TYPE_CON, COAP_GET, client);
+  coap_set_header_uri_path(request, "sensor");
+  coap_set_header_observe(request, 0);
+  coap_set_token(request, token, sizeof(token));
+  coap_init_message(response, COAP_TYPE_ACK, CONTENT_2_05, client);
+
+  uip_ipaddr_copy(&UIP_IP_BUF->srcipaddr, &client_addr);
+  UIP_UDP_BUF->srcport = uip_htons(FIRST_PORT + client);
+  coap_observe_handler(&res_sensor, request, response);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(coap_transactions_bench_process, ev, data)
+{
+  static struct etimer et;
+  static unsigned long ops;
+  static unsigned long failed;
+  static clock_time_t start;
+  static clock_time_t elapsed;
+  static int phase;
+  uip_lladdr_t lladdr;
+  coap_transaction_t *t;
+  int client;
+  int i;
+
+  PROCESS_BEGIN();
+
+  rest_init_engine();
+  rest_activate_resource(&res_sensor, "sensor");
+
+  uiplib_ip6addrconv(CLIENT_ADDR, &client_addr);
+  memset(&lladdr, 0x01, sizeof(lladdr));
+  uip_ds6_nbr_add(&client_addr, &lladdr, 0, NBR_REACHABLE,
+                  NBR_TABLE_REASON_UNDEFINED, NULL);
+  tcpip_set_outputfunc(count_output);
+
+  /* Let the engine start before the first request */
+  etimer_set(&et, 1);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+
+  printf("Hash index: %d, %d transactions, %d observers\n",
+         COAP_WITH_HASH_INDEX, NUM_CLIENTS, NUM_CLIENTS);
+  for(client = 0; client < NUM_CLIENTS; client++) {
+    send_request(client);
+    add_observer(client);
+  }
+
+  /* Nothing is due for COAP_RESPONSE_TIMEOUT, so no phase retransmits */
+  for(phase = 0; phase < 4; phase++) {
+    ops = 0;
+    failed = 0;
+    start = clock_time();
+    do {
+      for(i = 0; i < BATCH_SIZE; i++) {
+        client = random_rand() % NUM_CLIENTS;
+        if(phase == 0) {
+          /* the retransmission timer fired */
+          coap_check_transactions();
+        } else if(phase == 1) {
+          /* an ACK arrived */
+          failed += coap_get_transaction_by_mid(mids[client]) == NULL;
+        } else if(phase == 2) {
+          /* an ACK arrived, and the client sends the next request */
+          t = coap_get_transaction_by_mid(mids[client]);
+          failed += t == NULL;
+          coap_clear_transaction(t);
+          send_request(client);
+        } else {
+          /* an RST cancelled the observation, and the client observes again */
+          failed += coap_remove_observer_by_mid(&client_addr,
+                                                uip_htons(FIRST_PORT + client),
+                                                0) != 1;
+          add_observer(client);
+        }
+      }
+      ops += BATCH_SIZE;
+      elapsed = clock_time() - start;
+    } while(elapsed < MEASUREMENT_DURATION);
+
+    printf("%s: %lu ns, %lu failed\n",
+           phase == 0 ? "Timer poll with nothing due"
+           : phase == 1 ? "ACK lookup"
+           : phase == 2 ? "ACK and new request"
+           : "RST and new observation",
+           (unsigned long)(elapsed * (1000000000UL / CLOCK_SECOND) / ops),
+           failed);
+  }
+
+  /* The clients never acknowledge again */
+  retransmissions = 0;
+  early_retransmissions = 0;
+  etimer_set(&et, RETRANSMISSION_WAIT);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+  printf("Retransmissions in %lu s: %lu, %lu of them early\n",
+         (unsigned long)(RETRANSMISSION_WAIT / CLOCK_SECOND),
+         retransmissions, early_retransmissions);
+
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
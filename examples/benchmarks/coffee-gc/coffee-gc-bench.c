@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) 2026, Hasso-Plattner-Institut.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Measures the latency percentiles of cfs_open(CFS_WRITE) and
+ *         cfs_write() while a logger keeps appending to new files in
+ *         Coffee and removes the oldest ones. Each sector erase of the
+ *         emulated flash takes ERASE_TIME milliseconds, as on a NOR
+ *         flash. Build with DEFINES=COFFEE_CONF_BACKGROUND_GC=0 to
+ *         measure the garbage collection from within the writes.
+ */
+
+#include "contiki.h"
+#include "cfs/cfs.h"
+#include "cfs/cfs-coffee.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ERASE_TIME 20
+#define FILES 400
+#define KEPT_FILES 40
+#define WRITES_PER_FILE 48
+#define WRITE_SIZE 128
+#define MAX_LATENCY 1000
+
+static unsigned long erases;
+static unsigned long latencies[MAX_LATENCY + 1];
+static unsigned long ops;
+
+PROCESS(coffee_gc_bench_process, "Coffee GC benchmark");
+AUTOSTART_PROCESSES(&coffee_gc_bench_process);
+/*---------------------------------------------------------------------------*/
+int __real_xmem_erase(long nbytes, unsigned long offset);
+
+int
+__wrap_xmem_erase(long nbytes, unsigned long offset)
+{
+  clock_time_t start;
+
+  erases++;
+  start = clock_time();
+  while(clock_time() - start < ERASE_TIME);
+  return __real_xmem_erase(nbytes, offset);
+}
+/*---------------------------------------------------------------------------*/
+static void
+record(clock_time_t start)
+{
+  clock_time_t latency;
+
+  latency = clock_time() - start;
+  latencies[latency < MAX_LATENCY ? latency : MAX_LATENCY]++;
+  ops++;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned
+percentile(unsigned long permille)
+{
+  unsigned long count;
+  unsigned latency;
+
+  count = 0;
+  for(latency = 0; latency < MAX_LATENCY; latency++) {
+    count += latencies[latency];
+    if(count * 1000 >= ops * permille) {
+      break;
+    }
+  }
+  return latency;
+}
+/*---------------------------------------------------------------------------*/
+static void
+filename(char *name, int file)
+{
+  sprintf(name, "log%d", file);
+}
+/*---------------------------------------------------------------------------*/
+static void
+fill(uint8_t *buf, int file, int write)
+{
+  memset(buf, file + write, WRITE_SIZE);
+}
+/*---------------------------------------------------------------------------*/
+static int
+verify(int file)
+{
+  uint8_t buf[WRITE_SIZE];
+  uint8_t expected[WRITE_SIZE];
+  char name[16];
+  int fd;
+  int i;
+
+  filename(name, file);
+  fd = cfs_open(name, CFS_READ);
+  if(fd < 0) {
+    return 0;
+  }
+  for(i = 0; i < WRITES_PER_FILE; i++) {
+    fill(expected, file, i);
+    if(cfs_read(fd, buf, WRITE_SIZE) != WRITE_SIZE
+       || memcmp(buf, expected, WRITE_SIZE)) {
+      break;
+    }
+  }
+  cfs_close(fd);
+  return i == WRITES_PER_FILE;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(coffee_gc_bench_process, ev, data)
+{
+  static int file;
+  static int write;
+  static int fd;
+  static clock_time_t elapsed;
+  uint8_t buf[WRITE_SIZE];
+  char name[16];
+  clock_time_t start;
+
+  PROCESS_BEGIN();
+
+  cfs_coffee_format();
+  erases = 0;
+  elapsed = clock_time();
+
+  for(file = 0; file < FILES; file++) {
+    if(file >= KEPT_FILES) {
+      filename(name, file - KEPT_FILES);
+      cfs_remove(name);
+    }
+
+    filename(name, file);
+    start = clock_time();
+    fd = cfs_open(name, CFS_WRITE);
+    record(start);
+    if(fd < 0) {
+      printf("opening %s failed\n", name);
+      exit(1);
+    }
+
+    for(write = 0; write < WRITES_PER_FILE; write++) {
+      fill(buf, file, write);
+      start = clock_time();
+      if(cfs_write(fd, buf, WRITE_SIZE) != WRITE_SIZE) {
+        printf("writing %s failed\n", name);
+        exit(1);
+      }
+      record(start);
+
+      /* Let other processes run between the writes. */
+      PROCESS_PAUSE();
+    }
+    cfs_close(fd);
+  }
+  elapsed = clock_time() - elapsed;
+
+  for(file = FILES - KEPT_FILES; file < FILES; file++) {
+    if(!verify(file)) {
+      printf("log%d differs\n", file);
+      exit(1);
+    }
+  }
+
+  printf("p50 (ms)\tp99 (ms)\tp99.9 (ms)\tmax (ms)\terases\ttotal (ms)\n");
+  printf("%u\t%u\t%u\t%u\t%lu\t%lu\n", percentile(500), percentile(990),
+         percentile(999), percentile(1000), erases, (unsigned long)elapsed);
+
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2026, Hasso-Plattner-Institut.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Measures the flash reads that Coffee needs for random reads of
+ *         a file with many micro-log records, with the log record map.
+ *         Build with DEFINES=COFFEE_CONF_LOG_MAP_SIZE=0 to measure the
+ *         search of the log index table.
+ */
+
+#include "contiki.h"
+#include "cfs/cfs.h"
+#include "cfs/cfs-coffee.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FILENAME "config"
+#define FILE_SIZE 1024
+#define RECORD_SIZE 32
+#define LOG_RECORDS 64
+#define WRITE_SIZE 8
+#define READ_SIZE 16
+#define MEASUREMENT_DURATION (CLOCK_SECOND / 4)
+#define BATCH_SIZE 16
+
+static unsigned long reads;
+static unsigned long read_bytes;
+static uint8_t shadow[FILE_SIZE];
+static int fd;
+
+PROCESS(coffee_log_read_bench_process, "Coffee log read benchmark");
+AUTOSTART_PROCESSES(&coffee_log_read_bench_process);
+/*---------------------------------------------------------------------------*/
+int __real_xmem_pread(void *buf, int size, unsigned long offset);
+
+int
+__wrap_xmem_pread(void *buf, int size, unsigned long offset)
+{
+  reads++;
+  read_bytes += size;
+  return __real_xmem_pread(buf, size, offset);
+}
+/*---------------------------------------------------------------------------*/
+static int
+modify(int count)
+{
+  uint8_t buf[WRITE_SIZE];
+  unsigned offset;
+  int i;
+
+  for(; count > 0; count--) {
+    /* every write stays within a log region and adds one record */
+    offset = (rand() % (FILE_SIZE / RECORD_SIZE)) * RECORD_SIZE
+      + rand() % (RECORD_SIZE - WRITE_SIZE + 1);
+    for(i = 0; i < WRITE_SIZE; i++) {
+      buf[i] = rand();
+    }
+    memcpy(&shadow[offset], buf, WRITE_SIZE);
+    if(cfs_seek(fd, offset, CFS_SEEK_SET) != offset
+       || cfs_write(fd, buf, WRITE_SIZE) != WRITE_SIZE) {
+      printf("writing at %u failed\n", offset);
+      return 0;
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+verify(void)
+{
+  uint8_t buf[READ_SIZE];
+  unsigned offset;
+
+  for(offset = 0; offset < FILE_SIZE; offset += READ_SIZE) {
+    if(cfs_seek(fd, offset, CFS_SEEK_SET) != offset
+       || cfs_read(fd, buf, READ_SIZE) != READ_SIZE
+       || memcmp(buf, &shadow[offset], READ_SIZE)) {
+      printf("file differs at %u\n", offset);
+      return 0;
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+op_read(void)
+{
+  uint8_t buf[READ_SIZE];
+  unsigned offset;
+
+  offset = (rand() % (FILE_SIZE / READ_SIZE)) * READ_SIZE;
+  cfs_seek(fd, offset, CFS_SEEK_SET);
+  cfs_read(fd, buf, READ_SIZE);
+}
+/*---------------------------------------------------------------------------*/
+static void
+measure(void)
+{
+  unsigned long ops;
+  unsigned long start_reads;
+  unsigned long start_bytes;
+  clock_time_t start;
+  clock_time_t elapsed;
+  int i;
+
+  ops = 0;
+  start_reads = reads;
+  start_bytes = read_bytes;
+  start = clock_time();
+  do {
+    for(i = 0; i < BATCH_SIZE; i++) {
+      op_read();
+    }
+    ops += BATCH_SIZE;
+    elapsed = clock_time() - start;
+  } while(elapsed < MEASUREMENT_DURATION);
+
+  printf("%lu\t%lu\t%lu\n", ops * CLOCK_SECOND / elapsed,
+         (reads - start_reads) / ops, (read_bytes - start_bytes) / ops);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(coffee_log_read_bench_process, ev, data)
+{
+  int i;
+
+  PROCESS_BEGIN();
+
+  cfs_coffee_format();
+  for(i = 0; i < FILE_SIZE; i++) {
+    shadow[i] = rand();
+  }
+  fd = cfs_open(FILENAME, CFS_WRITE);
+  if(fd < 0 || cfs_write(fd, shadow, FILE_SIZE) != FILE_SIZE) {
+    printf("creating %s failed\n", FILENAME);
+    exit(1);
+  }
+  cfs_close(fd);
+  if(cfs_coffee_configure_log(FILENAME, LOG_RECORDS * RECORD_SIZE,
+                              RECORD_SIZE) < 0) {
+    printf("configuring the log failed\n");
+    exit(1);
+  }
+
+  fd = cfs_open(FILENAME, CFS_READ | CFS_WRITE);
+  if(fd < 0 || !modify(LOG_RECORDS - 4) || !verify()) {
+    exit(1);
+  }
+
+  printf("reads/s\tflash reads per read\tflash bytes per read\n");
+  measure();
+
+  /* fill the log so that the file is merged with it, and check again */
+  if(!modify(LOG_RECORDS) || !verify()) {
+    exit(1);
+  }
+  cfs_close(fd);
+
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2026, Hasso-Plattner-Institut.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Measures how fast Coffee opens one of 500 files, and how many
+ *         flash reads an open takes, with the name index. Build with
+ *         DEFINES=COFFEE_CONF_NAME_INDEX_SIZE=0 to measure the flash scan.
+ */
+
+#include "contiki.h"
+#include "cfs/cfs.h"
+#include "cfs/cfs-coffee.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define FILES 500
+#define FILE_SIZE 16
+#define MEASUREMENT_DURATION (CLOCK_SECOND / 4)
+#define BATCH_SIZE 16
+
+static unsigned long reads;
+static unsigned next_file;
+static char name[8];
+
+PROCESS(coffee_open_bench_process, "Coffee open benchmark");
+AUTOSTART_PROCESSES(&coffee_open_bench_process);
+/*---------------------------------------------------------------------------*/
+int __real_xmem_pread(void *buf, int size, unsigned long offset);
+
+int
+__wrap_xmem_pread(void *buf, int size, unsigned long offset)
+{
+  reads++;
+  return __real_xmem_pread(buf, size, offset);
+}
+/*---------------------------------------------------------------------------*/
+static const char *
+file_name(unsigned i)
+{
+  snprintf(name, sizeof(name), "f%03u", i);
+  return name;
+}
+/*---------------------------------------------------------------------------*/
+static void
+op_open(void)
+{
+  int fd;
+
+  /* visit the files in a scattered order */
+  next_file = (next_file + 263) % FILES;
+  fd = cfs_open(file_name(next_file), CFS_READ);
+  if(fd < 0) {
+    printf("opening %s failed\n", name);
+    exit(1);
+  }
+  cfs_close(fd);
+}
+/*---------------------------------------------------------------------------*/
+static void
+op_open_missing(void)
+{
+  if(cfs_open("missing", CFS_READ) >= 0) {
+    printf("opened a missing file\n");
+    exit(1);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+measure(const char *label, void (*op)(void))
+{
+  unsigned long ops;
+  unsigned long start_reads;
+  clock_time_t start;
+  clock_time_t elapsed;
+  int i;
+
+  ops = 0;
+  start_reads = reads;
+  start = clock_time();
+  do {
+    for(i = 0; i < BATCH_SIZE; i++) {
+      op();
+    }
+    ops += BATCH_SIZE;
+    elapsed = clock_time() - start;
+  } while(elapsed < MEASUREMENT_DURATION);
+
+  printf("%s\t%lu\t%lu\n", label, ops * CLOCK_SECOND / elapsed,
+         (reads - start_reads) / ops);
+}
+/*---------------------------------------------------------------------------*/
+static int
+check_files(void)
+{
+  int fd;
+
+  /* removed and recreated files must be found at their new place */
+  if(cfs_remove(file_name(7)) < 0) {
+    return 0;
+  }
+  if(cfs_open(file_name(7), CFS_READ) >= 0) {
+    printf("found removed file %s\n", name);
+    return 0;
+  }
+  fd = cfs_open(file_name(7), CFS_WRITE);
+  if(fd < 0 || cfs_write(fd, name, FILE_SIZE) != FILE_SIZE) {
+    return 0;
+  }
+  cfs_close(fd);
+  fd = cfs_open(file_name(7), CFS_READ);
+  if(fd < 0 || cfs_seek(fd, 0, CFS_SEEK_END) != FILE_SIZE) {
+    printf("recreated file %s not found\n", name);
+    return 0;
+  }
+  cfs_close(fd);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(coffee_open_bench_process, ev, data)
+{
+  unsigned i;
+
+  PROCESS_BEGIN();
+
+  cfs_coffee_format();
+  for(i = 0; i < FILES; i++) {
+    if(cfs_coffee_reserve(file_name(i), FILE_SIZE) < 0) {
+      printf("reserving %s failed\n", name);
+      exit(1);
+    }
+  }
+  if(!check_files()) {
+    exit(1);
+  }
+
+  printf("operation\topens/s\tflash reads per open\n");
+  measure("existing file", op_open);
+  measure("missing file", op_open_missing);
+
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,264 @@
+/*
+ * Copyright (c) 2026, Hasso-Plattner-Institut.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Measures CSMA with 32 neighbor queues: the time send_packet()
+ *         takes to find a queue, how many packets neighbors get queued
+ *         while one chatty neighbor floods the packet pool, and the
+ *         statistics CSMA keeps per neighbor. Compare against
+ *         CSMA_CONF_WITH_NBR_TABLE=0 and CSMA_CONF_WITH_FAIR_SHARE=0.
+ */
+
+#include "contiki.h"
+#include "net/mac/csma.h"
+#include "net/mac/rdc.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+#include "net/queuebuf.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MEASUREMENT_DURATION (CLOCK_SECOND / 4)
+#define NEIGHBORS 32
+#define CHATTY_PACKETS 32
+#define QUIET_NEIGHBORS 7
+#define QUIET_PACKETS 2
+
+struct held_frame {
+  mac_callback_t sent;
+  void *ptr;
+  struct queuebuf *buf;
+};
+
+static struct held_frame held[QUEUEBUF_CONF_NUM + 8];
+static int held_count;
+static int outstanding;
+static int refused[NEIGHBORS];
+static int odd_transmission;
+
+PROCESS(csma_queues_bench_process, "CSMA queues benchmark");
+AUTOSTART_PROCESSES(&csma_queues_bench_process);
+/*---------------------------------------------------------------------------*/
+static void
+hold_init(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+static void
+hold_send(mac_callback_t sent, void *ptr)
+{
+  mac_call_sent_callback(sent, ptr, MAC_TX_OK, 1);
+}
+/*---------------------------------------------------------------------------*/
+static void
+hold_send_list(mac_callback_t sent, void *ptr, struct rdc_buf_list *list)
+{
+  if(held_count < sizeof(held) / sizeof(held[0])) {
+    held[held_count].sent = sent;
+    held[held_count].ptr = ptr;
+    held[held_count].buf = list->buf;
+    held_count++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+hold_input(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+static int
+hold_on(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+hold_off(int keep_radio_on)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned short
+hold_channel_check_interval(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+const struct rdc_driver hold_rdc_driver = {
+  "hold",
+  hold_init,
+  hold_send,
+  hold_send_list,
+  hold_input,
+  hold_on,
+  hold_off,
+  hold_channel_check_interval,
+};
+/*---------------------------------------------------------------------------*/
+/* Completes the held frames, every other one after a missing ACK */
+static void
+complete_held_frames(void)
+{
+  struct held_frame frame;
+
+  while(held_count) {
+    frame = held[--held_count];
+    queuebuf_to_packetbuf(frame.buf);
+    odd_transmission = !odd_transmission;
+    frame.sent(frame.ptr, odd_transmission ? MAC_TX_NOACK : MAC_TX_OK, 1);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+on_sent(void *ptr, int status, int transmissions)
+{
+  outstanding--;
+  if(status == MAC_TX_ERR) {
+    refused[(uintptr_t)ptr]++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+set_addr(linkaddr_t *addr, int neighbor)
+{
+  memset(addr, 0, sizeof(linkaddr_t));
+  addr->u8[0] = 0x02;
+  addr->u8[LINKADDR_SIZE - 1] = neighbor + 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_to(int neighbor)
+{
+  static uint8_t seqno;
+  linkaddr_t addr;
+
+  set_addr(&addr, neighbor);
+  packetbuf_clear();
+  memset(packetbuf_dataptr(), neighbor, 40);
+  packetbuf_set_datalen(40);
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &addr);
+  packetbuf_set_attr(PACKETBUF_ATTR_MAC_SEQNO, ++seqno);
+  outstanding++;
+  NETSTACK_MAC.send(on_sent, (void *)(uintptr_t)neighbor);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(csma_queues_bench_process, ev, data)
+{
+  static struct etimer et;
+  struct csma_neighbor_stats neighbor_stats;
+  static struct csma_stats before;
+  const struct csma_stats *stats;
+  linkaddr_t addr;
+  unsigned long count;
+  clock_time_t start;
+  clock_time_t elapsed;
+  int n;
+
+  PROCESS_BEGIN();
+
+  printf("CSMA_CONF_WITH_NBR_TABLE %d, CSMA_CONF_WITH_FAIR_SHARE %d\n",
+         CSMA_CONF_WITH_NBR_TABLE, CSMA_CONF_WITH_FAIR_SHARE);
+
+  /* One packet per neighbor fills the packet pool */
+  for(n = 0; n < NEIGHBORS; n++) {
+    send_to(n);
+  }
+  /* Each further packet needs a lookup and is dropped for lack of buffers */
+  count = 0;
+  start = clock_time();
+  do {
+    for(n = 0; n < 1000; n++) {
+      send_to(NEIGHBORS - 1);
+    }
+    count += 1000;
+    elapsed = clock_time() - start;
+  } while(elapsed < MEASUREMENT_DURATION);
+  printf("ns per send_packet to the last of %d queues: %lu\n", NEIGHBORS,
+         (unsigned long)((unsigned long long)elapsed
+             * (1000000000 / CLOCK_SECOND) / count));
+
+  while(outstanding) {
+    etimer_set(&et, 1);
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+    complete_held_frames();
+  }
+  memset(refused, 0, sizeof(refused));
+  before = *csma_get_stats();
+
+  /* A chatty neighbor, then a few quiet ones */
+  for(n = 0; n < CHATTY_PACKETS; n++) {
+    send_to(0);
+  }
+  for(n = 1; n <= QUIET_NEIGHBORS * QUIET_PACKETS; n++) {
+    send_to(1 + (n % QUIET_NEIGHBORS));
+  }
+  printf("chatty neighbor: %d of %d packets queued\n",
+         CHATTY_PACKETS - refused[0], CHATTY_PACKETS);
+  for(n = 1; n <= QUIET_NEIGHBORS; n++) {
+    printf("quiet neighbor %d: %d of %d packets queued\n",
+           n, QUIET_PACKETS - refused[n], QUIET_PACKETS);
+  }
+
+  while(outstanding) {
+    etimer_set(&et, 1);
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+    complete_held_frames();
+  }
+
+  stats = csma_get_stats();
+  printf("drops: no queue %u, queue full %u, fair share %u, no buffer %u, noack %u, collision %u, err %u\n",
+         stats->no_queue - before.no_queue,
+         stats->queue_full - before.queue_full,
+         stats->fair_share - before.fair_share,
+         stats->no_buffer - before.no_buffer,
+         stats->noack - before.noack,
+         stats->collision - before.collision,
+         stats->err - before.err);
+  for(n = 0; n < 3; n++) {
+    set_addr(&addr, n);
+    if(csma_get_neighbor_stats(&addr, &neighbor_stats)) {
+      printf("neighbor %d: queue length %u, transmissions %u, retransmissions %u, drops %u\n",
+             n, neighbor_stats.queue_length, neighbor_stats.transmissions,
+             neighbor_stats.retransmissions, neighbor_stats.drops);
+    } else {
+      printf("neighbor %d: no statistics\n", n);
+    }
+  }
+
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2026, Hasso-Plattner-Institut.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Measures the cost of the event timer library with 1000 active
+ *         timers: re-arming a timer, querying the next expiration time,
+ *         and one wakeup of the etimer process. Build with
+ *         DEFINES=ETIMER_CONF_SORTED=0 to measure the unsorted list.
+ */
+
+#include "contiki.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NUM_TIMERS 1000
+#define MEASUREMENT_DURATION (CLOCK_SECOND / 4)
+#define BATCH_SIZE 16
+
+static struct etimer timers[NUM_TIMERS];
+static volatile clock_time_t sink;
+
+PROCESS(etimer_bench_process, "Etimer benchmark");
+AUTOSTART_PROCESSES(&etimer_bench_process);
+/*---------------------------------------------------------------------------*/
+static clock_time_t
+random_interval(void)
+{
+  /* Long enough that no timer expires while measuring */
+  return 60 * CLOCK_SECOND + rand() % (600 * CLOCK_SECOND);
+}
+/*---------------------------------------------------------------------------*/
+static void
+op_set(void)
+{
+  etimer_set(&timers[rand() % NUM_TIMERS], random_interval());
+}
+/*---------------------------------------------------------------------------*/
+static void
+op_next_expiration(void)
+{
+  sink = etimer_next_expiration_time();
+}
+/*---------------------------------------------------------------------------*/
+static void
+op_wakeup(void)
+{
+  process_post_synch(&etimer_process, PROCESS_EVENT_POLL, NULL);
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+measure(void (*op)(void))
+{
+  unsigned long ops;
+  clock_time_t start;
+  clock_time_t elapsed;
+  int i;
+
+  ops = 0;
+  start = clock_time();
+  do {
+    for(i = 0; i < BATCH_SIZE; i++) {
+      op();
+    }
+    ops += BATCH_SIZE;
+    elapsed = clock_time() - start;
+  } while(elapsed < MEASUREMENT_DURATION);
+
+  return ops * CLOCK_SECOND / elapsed;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(etimer_bench_process, ev, data)
+{
+  static struct etimer et;
+  int i;
+
+  PROCESS_BEGIN();
+
+  for(i = 0; i < NUM_TIMERS; i++) {
+    etimer_set(&timers[i], random_interval());
+  }
+
+  printf("%d timers, sorted list %s\n", NUM_TIMERS,
+         ETIMER_SORTED ? "enabled" : "disabled");
+  printf("etimer_set: %lu ops/s\n", measure(op_set));
+  printf("etimer_next_expiration_time: %lu ops/s\n",
+         measure(op_next_expiration));
+  printf("etimer process wakeup: %lu ops/s\n", measure(op_wakeup));
+
+  /* Check that a short timer still fires among the long ones. */
+  etimer_set(&et, CLOCK_SECOND / 10);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+  printf("short timer expired\n");
+
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,505 @@
+/*
+ * Copyright (c) 2026, Hasso-Plattner-Institut.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Measures MQTT publishes per second at QoS 0, 1 and 2 against a
+ *         broker with a 40 ms round-trip time, for the inflight window set
+ *         by MQTT_CONF_INFLIGHT_WINDOW. Then measures the same for 4 KB
+ *         payloads written by mqtt_publish_stream(), and has the broker
+ *         send a PUBLISH back to check that 400 bytes arrive in one piece
+ *         and 4 KB in chunks.
+ *         The broker is a stand-in in the
+ *         same process: it takes the IPv6 packets uIP sends, answers the
+ *         TCP segments and the MQTT packets in them, and feeds its answers
+ *         back into uIP once the round-trip time has passed.
+ */
+
+#include "contiki.h"
+#include "contiki-net.h"
+#include "mqtt.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MEASUREMENT_DURATION (CLOCK_SECOND * 2)
+#define ROUND_TRIP_TIME (CLOCK_SECOND / 25)
+#define BROKER_ADDR "fe80::1"
+#define BROKER_PORT 1883
+#define TOPIC "bench/data"
+#define PAYLOAD_LEN 32
+#define STREAM_TOPIC "bench/stream"
+#define STREAM_PAYLOAD_LEN 4096
+/* The broker answers a publish to this topic with a large one of its own */
+#define ECHO_TOPIC "bench/echo"
+#define ECHO_SMALL_LEN 400
+#define ECHO_LARGE_LEN 4096
+
+#define UIP_IP_BUF ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+#define UIP_TCP_BUF ((struct uip_tcp_hdr *)&uip_buf[UIP_LLH_LEN + UIP_IPH_LEN])
+
+#define TCP_FIN 0x01
+#define TCP_SYN 0x02
+#define TCP_PSH 0x08
+#define TCP_ACK 0x10
+
+#define NUM_SEGMENTS 32
+#define SEGMENT_LEN 256
+
+/* A TCP segment from the broker, due after the round-trip time */
+struct segment {
+  struct timer due;
+  uint32_t seqno;
+  uint32_t ackno;
+  uint8_t flags;
+  uint16_t len;
+  uint8_t data[SEGMENT_LEN];
+};
+
+static struct segment segments[NUM_SEGMENTS];
+static uint8_t segment_head;
+static uint8_t segment_count;
+
+static uip_ipaddr_t broker_addr;
+static uip_ipaddr_t client_addr;
+static uint16_t client_port;
+static uint32_t broker_seqno;
+static uint32_t broker_ackno;
+
+/*
+ * The MQTT packet the broker is reading. Only its start is kept, which is
+ * all the broker needs to answer.
+ */
+static uint8_t mqtt_in[64];
+static uint32_t mqtt_in_len;
+static uint16_t echo_pending;
+static uint16_t echo_length;
+
+static struct mqtt_connection conn;
+static uint8_t payload[PAYLOAD_LEN];
+static unsigned long completed;
+
+/* What arrived of the broker's large PUBLISH */
+static uint32_t echo_received;
+static uint16_t echo_chunks;
+static uint16_t echo_largest_chunk;
+static uint16_t echo_errors;
+static uint8_t echo_done;
+
+PROCESS(mqtt_publish_bench_process, "MQTT publish benchmark");
+PROCESS(broker_process, "MQTT broker stand-in");
+AUTOSTART_PROCESSES(&mqtt_publish_bench_process, &broker_process);
+/*---------------------------------------------------------------------------*/
+static uint32_t
+get32(const uint8_t *p)
+{
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+         ((uint32_t)p[2] << 8) | p[3];
+}
+/*---------------------------------------------------------------------------*/
+static void
+put32(uint8_t *p, uint32_t value)
+{
+  p[0] = value >> 24;
+  p[1] = value >> 16;
+  p[2] = value >> 8;
+  p[3] = value;
+}
+/*---------------------------------------------------------------------------*/
+static struct segment *
+queue_segment(uint8_t flags)
+{
+  struct segment *seg;
+
+  if(segment_count == NUM_SEGMENTS) {
+    printf("broker: too many segments in flight\n");
+    exit(1);
+  }
+  seg = &segments[(segment_head + segment_count) % NUM_SEGMENTS];
+  segment_count++;
+  timer_set(&seg->due, ROUND_TRIP_TIME);
+  seg->seqno = broker_seqno;
+  seg->flags = flags;
+  seg->len = 0;
+  return seg;
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+pattern(uint32_t offset)
+{
+  return (offset * 7 + (offset >> 8)) & 0xFF;
+}
+/*---------------------------------------------------------------------------*/
+static void
+answer(struct segment *seg, uint8_t fhdr, const uint8_t *body, uint8_t len)
+{
+  if(seg->len + 2 + len > SEGMENT_LEN) {
+    printf("broker: segment full\n");
+    exit(1);
+  }
+  seg->data[seg->len++] = fhdr;
+  seg->data[seg->len++] = len;
+  memcpy(&seg->data[seg->len], body, len);
+  seg->len += len;
+}
+/*---------------------------------------------------------------------------*/
+/* Answers a complete MQTT packet the client sent */
+static void
+handle_mqtt(struct segment *seg, const uint8_t *body, uint16_t len)
+{
+  static const uint8_t connack[] = { 0, 0 };
+  uint8_t qos;
+  uint16_t topic_len;
+
+  switch(mqtt_in[0] & 0xF0) {
+  case 0x10:
+    answer(seg, 0x20, connack, sizeof(connack));
+    break;
+  case 0x30:
+    qos = (mqtt_in[0] >> 1) & 0x03;
+    topic_len = (body[0] << 8) | body[1];
+    if(topic_len == strlen(ECHO_TOPIC) &&
+       memcmp(&body[2], ECHO_TOPIC, topic_len) == 0) {
+      echo_pending = echo_length;
+    }
+    if(qos == 1) {
+      answer(seg, 0x40, &body[2 + topic_len], 2);
+    } else if(qos == 2) {
+      answer(seg, 0x50, &body[2 + topic_len], 2);
+    }
+    break;
+  case 0x60:
+    answer(seg, 0x70, body, 2);
+    break;
+  case 0xC0:
+    answer(seg, 0xD0, NULL, 0);
+    break;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Splits the TCP payload into MQTT packets, which may span segments */
+static void
+read_mqtt(struct segment *seg, const uint8_t *data, uint16_t len)
+{
+  uint32_t remaining;
+  uint32_t multiplier;
+  uint16_t hdr_len;
+
+  while(len > 0) {
+    if(mqtt_in_len < sizeof(mqtt_in)) {
+      mqtt_in[mqtt_in_len] = *data;
+    }
+    mqtt_in_len++;
+    data++;
+    len--;
+
+    /* Fixed header and remaining length */
+    remaining = 0;
+    multiplier = 1;
+    for(hdr_len = 1; hdr_len < mqtt_in_len; hdr_len++) {
+      remaining += (mqtt_in[hdr_len] & 0x7F) * multiplier;
+      multiplier *= 128;
+      if((mqtt_in[hdr_len] & 0x80) == 0) {
+        break;
+      }
+    }
+    if(hdr_len == mqtt_in_len || mqtt_in_len < hdr_len + 1 + remaining) {
+      continue;
+    }
+    handle_mqtt(seg, &mqtt_in[hdr_len + 1], remaining);
+    mqtt_in_len = 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Sends a QoS 0 PUBLISH of echo_pending bytes to the client */
+static void
+send_echo(void)
+{
+  struct segment *seg;
+  uint32_t remaining;
+  uint32_t offset;
+
+  remaining = 2 + strlen(ECHO_TOPIC) + echo_pending;
+  seg = queue_segment(TCP_ACK | TCP_PSH);
+  seg->ackno = broker_ackno;
+  seg->data[seg->len++] = 0x30;
+  do {
+    seg->data[seg->len] = remaining & 0x7F;
+    remaining >>= 7;
+    if(remaining > 0) {
+      seg->data[seg->len] |= 0x80;
+    }
+    seg->len++;
+  } while(remaining > 0);
+  seg->data[seg->len++] = 0;
+  seg->data[seg->len++] = strlen(ECHO_TOPIC);
+  memcpy(&seg->data[seg->len], ECHO_TOPIC, strlen(ECHO_TOPIC));
+  seg->len += strlen(ECHO_TOPIC);
+
+  for(offset = 0; offset < echo_pending; offset++) {
+    if(seg->len == SEGMENT_LEN) {
+      broker_seqno += seg->len;
+      seg = queue_segment(TCP_ACK | TCP_PSH);
+      seg->ackno = broker_ackno;
+    }
+    seg->data[seg->len++] = pattern(offset);
+  }
+  broker_seqno += seg->len;
+  echo_pending = 0;
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+broker_output(const uip_lladdr_t *lladdr)
+{
+  struct segment *seg;
+  uint32_t seqno;
+  uint16_t len;
+  uint8_t *data;
+
+  if(UIP_IP_BUF->proto != UIP_PROTO_TCP) {
+    return 0;
+  }
+
+  seqno = get32(UIP_TCP_BUF->seqno);
+  data = (uint8_t *)UIP_TCP_BUF + (UIP_TCP_BUF->tcpoffset >> 4) * 4;
+  len = ((UIP_IP_BUF->len[0] << 8) | UIP_IP_BUF->len[1]) -
+    (data - (uint8_t *)UIP_TCP_BUF);
+
+  if(UIP_TCP_BUF->flags & TCP_SYN) {
+    uip_ipaddr_copy(&client_addr, &UIP_IP_BUF->srcipaddr);
+    client_port = UIP_TCP_BUF->srcport;
+    broker_ackno = seqno + 1;
+    broker_seqno = 1000;
+    queue_segment(TCP_SYN | TCP_ACK)->ackno = broker_ackno;
+    broker_seqno++;
+    return 0;
+  }
+
+  if(len == 0 || (UIP_TCP_BUF->flags & TCP_FIN)) {
+    return 0;
+  }
+
+  seg = queue_segment(TCP_ACK | TCP_PSH);
+  if(seqno == broker_ackno) {
+    broker_ackno += len;
+    read_mqtt(seg, data, len);
+  }
+  seg->ackno = broker_ackno;
+  broker_seqno += seg->len;
+  if(echo_pending > 0) {
+    send_echo();
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_segment(struct segment *seg)
+{
+  uint16_t len;
+
+  len = UIP_TCPH_LEN + seg->len;
+  memset(uip_buf, 0, UIP_LLH_LEN + UIP_IPTCPH_LEN);
+  UIP_IP_BUF->vtc = 0x60;
+  UIP_IP_BUF->len[0] = len >> 8;
+  UIP_IP_BUF->len[1] = len & 0xFF;
+  UIP_IP_BUF->proto = UIP_PROTO_TCP;
+  UIP_IP_BUF->ttl = 64;
+  uip_ipaddr_copy(&UIP_IP_BUF->srcipaddr, &broker_addr);
+  uip_ipaddr_copy(&UIP_IP_BUF->destipaddr, &client_addr);
+
+  UIP_TCP_BUF->srcport = UIP_HTONS(BROKER_PORT);
+  UIP_TCP_BUF->destport = client_port;
+  put32(UIP_TCP_BUF->seqno, seg->seqno);
+  put32(UIP_TCP_BUF->ackno, seg->ackno);
+  UIP_TCP_BUF->tcpoffset = (UIP_TCPH_LEN / 4) << 4;
+  UIP_TCP_BUF->flags = seg->flags;
+  UIP_TCP_BUF->wnd[0] = 0x04;
+  memcpy(&uip_buf[UIP_LLH_LEN + UIP_IPTCPH_LEN], seg->data, seg->len);
+  uip_len = UIP_IPTCPH_LEN + seg->len;
+  UIP_TCP_BUF->tcpchksum = ~(uip_tcpchksum());
+
+  tcpip_input();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(broker_process, ev, data)
+{
+  static struct etimer et;
+  uip_lladdr_t lladdr;
+
+  PROCESS_BEGIN();
+
+  uiplib_ip6addrconv(BROKER_ADDR, &broker_addr);
+  memset(&lladdr, 0x01, sizeof(lladdr));
+  uip_ds6_nbr_add(&broker_addr, &lladdr, 0, NBR_REACHABLE,
+                  NBR_TABLE_REASON_UNDEFINED, NULL);
+  tcpip_set_outputfunc(broker_output);
+
+  while(1) {
+    etimer_set(&et, 1);
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+    while(segment_count > 0 && timer_expired(&segments[segment_head].due)) {
+      send_segment(&segments[segment_head]);
+      segment_head = (segment_head + 1) % NUM_SEGMENTS;
+      segment_count--;
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+static void
+write_payload(struct mqtt_connection *m, void *ptr, uint32_t offset,
+              uint8_t *chunk, uint16_t chunk_length)
+{
+  uint16_t i;
+
+  for(i = 0; i < chunk_length; i++) {
+    chunk[i] = pattern(offset + i);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+echo_chunk(struct mqtt_message *msg)
+{
+  uint16_t i;
+
+  for(i = 0; i < msg->payload_chunk_length; i++) {
+    if(msg->payload_chunk[i] != pattern(echo_received + i)) {
+      echo_errors++;
+    }
+  }
+  echo_received += msg->payload_chunk_length;
+  echo_chunks++;
+  echo_largest_chunk = MAX(echo_largest_chunk, msg->payload_chunk_length);
+  if(msg->payload_left == 0) {
+    echo_done = 1;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+mqtt_event(struct mqtt_connection *m, mqtt_event_t event, void *data)
+{
+  if(event == MQTT_EVENT_PUBACK || event == MQTT_EVENT_PUBCOMP) {
+    completed++;
+  } else if(event == MQTT_EVENT_PUBLISH) {
+    echo_chunk(data);
+  } else if(event == MQTT_EVENT_DISCONNECTED) {
+    printf("disconnected\n");
+    exit(1);
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(mqtt_publish_bench_process, ev, data)
+{
+  static struct etimer et;
+  static mqtt_qos_level_t qos;
+  static clock_time_t start;
+  static clock_time_t elapsed;
+  static uint8_t stream;
+  static uint8_t echo;
+
+  PROCESS_BEGIN();
+
+  mqtt_register(&conn, &mqtt_publish_bench_process, "bench", mqtt_event,
+                MQTT_TCP_OUTPUT_BUFF_SIZE);
+  conn.auto_reconnect = 0;
+  mqtt_connect(&conn, BROKER_ADDR, BROKER_PORT, 60);
+  etimer_set(&et, CLOCK_SECOND * 5);
+  PROCESS_WAIT_EVENT_UNTIL(mqtt_connected(&conn) || etimer_expired(&et));
+  if(!mqtt_connected(&conn)) {
+    printf("could not connect to the broker\n");
+    exit(1);
+  }
+
+  printf("QoS, publishes/s (inflight window %d, RTT %lu ms)\n",
+         MQTT_INFLIGHT_WINDOW,
+         (unsigned long)(ROUND_TRIP_TIME * 1000 / CLOCK_SECOND));
+  for(stream = 0; stream <= 1; stream++) {
+    if(stream) {
+      printf("QoS, %u byte streamed publishes/s\n", STREAM_PAYLOAD_LEN);
+    }
+    for(qos = MQTT_QOS_LEVEL_0; qos <= MQTT_QOS_LEVEL_2; qos++) {
+      completed = 0;
+      start = clock_time();
+      etimer_set(&et, MEASUREMENT_DURATION);
+      while(!etimer_expired(&et)) {
+        while(mqtt_ready(&conn)) {
+          if(stream) {
+            mqtt_publish_stream(&conn, NULL, STREAM_TOPIC, STREAM_PAYLOAD_LEN,
+                                write_payload, NULL, qos, MQTT_RETAIN_OFF);
+          } else {
+            mqtt_publish(&conn, NULL, TOPIC, payload, sizeof(payload), qos,
+                         MQTT_RETAIN_OFF);
+          }
+          if(qos == MQTT_QOS_LEVEL_0) {
+            completed++;
+          }
+        }
+        PROCESS_WAIT_EVENT();
+      }
+
+      /* Let the last publishes complete before the next QoS level */
+      while(conn.inflight_used > 0 || !conn.out_buffer_sent) {
+        etimer_set(&et, 1);
+        PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+      }
+      elapsed = clock_time() - start;
+      printf("%d, %lu\n", qos, completed * CLOCK_SECOND / elapsed);
+    }
+  }
+
+  for(echo = 0; echo < 2; echo++) {
+    echo_length = echo ? ECHO_LARGE_LEN : ECHO_SMALL_LEN;
+    echo_received = 0;
+    echo_chunks = 0;
+    echo_largest_chunk = 0;
+    echo_errors = 0;
+    echo_done = 0;
+    mqtt_publish(&conn, NULL, ECHO_TOPIC, payload, 1, MQTT_QOS_LEVEL_0,
+                 MQTT_RETAIN_OFF);
+    etimer_set(&et, CLOCK_SECOND * 5);
+    while(!echo_done && !etimer_expired(&et)) {
+      PROCESS_WAIT_EVENT();
+    }
+    printf("Received %lu of %u bytes in %u chunks of at most %u bytes, "
+           "%u wrong\n", (unsigned long)echo_received, echo_length,
+           echo_chunks, echo_largest_chunk, echo_errors);
+  }
+  printf("struct mqtt_connection: %u bytes\n",
+         (unsigned)sizeof(struct mqtt_connection));
+
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2026, Hasso-Plattner-Institut.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Measures nbr_table_get_from_lladdr() throughput against the
+ *         number of neighbors. Each table size is measured both through
+ *         nbr_table_get_from_lladdr() and through a linear scan of the
+ *         table, which is what nbr_table_get_from_lladdr() does when
+ *         NBR_TABLE_CONF_WITH_HASH_INDEX is disabled. Finally, the table
+ *         is overfilled to exercise eviction.
+ */
+
+#include "contiki.h"
+#include "net/nbr-table.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MEASUREMENT_DURATION (CLOCK_SECOND / 4)
+#define BATCH_SIZE 64
+
+struct bench_nbr {
+  uint16_t id;
+};
+
+NBR_TABLE(struct bench_nbr, bench_nbrs);
+
+static const int table_sizes[] = { 8, 16, 32, 64, 100, 128 };
+
+PROCESS(nbr_table_bench_process, "Neighbor table benchmark");
+AUTOSTART_PROCESSES(&nbr_table_bench_process);
+/*---------------------------------------------------------------------------*/
+static void
+make_lladdr(linkaddr_t *addr, uint16_t id)
+{
+  memset(addr, 0, sizeof(linkaddr_t));
+  addr->u8[0] = 0x02;
+  addr->u8[LINKADDR_SIZE - 2] = id >> 8;
+  addr->u8[LINKADDR_SIZE - 1] = id & 0xff;
+}
+/*---------------------------------------------------------------------------*/
+static struct bench_nbr *
+linear_lookup(const linkaddr_t *addr)
+{
+  struct bench_nbr *n;
+
+  for(n = nbr_table_head(bench_nbrs);
+      n != NULL;
+      n = nbr_table_next(bench_nbrs, n)) {
+    if(linkaddr_cmp(addr, nbr_table_get_lladdr(bench_nbrs, n))) {
+      return n;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static struct bench_nbr *
+table_lookup(const linkaddr_t *addr)
+{
+  return nbr_table_get_from_lladdr(bench_nbrs, addr);
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+measure(struct bench_nbr *(*lookup)(const linkaddr_t *), int first, int size)
+{
+  linkaddr_t addr;
+  struct bench_nbr *n;
+  unsigned long lookups;
+  clock_time_t start;
+  clock_time_t elapsed;
+  uint16_t id;
+  int i;
+
+  lookups = 0;
+  start = clock_time();
+  do {
+    for(i = 0; i < BATCH_SIZE; i++) {
+      id = first + rand() % size;
+      make_lladdr(&addr, id);
+      n = lookup(&addr);
+      if(n == NULL || n->id != id) {
+        printf("lookup of %u failed\n", id);
+        exit(1);
+      }
+    }
+    lookups += BATCH_SIZE;
+    elapsed = clock_time() - start;
+  } while(elapsed < MEASUREMENT_DURATION);
+
+  return lookups * CLOCK_SECOND / elapsed;
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_neighbor(uint16_t id)
+{
+  linkaddr_t addr;
+  struct bench_nbr *n;
+
+  make_lladdr(&addr, id);
+  n = nbr_table_add_lladdr(bench_nbrs, &addr,
+                           NBR_TABLE_REASON_UNDEFINED, NULL);
+  if(n == NULL) {
+    printf("could not add neighbor %u\n", id);
+    exit(1);
+  }
+  n->id = id;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(nbr_table_bench_process, ev, data)
+{
+  int added;
+  int s;
+
+  PROCESS_BEGIN();
+
+  nbr_table_register(bench_nbrs, NULL);
+
+  printf("neighbors, table lookups/s, linear lookups/s (hash index %s)\n",
+         NBR_TABLE_WITH_HASH_INDEX ? "enabled" : "disabled");
+
+  added = 0;
+  for(s = 0; s < sizeof(table_sizes) / sizeof(table_sizes[0]); s++) {
+    for(; added < table_sizes[s]; added++) {
+      add_neighbor(added);
+    }
+    printf("%d, %lu, %lu\n", added,
+           measure(table_lookup, 0, added),
+           measure(linear_lookup, 0, added));
+  }
+
+  /* Replace every neighbor through eviction and check that only the
+     new ones can still be found. */
+  for(; added < 2 * NBR_TABLE_MAX_NEIGHBORS; added++) {
+    add_neighbor(added);
+  }
+  printf("after eviction: %lu lookups/s\n",
+         measure(table_lookup, NBR_TABLE_MAX_NEIGHBORS,
+                 NBR_TABLE_MAX_NEIGHBORS));
+  {
+    linkaddr_t addr;
+    int i;
+    for(i = 0; i < NBR_TABLE_MAX_NEIGHBORS; i++) {
+      make_lladdr(&addr, i);
+      if(nbr_table_get_from_lladdr(bench_nbrs, &addr) != NULL) {
+        printf("evicted neighbor %d still found\n", i);
+        exit(1);
+      }
+    }
+  }
+
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
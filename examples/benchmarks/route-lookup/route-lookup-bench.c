@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2026, Hasso-Plattner-Institut.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Measures uip_ds6_route_lookup() throughput against the size of
+ *         the routing table. Each table size is measured both through
+ *         uip_ds6_route_lookup() and through a linear scan of the route
+ *         list, which is what uip_ds6_route_lookup() does when
+ *         UIP_DS6_ROUTE_CONF_INDEX is disabled.
+ */
+
+#include "contiki.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/ipv6/uip-ds6-route.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NUM_NEXTHOPS 8
+#define MEASUREMENT_DURATION (CLOCK_SECOND / 4)
+#define BATCH_SIZE 64
+
+static const int table_sizes[] = { 8, 32, 128, 256, 512 };
+
+PROCESS(route_lookup_bench_process, "Route lookup benchmark");
+AUTOSTART_PROCESSES(&route_lookup_bench_process);
+/*---------------------------------------------------------------------------*/
+static void
+make_destination(uip_ipaddr_t *addr, uint16_t prefix, int i)
+{
+  uip_ip6addr(addr, prefix, 0, 0, 0, 0x0212, 0x7400, i >> 8, i & 0xff);
+}
+/*---------------------------------------------------------------------------*/
+static uip_ds6_route_t *
+linear_lookup(uip_ipaddr_t *addr)
+{
+  uip_ds6_route_t *r;
+  uip_ds6_route_t *found_route;
+  uint8_t longestmatch;
+
+  found_route = NULL;
+  longestmatch = 0;
+  for(r = uip_ds6_route_head(); r != NULL; r = uip_ds6_route_next(r)) {
+    if(r->length >= longestmatch &&
+       uip_ipaddr_prefixcmp(addr, &r->ipaddr, r->length)) {
+      longestmatch = r->length;
+      found_route = r;
+      if(longestmatch == 128) {
+        break;
+      }
+    }
+  }
+  return found_route;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+measure(uip_ds6_route_t *(*lookup)(uip_ipaddr_t *), int size)
+{
+  uip_ipaddr_t addr;
+  unsigned long lookups;
+  clock_time_t start;
+  clock_time_t elapsed;
+  int i;
+
+  lookups = 0;
+  start = clock_time();
+  do {
+    for(i = 0; i < BATCH_SIZE; i++) {
+      /* One in eight lookups misses the host routes and only matches
+         the /64 prefix route. */
+      if(i & 7) {
+        make_destination(&addr, 0xfd00, rand() % size);
+      } else {
+        make_destination(&addr, 0xfd01, i);
+      }
+      if(lookup(&addr) == NULL) {
+        printf("lookup failed\n");
+        return 0;
+      }
+    }
+    lookups += BATCH_SIZE;
+    elapsed = clock_time() - start;
+  } while(elapsed < MEASUREMENT_DURATION);
+
+  return lookups * CLOCK_SECOND / elapsed;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(route_lookup_bench_process, ev, data)
+{
+  static uip_ipaddr_t nexthops[NUM_NEXTHOPS];
+  uip_lladdr_t lladdr;
+  uip_ipaddr_t prefix;
+  uip_ipaddr_t dest;
+  int added;
+  int s;
+  int i;
+
+  PROCESS_BEGIN();
+
+  for(i = 0; i < NUM_NEXTHOPS; i++) {
+    memset(&lladdr, 0, sizeof(lladdr));
+    lladdr.addr[0] = 0x02;
+    lladdr.addr[sizeof(lladdr.addr) - 1] = i + 1;
+    uip_ip6addr(&nexthops[i], 0xfe80, 0, 0, 0, 0, 0, 0, i + 1);
+    uip_ds6_set_addr_iid(&nexthops[i], &lladdr);
+    uip_ds6_nbr_add(&nexthops[i], &lladdr, 1, NBR_REACHABLE,
+                    NBR_TABLE_REASON_UNDEFINED, NULL);
+  }
+
+  uip_ip6addr(&prefix, 0xfd01, 0, 0, 0, 0, 0, 0, 0);
+  uip_ds6_route_add(&prefix, 64, &nexthops[0]);
+
+  printf("routes, indexed lookups/s, linear lookups/s (index %s)\n",
+         UIP_DS6_ROUTE_INDEX ? "enabled" : "disabled");
+
+  added = 0;
+  for(s = 0; s < sizeof(table_sizes) / sizeof(table_sizes[0]); s++) {
+    /* One of the entries is the /64 prefix route. */
+    for(; added < table_sizes[s] - 1; added++) {
+      make_destination(&dest, 0xfd00, added);
+      if(uip_ds6_route_add(&dest, 128,
+                           &nexthops[added % NUM_NEXTHOPS]) == NULL) {
+        printf("could not add route %d\n", added);
+        exit(1);
+      }
+    }
+    printf("%d, %lu, %lu\n", uip_ds6_route_num_routes(),
+           measure(uip_ds6_route_lookup, added),
+           measure(linear_lookup, added));
+  }
+
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
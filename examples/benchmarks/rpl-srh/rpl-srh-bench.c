@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2026, Hasso-Plattner-Institut.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Measures how many downward packets per second a non-storing
+ *         RPL root gets its source routing header inserted, against the
+ *         number of nodes in the DODAG. Each node has 3 children and
+ *         the packets go either to all nodes in turn, except for the
+ *         children of the root, which need no source routing header, or
+ *         to the HOT_NODES deepest nodes only.
+ */
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/rpl/rpl.h"
+#include "net/rpl/rpl-private.h"
+#include "net/rpl/rpl-ns.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MEASUREMENT_DURATION (CLOCK_SECOND / 4)
+#define CHILDREN_PER_NODE 3
+#define PAYLOAD_LEN 20
+#define FIRST_NODE (CHILDREN_PER_NODE + 1)
+#define HOT_NODES 32
+
+#define UIP_IP_BUF ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+
+static const int network_sizes[] = { 50, 100, 200, 400 };
+
+PROCESS(rpl_srh_bench_process, "RPL SRH benchmark");
+AUTOSTART_PROCESSES(&rpl_srh_bench_process);
+/*---------------------------------------------------------------------------*/
+/* Node 0 is the root */
+static void
+set_node_addr(uip_ipaddr_t *addr, int node)
+{
+  uip_ip6addr(addr, UIP_DS6_DEFAULT_PREFIX, 0, 0, 0, 0, 0, node >> 8, node + 1);
+}
+/*---------------------------------------------------------------------------*/
+static int
+send_down(int node)
+{
+  memset(UIP_IP_BUF, 0, UIP_IPH_LEN);
+  UIP_IP_BUF->vtc = 0x60;
+  UIP_IP_BUF->len[1] = PAYLOAD_LEN;
+  UIP_IP_BUF->proto = UIP_PROTO_UDP;
+  UIP_IP_BUF->ttl = 64;
+  set_node_addr(&UIP_IP_BUF->srcipaddr, 0);
+  set_node_addr(&UIP_IP_BUF->destipaddr, node);
+  uip_len = UIP_IPH_LEN + PAYLOAD_LEN;
+  uip_ext_len = 0;
+  return rpl_update_header() && UIP_IP_BUF->proto == UIP_PROTO_ROUTING;
+}
+/*---------------------------------------------------------------------------*/
+/* Returns packets per second to the nodes first to last - 1 */
+static unsigned long
+measure(int first, int last)
+{
+  unsigned long count;
+  clock_time_t start;
+  clock_time_t elapsed;
+  int node;
+
+  count = 0;
+  node = first;
+  start = clock_time();
+  do {
+    if(!send_down(node)) {
+      printf("no source routing header towards node %d\n", node);
+      exit(1);
+    }
+    if(++node == last) {
+      node = first;
+    }
+    count++;
+    elapsed = clock_time() - start;
+  } while(elapsed < MEASUREMENT_DURATION);
+  return count * CLOCK_SECOND / elapsed;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(rpl_srh_bench_process, ev, data)
+{
+  uip_ipaddr_t root_addr;
+  uip_ipaddr_t child;
+  uip_ipaddr_t parent;
+  uip_ipaddr_t prefix;
+  unsigned long all;
+  unsigned long hot;
+  rpl_dag_t *dag;
+  int nodes;
+  int s;
+
+  PROCESS_BEGIN();
+
+  set_node_addr(&root_addr, 0);
+  uip_ds6_addr_add(&root_addr, 0, ADDR_MANUAL);
+  dag = rpl_set_root(RPL_DEFAULT_INSTANCE, &root_addr);
+  uip_ip6addr(&prefix, UIP_DS6_DEFAULT_PREFIX, 0, 0, 0, 0, 0, 0, 0);
+  rpl_set_prefix(dag, &prefix, 64);
+
+  printf("nodes, packets/s to all nodes, packets/s to %d nodes (hash index %d, SRH cache %d)\n",
+         HOT_NODES,
+         RPL_NS_CONF_WITH_HASH_INDEX, RPL_NS_CONF_SRH_CACHE_SIZE);
+  nodes = 1;
+  for(s = 0; s < sizeof(network_sizes) / sizeof(network_sizes[0]); s++) {
+    /* Grow the DODAG breadth first */
+    for(; nodes <= network_sizes[s]; nodes++) {
+      set_node_addr(&child, nodes);
+      set_node_addr(&parent, (nodes - 1) / CHILDREN_PER_NODE);
+      if(!rpl_ns_update_node(dag, &child, &parent, 0xffffffff)) {
+        printf("could not add node %d\n", nodes);
+        exit(1);
+      }
+    }
+
+    all = measure(FIRST_NODE, nodes);
+    hot = measure(nodes - HOT_NODES, nodes);
+    printf("%d, %lu, %lu\n", network_sizes[s], all, hot);
+  }
+
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
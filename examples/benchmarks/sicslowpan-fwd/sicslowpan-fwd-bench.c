@@ -0,0 +1,353 @@
+/*
+ * Copyright (c) 2026, Hasso-Plattner-Institut.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Measures how long a 6LoWPAN router holds on to the fragments of
+ *         1 KB packets it routes on, with and without
+ *         SICSLOWPAN_CONF_FRAG_FORWARDING. Children send fragmented UDP
+ *         packets to a host behind the router's default route; the frames
+ *         the router sends are captured and checked against the packets.
+ *
+ *         The latency over several hops follows from the frames a router
+ *         still has to send once the last fragment has arrived: every hop
+ *         after the first adds that many frame times.
+ *
+ *         Last, the router joins a RPL DODAG below the root and the
+ *         children send packets with a RPL hop-by-hop option, each
+ *         fragment after the first one twice.
+ */
+
+#include "contiki.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+#include "net/ip/uip.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/ipv6/sicslowpan.h"
+#include "net/llsec/llsec.h"
+#include "net/mac/mac.h"
+#if UIP_CONF_IPV6_RPL
+#include "net/rpl/rpl-private.h"
+#endif /* UIP_CONF_IPV6_RPL */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_CHILDREN 4
+#define NUM_PACKETS 16
+#define NUM_HOPS 5
+
+/* 1 KB of UDP payload, sent in fragments of 96 bytes */
+#define PACKET_LEN (UIP_IPUDPH_LEN + 1024)
+#define FRAGMENT_LEN 96
+#define NUM_FRAGMENTS ((PACKET_LEN + FRAGMENT_LEN - 1) / FRAGMENT_LEN)
+
+static uint8_t packet[PACKET_LEN];
+static linkaddr_t parent_lladdr;
+
+/* Packets carry a RPL hop-by-hop option with this sender rank */
+static uint8_t with_hbh;
+static uint16_t hbh_rank;
+
+/* What the router sent, rebuilt per child */
+static uint8_t sent_packet[NUM_CHILDREN][PACKET_LEN];
+static uint16_t sent_len[NUM_CHILDREN];
+static uint16_t sent_tags[NUM_CHILDREN];
+static unsigned long frames_sent;
+static unsigned long bad_frames;
+
+PROCESS(sicslowpan_fwd_bench_process, "Sicslowpan forwarding benchmark");
+AUTOSTART_PROCESSES(&sicslowpan_fwd_bench_process);
+/*---------------------------------------------------------------------------*/
+static void
+capture_init(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+static void
+capture_send(mac_callback_t sent, void *ptr)
+{
+  uint8_t *frame = packetbuf_dataptr();
+  uint16_t tag = (frame[2] << 8) | frame[3];
+  uint16_t offset;
+  uint8_t *data;
+  int len;
+  int child;
+
+  frames_sent++;
+  if(!linkaddr_cmp(packetbuf_addr(PACKETBUF_ADDR_RECEIVER), &parent_lladdr)) {
+    bad_frames++;
+  } else if((frame[0] & 0xf8) == SICSLOWPAN_DISPATCH_FRAG1 &&
+            frame[SICSLOWPAN_FRAG1_HDR_LEN] == SICSLOWPAN_DISPATCH_IPV6) {
+    data = frame + SICSLOWPAN_FRAG1_HDR_LEN + SICSLOWPAN_IPV6_HDR_LEN;
+    len = packetbuf_datalen() - SICSLOWPAN_FRAG1_HDR_LEN - SICSLOWPAN_IPV6_HDR_LEN;
+    child = data[23] - 1;
+    sent_tags[child] = tag;
+    memcpy(sent_packet[child], data, len);
+    sent_len[child] += len;
+  } else if((frame[0] & 0xf8) == SICSLOWPAN_DISPATCH_FRAGN) {
+    offset = frame[4] * 8;
+    len = packetbuf_datalen() - SICSLOWPAN_FRAGN_HDR_LEN;
+    for(child = 0; child < NUM_CHILDREN && sent_tags[child] != tag; child++);
+    if(child == NUM_CHILDREN || offset + len > PACKET_LEN) {
+      bad_frames++;
+    } else {
+      memcpy(sent_packet[child] + offset, frame + SICSLOWPAN_FRAGN_HDR_LEN, len);
+      sent_len[child] += len;
+    }
+  } else {
+    bad_frames++;
+  }
+
+  mac_call_sent_callback(sent, ptr, MAC_TX_OK, 1);
+}
+/*---------------------------------------------------------------------------*/
+static void
+capture_input(void)
+{
+  NETSTACK_NETWORK.input();
+}
+/*---------------------------------------------------------------------------*/
+const struct llsec_driver capture_llsec_driver = {
+  "capture",
+  capture_init,
+  capture_send,
+  capture_input
+};
+/*---------------------------------------------------------------------------*/
+static void
+make_packet(int child, uint16_t seqno)
+{
+  int udp = with_hbh ? UIP_IPH_LEN + 8 : UIP_IPH_LEN;
+  int i;
+
+  memset(packet, 0, udp + UIP_UDPH_LEN);
+  packet[0] = 0x60;
+  packet[4] = (PACKET_LEN - UIP_IPH_LEN) >> 8;
+  packet[5] = (PACKET_LEN - UIP_IPH_LEN) & 0xff;
+  packet[6] = UIP_PROTO_UDP;
+  packet[7] = 64;
+  packet[8] = 0xfd;
+  packet[23] = child + 1;
+  packet[24] = 0xfd;
+  packet[25] = 0x01;
+  packet[39] = 0x99;
+#if UIP_CONF_IPV6_RPL
+  if(with_hbh) {
+    packet[6] = UIP_PROTO_HBHO;
+    packet[UIP_IPH_LEN] = UIP_PROTO_UDP;
+    packet[UIP_IPH_LEN + 2] = UIP_EXT_HDR_OPT_RPL;
+    packet[UIP_IPH_LEN + 3] = RPL_HDR_OPT_LEN;
+    packet[UIP_IPH_LEN + 5] = RPL_DEFAULT_INSTANCE;
+    packet[UIP_IPH_LEN + 6] = hbh_rank >> 8;
+    packet[UIP_IPH_LEN + 7] = hbh_rank & 0xff;
+  }
+#endif /* UIP_CONF_IPV6_RPL */
+  packet[udp + 2] = 0x16;
+  packet[udp + 3] = 0x33;
+  packet[udp + 4] = (PACKET_LEN - udp) >> 8;
+  packet[udp + 5] = (PACKET_LEN - udp) & 0xff;
+  for(i = udp + UIP_UDPH_LEN; i < PACKET_LEN; i++) {
+    packet[i] = (child * 7 + seqno * 13 + i) & 0xff;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_fragment(int child, uint16_t seqno, int n)
+{
+  linkaddr_t sender;
+  uint8_t *ptr;
+  int offset;
+  int len;
+
+  make_packet(child, seqno);
+
+  packetbuf_clear();
+  ptr = packetbuf_dataptr();
+  ptr[1] = PACKET_LEN & 0xff;
+  ptr[2] = seqno >> 8;
+  ptr[3] = seqno & 0xff;
+  if(n == 0) {
+    ptr[0] = SICSLOWPAN_DISPATCH_FRAG1 | (PACKET_LEN >> 8);
+    ptr[SICSLOWPAN_FRAG1_HDR_LEN] = SICSLOWPAN_DISPATCH_IPV6;
+    memcpy(ptr + SICSLOWPAN_FRAG1_HDR_LEN + SICSLOWPAN_IPV6_HDR_LEN,
+           packet, FRAGMENT_LEN);
+    packetbuf_set_datalen(SICSLOWPAN_FRAG1_HDR_LEN + SICSLOWPAN_IPV6_HDR_LEN +
+                          FRAGMENT_LEN);
+  } else {
+    offset = n * FRAGMENT_LEN;
+    len = PACKET_LEN - offset < FRAGMENT_LEN ? PACKET_LEN - offset : FRAGMENT_LEN;
+    ptr[0] = SICSLOWPAN_DISPATCH_FRAGN | (PACKET_LEN >> 8);
+    ptr[4] = offset / 8;
+    memcpy(ptr + SICSLOWPAN_FRAGN_HDR_LEN, packet + offset, len);
+    packetbuf_set_datalen(SICSLOWPAN_FRAGN_HDR_LEN + len);
+  }
+
+  memset(&sender, 0, sizeof(sender));
+  sender.u8[0] = 0x02;
+  sender.u8[LINKADDR_SIZE - 1] = child + 1;
+  packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &sender);
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &linkaddr_node_addr);
+
+  NETSTACK_LLSEC.input();
+}
+/*---------------------------------------------------------------------------*/
+/* Returns 1 if the router sent exactly the packet it received, with its
+   hop limit decremented and its own rank in the RPL option */
+static int
+check_sent(int child, uint16_t seqno)
+{
+  make_packet(child, seqno);
+  packet[7]--;
+#if UIP_CONF_IPV6_RPL
+  if(with_hbh) {
+    packet[UIP_IPH_LEN + 6] = rpl_get_any_dag()->rank >> 8;
+    packet[UIP_IPH_LEN + 7] = rpl_get_any_dag()->rank & 0xff;
+  }
+#endif /* UIP_CONF_IPV6_RPL */
+  return sent_len[child] == PACKET_LEN &&
+    memcmp(sent_packet[child], packet, PACKET_LEN) == 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+reset_sent(void)
+{
+  memset(sent_len, 0, sizeof(sent_len));
+  memset(sent_tags, 0xff, sizeof(sent_tags));
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(sicslowpan_fwd_bench_process, ev, data)
+{
+  static uip_ipaddr_t parent;
+  static unsigned long after_last;
+  static unsigned long forwarded;
+  static uint16_t seqno;
+#if UIP_CONF_IPV6_RPL
+  static uip_ipaddr_t dag_id;
+  rpl_dag_t *dag;
+#endif /* UIP_CONF_IPV6_RPL */
+  unsigned long frames;
+  int child;
+  int n;
+
+  PROCESS_BEGIN();
+
+  memset(&parent_lladdr, 0, sizeof(parent_lladdr));
+  parent_lladdr.u8[0] = 0x02;
+  parent_lladdr.u8[LINKADDR_SIZE - 1] = 0xaa;
+  uip_ip6addr(&parent, 0xfe80, 0, 0, 0, 0, 0, 0, 0);
+  uip_ds6_set_addr_iid(&parent, (uip_lladdr_t *)&parent_lladdr);
+  uip_ds6_nbr_add(&parent, (uip_lladdr_t *)&parent_lladdr, 1, NBR_REACHABLE,
+                  NBR_TABLE_REASON_UNDEFINED, NULL);
+  uip_ds6_defrt_add(&parent, 0);
+
+  printf("%d-byte packets in %d fragments, fragment forwarding %s\n",
+         PACKET_LEN, NUM_FRAGMENTS,
+         SICSLOWPAN_CONF_FRAG_FORWARDING ? "enabled" : "disabled");
+
+  /* One packet at a time */
+  forwarded = 0;
+  after_last = 0;
+  for(seqno = 0; seqno < NUM_PACKETS; seqno++) {
+    reset_sent();
+    for(n = 0; n < NUM_FRAGMENTS; n++) {
+      frames = frames_sent;
+      send_fragment(0, seqno, n);
+      if(n == NUM_FRAGMENTS - 1) {
+        after_last += frames_sent - frames;
+      }
+    }
+    forwarded += check_sent(0, seqno);
+  }
+  printf("%d packets one at a time: %lu forwarded intact, %lu bad frames\n",
+         NUM_PACKETS, forwarded, bad_frames);
+  printf("  frames sent after the last fragment arrived: %lu.%02lu\n",
+         after_last / NUM_PACKETS, after_last * 100 / NUM_PACKETS % 100);
+  printf("  %d-hop latency: %lu.%02lu frame times\n", NUM_HOPS,
+         (NUM_FRAGMENTS * NUM_PACKETS + (NUM_HOPS - 1) * after_last) / NUM_PACKETS,
+         (NUM_FRAGMENTS * NUM_PACKETS + (NUM_HOPS - 1) * after_last) * 100 /
+         NUM_PACKETS % 100);
+
+  /* All children at once, one fragment of each in turn */
+  forwarded = 0;
+  for(; seqno < 2 * NUM_PACKETS; seqno++) {
+    reset_sent();
+    for(n = 0; n < NUM_FRAGMENTS; n++) {
+      for(child = 0; child < NUM_CHILDREN; child++) {
+        send_fragment(child, seqno, n);
+      }
+    }
+    for(child = 0; child < NUM_CHILDREN; child++) {
+      forwarded += check_sent(child, seqno);
+    }
+  }
+  printf("%d packets from %d children at once: %lu forwarded intact, "
+         "%lu bad frames\n", NUM_PACKETS * NUM_CHILDREN, NUM_CHILDREN,
+         forwarded, bad_frames);
+
+#if UIP_CONF_IPV6_RPL
+  /* Join a DODAG two hops below the root, the children are below us */
+  uip_ip6addr(&dag_id, 0xfd00, 0, 0, 0, 0, 0, 0, 1);
+  dag = rpl_set_root(RPL_DEFAULT_INSTANCE, &dag_id);
+  dag->rank = 3 * ROOT_RANK(dag->instance);
+  hbh_rank = 4 * ROOT_RANK(dag->instance);
+  with_hbh = 1;
+
+  /* All children at once with RPL options and duplicate fragments */
+  forwarded = 0;
+  sicslowpan_reass_stats.duplicates = 0;
+  for(; seqno < 3 * NUM_PACKETS; seqno++) {
+    reset_sent();
+    for(n = 0; n < NUM_FRAGMENTS; n++) {
+      for(child = 0; child < NUM_CHILDREN; child++) {
+        send_fragment(child, seqno, n);
+        if(n > 0) {
+          send_fragment(child, seqno, n);
+        }
+      }
+    }
+    for(child = 0; child < NUM_CHILDREN; child++) {
+      forwarded += check_sent(child, seqno);
+    }
+  }
+  printf("%d packets with a RPL option and duplicate fragments: "
+         "%lu forwarded intact, %lu bad frames, %lu duplicates dropped\n",
+         NUM_PACKETS * NUM_CHILDREN, forwarded, bad_frames,
+         sicslowpan_reass_stats.duplicates);
+#endif /* UIP_CONF_IPV6_RPL */
+
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
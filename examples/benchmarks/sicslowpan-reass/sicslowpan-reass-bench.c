@@ -0,0 +1,279 @@
+/*
+ * Copyright (c) 2026, Hasso-Plattner-Institut.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Feeds interleaved 6LoWPAN fragments from many children into
+ *         sicslowpan, as a border router receives them, and checks the
+ *         reassembled packets. Some fragments arrive twice, some before
+ *         the first fragment of their packet and some are lost, so that
+ *         every reassembly counter is exercised.
+ */
+
+#include "contiki.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+#include "net/ip/uip.h"
+#include "net/ipv6/sicslowpan.h"
+#include "net/rime/rime.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_CHILDREN 24
+#define CHECKED_ROUNDS 8
+#define TIMED_ROUNDS 1000
+
+/* 400-byte packets: the first fragment carries the IPv6 header and 56
+   bytes of payload, then three fragments of 96 bytes and one of 16 */
+#define PACKET_LEN 400
+#define FRAGMENT_LEN 96
+#define NUM_FRAGMENTS ((PACKET_LEN + FRAGMENT_LEN - 1) / FRAGMENT_LEN)
+
+/* The packets are sent to a bound port so that uIP drops them quietly */
+#define UDP_PORT 5678
+#define PAYLOAD_START (UIP_IPH_LEN + UIP_UDPH_LEN)
+
+static uint8_t packet[PACKET_LEN];
+static unsigned long delivered;
+static unsigned long corrupted;
+
+PROCESS(sicslowpan_reass_bench_process, "Sicslowpan reassembly benchmark");
+PROCESS(udp_sink_process, "UDP sink");
+AUTOSTART_PROCESSES(&udp_sink_process, &sicslowpan_reass_bench_process);
+/*---------------------------------------------------------------------------*/
+static uint8_t
+payload_byte(int child, uint16_t tag, int i)
+{
+  return (child * 7 + tag * 13 + i) & 0xff;
+}
+/*---------------------------------------------------------------------------*/
+static void
+make_packet(int child, uint16_t tag)
+{
+  int i;
+
+  memset(packet, 0, UIP_IPH_LEN);
+  packet[0] = 0x60;
+  packet[4] = (PACKET_LEN - UIP_IPH_LEN) >> 8;
+  packet[5] = (PACKET_LEN - UIP_IPH_LEN) & 0xff;
+  packet[6] = UIP_PROTO_UDP;
+  packet[7] = 64;
+  packet[8] = 0xfe;
+  packet[9] = 0x80;
+  packet[23] = child + 1;
+  packet[24] = 0xff;
+  packet[25] = 0x02;
+  packet[39] = 0x01;
+  memset(packet + UIP_IPH_LEN, 0, UIP_UDPH_LEN);
+  packet[UIP_IPH_LEN + 2] = UDP_PORT >> 8;
+  packet[UIP_IPH_LEN + 3] = UDP_PORT & 0xff;
+  packet[UIP_IPH_LEN + 4] = packet[4];
+  packet[UIP_IPH_LEN + 5] = packet[5];
+  for(i = PAYLOAD_START; i < PACKET_LEN; i++) {
+    packet[i] = payload_byte(child, tag, i);
+  }
+  /* Lets the receive callback tell which packet it got */
+  packet[PAYLOAD_START] = child;
+  packet[PAYLOAD_START + 1] = tag & 0xff;
+  packet[PAYLOAD_START + 2] = tag >> 8;
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_fragment(int child, uint16_t tag, int n)
+{
+  linkaddr_t sender;
+  uint8_t *ptr;
+  int offset;
+  int len;
+
+  packetbuf_clear();
+  ptr = packetbuf_dataptr();
+  ptr[1] = PACKET_LEN & 0xff;
+  ptr[2] = tag >> 8;
+  ptr[3] = tag & 0xff;
+  if(n == 0) {
+    ptr[0] = SICSLOWPAN_DISPATCH_FRAG1 | (PACKET_LEN >> 8);
+    ptr[SICSLOWPAN_FRAG1_HDR_LEN] = SICSLOWPAN_DISPATCH_IPV6;
+    memcpy(ptr + SICSLOWPAN_FRAG1_HDR_LEN + SICSLOWPAN_IPV6_HDR_LEN,
+           packet, FRAGMENT_LEN);
+    packetbuf_set_datalen(SICSLOWPAN_FRAG1_HDR_LEN + SICSLOWPAN_IPV6_HDR_LEN +
+                          FRAGMENT_LEN);
+  } else {
+    offset = n * FRAGMENT_LEN;
+    len = PACKET_LEN - offset < FRAGMENT_LEN ? PACKET_LEN - offset : FRAGMENT_LEN;
+    ptr[0] = SICSLOWPAN_DISPATCH_FRAGN | (PACKET_LEN >> 8);
+    ptr[4] = offset / 8;
+    memcpy(ptr + SICSLOWPAN_FRAGN_HDR_LEN, packet + offset, len);
+    packetbuf_set_datalen(SICSLOWPAN_FRAGN_HDR_LEN + len);
+  }
+
+  memset(&sender, 0, sizeof(sender));
+  sender.u8[0] = 0x02;
+  sender.u8[LINKADDR_SIZE - 1] = child + 1;
+  packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &sender);
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &linkaddr_node_addr);
+
+  NETSTACK_NETWORK.input();
+}
+/*---------------------------------------------------------------------------*/
+static void
+input_callback(void)
+{
+  uint8_t *buf = (uint8_t *)&uip_buf[UIP_LLH_LEN];
+  uint16_t tag;
+  int child;
+  int i;
+
+  child = buf[PAYLOAD_START];
+  tag = buf[PAYLOAD_START + 1] | (buf[PAYLOAD_START + 2] << 8);
+  make_packet(child, tag);
+  if(uip_len != PACKET_LEN || memcmp(buf, packet, PACKET_LEN) != 0) {
+    corrupted++;
+    return;
+  }
+  for(i = PAYLOAD_START + 3; i < PACKET_LEN; i++) {
+    if(buf[i] != payload_byte(child, tag, i)) {
+      corrupted++;
+      return;
+    }
+  }
+  delivered++;
+}
+static void
+output_callback(int mac_status)
+{
+}
+RIME_SNIFFER(sniffer, input_callback, output_callback);
+/*---------------------------------------------------------------------------*/
+/*
+ * Sends one packet from every child, one fragment of each in turn. With
+ * faults set, odd children send their second fragment before their first
+ * one, every fifth fragment is sent twice and one packet in sixteen loses
+ * its third fragment.
+ */
+static void
+send_round(uint16_t round, int faults)
+{
+  int child;
+  int i;
+  int n;
+
+  for(i = 0; i < NUM_FRAGMENTS; i++) {
+    for(child = 0; child < NUM_CHILDREN; child++) {
+      n = i;
+      if(faults && (child & 1) && i < 2) {
+        n = 1 - i;
+      }
+      if(faults && n == 2 && (child + round) % 16 == 0) {
+        continue;
+      }
+      make_packet(child, round);
+      send_fragment(child, round, n);
+      if(faults && (child + i) % 5 == 0) {
+        send_fragment(child, round, n);
+      }
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+print_stats(void)
+{
+  printf("  delivered %lu, corrupted %lu, contexts exhausted %lu, "
+         "buffers exhausted %lu, timeouts %lu, duplicates %lu\n",
+         delivered, corrupted,
+         sicslowpan_reass_stats.contexts_exhausted,
+         sicslowpan_reass_stats.buffers_exhausted,
+         sicslowpan_reass_stats.timeouts,
+         sicslowpan_reass_stats.duplicates);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(sicslowpan_reass_bench_process, ev, data)
+{
+  static struct etimer et;
+  static uint16_t round;
+  clock_time_t start;
+  clock_time_t elapsed;
+
+  PROCESS_BEGIN();
+
+  rime_sniffer_add(&sniffer);
+
+  printf("%d children, %d-byte packets in %d fragments\n",
+         NUM_CHILDREN, PACKET_LEN, NUM_FRAGMENTS);
+
+  for(round = 0; round < CHECKED_ROUNDS; round++) {
+    send_round(round, 1);
+  }
+  printf("%d rounds with reordered, duplicate and lost fragments "
+         "(%d packets):\n", CHECKED_ROUNDS, CHECKED_ROUNDS * NUM_CHILDREN);
+  print_stats();
+
+  /* Let the incomplete packets expire, the next fragment frees them */
+  etimer_set(&et, 2 * CLOCK_SECOND);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+
+  delivered = 0;
+  start = clock_time();
+  for(; round < CHECKED_ROUNDS + TIMED_ROUNDS; round++) {
+    send_round(round, 0);
+  }
+  elapsed = clock_time() - start;
+  printf("%d rounds in order (%d packets), %lu ns per fragment:\n",
+         TIMED_ROUNDS, TIMED_ROUNDS * NUM_CHILDREN,
+         (unsigned long)(elapsed * (1000000000UL / CLOCK_SECOND) /
+                         ((unsigned long)TIMED_ROUNDS * NUM_CHILDREN * NUM_FRAGMENTS)));
+  print_stats();
+
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(udp_sink_process, ev, data)
+{
+  static struct uip_udp_conn *conn;
+
+  PROCESS_BEGIN();
+
+  conn = udp_new(NULL, 0, NULL);
+  udp_bind(conn, UIP_HTONS(UDP_PORT));
+
+  while(1) {
+    PROCESS_WAIT_EVENT();
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,232 @@
+/*
+ * Copyright (c) 2026, Hasso-Plattner-Institut.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Simulates shared slots in which tsch_queue_get_unicast_packet_for_any()
+ *         picks a packet among 24 neighbors we have no Tx link to, the first
+ *         4 of which send RPL control packets. Reports the share of shared
+ *         slots given to control packets and to each data neighbor while all
+ *         queues are kept busy, and the time per shared slot when only the
+ *         last neighbor has packets. Checks the per-neighbor statistics.
+ *         Build with DEFINES=TSCH_QUEUE_CONF_SCHEDULER=0 (first neighbor
+ *         with a packet) or =1 (round robin) to compare with the default
+ *         weighted priority.
+ */
+
+#include "contiki.h"
+#include "net/packetbuf.h"
+#include "net/ip/uip.h"
+#include "net/ipv6/uip-icmp6.h"
+#include "net/mac/tsch/tsch-queue.h"
+#include "net/mac/tsch/tsch-schedule.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NEIGHBORS 24
+#define CONTROL_NEIGHBORS 4
+#define SLOTS 24000UL
+#define MEASUREMENT_DURATION (CLOCK_SECOND / 4)
+#define BATCH_SIZE 64
+
+static linkaddr_t addrs[NEIGHBORS];
+static unsigned long served[NEIGHBORS];
+static struct tsch_link *shared_link;
+
+PROCESS(tsch_queue_bench_process, "TSCH queue benchmark");
+AUTOSTART_PROCESSES(&tsch_queue_bench_process);
+/*---------------------------------------------------------------------------*/
+/* The parts of TSCH used by the queues, without slot operation */
+const linkaddr_t tsch_broadcast_address = { { 0xff, 0xff, 0xff, 0xff,
+                                              0xff, 0xff, 0xff, 0xff } };
+const linkaddr_t tsch_eb_address = { { 0, 0, 0, 0, 0, 0, 0, 0 } };
+struct tsch_link *current_link;
+int tsch_is_coordinator;
+
+int
+tsch_is_locked(void)
+{
+  return 0;
+}
+
+int
+tsch_get_lock(void)
+{
+  return 1;
+}
+
+void
+tsch_release_lock(void)
+{
+}
+
+void
+tsch_set_ka_timeout(uint32_t timeout)
+{
+}
+
+void
+tsch_schedule_keepalive(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+static void
+enqueue(int i)
+{
+  packetbuf_clear();
+  packetbuf_set_datalen(64);
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &addrs[i]);
+  if(i < CONTROL_NEIGHBORS) {
+    packetbuf_set_attr(PACKETBUF_ATTR_NETWORK_ID, UIP_PROTO_ICMP6);
+    packetbuf_set_attr(PACKETBUF_ATTR_CHANNEL, ICMP6_RPL << 8);
+  }
+  if(tsch_queue_add_packet(&addrs[i], NULL, NULL) == NULL) {
+    printf("queueing for neighbor %d failed\n", i);
+    exit(1);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Sends a packet in a shared slot, returns the neighbor or -1 */
+static int
+shared_slot(void)
+{
+  struct tsch_neighbor *n;
+  struct tsch_packet *p;
+  int i;
+
+  p = tsch_queue_get_unicast_packet_for_any(&n, shared_link);
+  if(p == NULL) {
+    return -1;
+  }
+  tsch_queue_remove_packet_from_queue(n);
+  tsch_queue_backoff_reset(n);
+  p->ret = MAC_TX_OK;
+  tsch_queue_free_packet(p);
+  for(i = 0; !linkaddr_cmp(&n->addr, &addrs[i]); i++);
+  return i;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+measure(void)
+{
+  unsigned long ops;
+  clock_time_t start;
+  clock_time_t elapsed;
+  int i;
+
+  ops = 0;
+  start = clock_time();
+  do {
+    for(i = 0; i < BATCH_SIZE; i++) {
+      enqueue(shared_slot());
+    }
+    ops += BATCH_SIZE;
+    elapsed = clock_time() - start;
+  } while(elapsed < MEASUREMENT_DURATION);
+
+  return elapsed * (1000000000UL / CLOCK_SECOND) / ops;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(tsch_queue_bench_process, ev, data)
+{
+  const struct tsch_queue_stats *stats;
+  unsigned long control;
+  unsigned long min, max;
+  unsigned long sent, dropped;
+  unsigned long ns;
+  unsigned long slot;
+  int i;
+
+  PROCESS_BEGIN();
+
+  tsch_queue_init();
+  tsch_schedule_init();
+  shared_link = tsch_schedule_add_link(tsch_schedule_add_slotframe(0, 7),
+                                       LINK_OPTION_RX | LINK_OPTION_TX
+                                       | LINK_OPTION_SHARED,
+                                       LINK_TYPE_NORMAL,
+                                       &tsch_broadcast_address, 0, 0);
+
+  for(i = 0; i < NEIGHBORS; i++) {
+    addrs[i].u8[0] = 1;
+    addrs[i].u8[LINKADDR_SIZE - 1] = i + 1;
+    enqueue(i);
+  }
+
+  /* Keep every queue busy */
+  for(slot = 0; slot < SLOTS; slot++) {
+    i = shared_slot();
+    if(i < 0) {
+      printf("no packet in a shared slot\n");
+      exit(1);
+    }
+    served[i]++;
+    enqueue(i);
+  }
+
+  /* Only the last neighbor has packets */
+  tsch_queue_reset();
+  enqueue(NEIGHBORS - 1);
+  ns = measure();
+
+  control = 0;
+  min = max = served[CONTROL_NEIGHBORS];
+  sent = dropped = 0;
+  for(i = 0; i < NEIGHBORS; i++) {
+    if(i < CONTROL_NEIGHBORS) {
+      control += served[i];
+    } else {
+      min = MIN(min, served[i]);
+      max = MAX(max, served[i]);
+    }
+    stats = tsch_queue_get_stats(&addrs[i]);
+    if(stats != NULL) {
+      sent += stats->sent;
+      dropped += stats->dropped;
+    }
+  }
+  /* Every slot sent one packet, the reset dropped one per neighbor */
+  if(sent < SLOTS || dropped != NEIGHBORS) {
+    printf("statistics: %lu sent, %lu dropped\n", sent, dropped);
+    exit(1);
+  }
+
+  printf("control share (%%)\tmin per data neighbor\tmax per data neighbor"
+         "\tns per shared slot\n");
+  printf("%lu\t%lu\t%lu\t%lu\n", control * 100 / SLOTS, min, max, ns);
+
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
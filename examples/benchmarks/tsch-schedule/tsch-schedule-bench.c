@@ -0,0 +1,279 @@
+/*
+ * Copyright (c) 2026, Hasso-Plattner-Institut.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Measures the time taken by tsch_schedule_get_next_active_link()
+ *         with an Orchestra-like schedule of 63 links in three slotframes,
+ *         as the mean and the worst case over a sample of slots. Checks
+ *         the result for every slot of the first hyperperiods against a
+ *         walk over all links, before and after links are replaced.
+ *         Build with DEFINES=TSCH_SCHEDULE_CONF_WITH_TIMESLOT_INDEX=0 to
+ *         measure the walk over the links lists.
+ */
+
+#include "contiki.h"
+#include "net/mac/tsch/tsch-schedule.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define EB_PERIOD 397
+#define BROADCAST_PERIOD 31
+#define UNICAST_PERIOD 101
+#define NEIGHBORS 61
+#define CHECKED_SLOTS 100000UL
+#define SAMPLED_SLOTS 64
+#define MEASUREMENT_DURATION (CLOCK_SECOND / 50)
+#define BATCH_SIZE 64
+
+static struct tsch_slotframe *slotframes[3];
+
+PROCESS(tsch_schedule_bench_process, "TSCH schedule benchmark");
+AUTOSTART_PROCESSES(&tsch_schedule_bench_process);
+/*---------------------------------------------------------------------------*/
+/* The parts of TSCH used by the schedule, without slot operation */
+const linkaddr_t tsch_broadcast_address = { { 0xff, 0xff, 0xff, 0xff,
+                                              0xff, 0xff, 0xff, 0xff } };
+struct tsch_link *current_link;
+
+int
+tsch_is_locked(void)
+{
+  return 0;
+}
+
+int
+tsch_get_lock(void)
+{
+  return 1;
+}
+
+void
+tsch_release_lock(void)
+{
+}
+
+struct tsch_neighbor *
+tsch_queue_add_nbr(const linkaddr_t *addr)
+{
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_neighbor_link(int neighbor)
+{
+  linkaddr_t addr;
+
+  linkaddr_copy(&addr, &linkaddr_null);
+  addr.u8[LINKADDR_SIZE - 1] = neighbor;
+  /* Receive from the odd neighbors, send to the even ones */
+  tsch_schedule_add_link(slotframes[2],
+                         neighbor & 1 ? LINK_OPTION_RX
+                         : LINK_OPTION_TX | LINK_OPTION_SHARED,
+                         LINK_TYPE_NORMAL, &addr,
+                         neighbor * 37 % UNICAST_PERIOD, 2);
+}
+/*---------------------------------------------------------------------------*/
+static void
+create_schedule(void)
+{
+  int i;
+
+  slotframes[0] = tsch_schedule_add_slotframe(0, EB_PERIOD);
+  slotframes[1] = tsch_schedule_add_slotframe(1, BROADCAST_PERIOD);
+  slotframes[2] = tsch_schedule_add_slotframe(2, UNICAST_PERIOD);
+  tsch_schedule_add_link(slotframes[0], LINK_OPTION_TX,
+                         LINK_TYPE_ADVERTISING_ONLY, &tsch_broadcast_address,
+                         0, 0);
+  tsch_schedule_add_link(slotframes[1],
+                         LINK_OPTION_RX | LINK_OPTION_TX | LINK_OPTION_SHARED,
+                         LINK_TYPE_ADVERTISING, &tsch_broadcast_address,
+                         0, 1);
+  for(i = 1; i <= NEIGHBORS; i++) {
+    add_neighbor_link(i);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* The next active link, found by walking over the links of all slotframes */
+static struct tsch_link *
+reference(struct tsch_asn_t *asn, uint16_t *time_offset,
+          struct tsch_link **backup_link)
+{
+  uint16_t time_to_best = 0;
+  struct tsch_link *best = NULL;
+  struct tsch_link *backup = NULL;
+  struct tsch_link *new_best;
+  struct tsch_link *l;
+  uint16_t timeslot;
+  uint16_t time_to_timeslot;
+  int i;
+
+  for(i = 0; i < 3; i++) {
+    timeslot = TSCH_ASN_MOD(*asn, slotframes[i]->size);
+    for(l = list_head(slotframes[i]->links_list); l != NULL;
+        l = list_item_next(l)) {
+      time_to_timeslot = l->timeslot > timeslot ?
+        l->timeslot - timeslot :
+        slotframes[i]->size.val + l->timeslot - timeslot;
+      if(best == NULL || time_to_timeslot < time_to_best) {
+        time_to_best = time_to_timeslot;
+        best = l;
+        backup = NULL;
+      } else if(time_to_timeslot == time_to_best) {
+        /* Prefer Tx links, then the lowest slotframe handle, and keep
+           the first overlapping Rx link that was not chosen as backup */
+        new_best = NULL;
+        if((best->link_options & LINK_OPTION_TX)
+           == (l->link_options & LINK_OPTION_TX)) {
+          if(l->slotframe_handle < best->slotframe_handle) {
+            new_best = l;
+          }
+        } else if(l->link_options & LINK_OPTION_TX) {
+          new_best = l;
+        }
+        if(backup == NULL) {
+          if(new_best != l && (l->link_options & LINK_OPTION_RX)) {
+            backup = l;
+          }
+          if(new_best != best && (best->link_options & LINK_OPTION_RX)) {
+            backup = best;
+          }
+        }
+        if(new_best != NULL) {
+          best = new_best;
+        }
+      }
+    }
+  }
+  *time_offset = time_to_best;
+  *backup_link = backup;
+  return best;
+}
+/*---------------------------------------------------------------------------*/
+static int
+check(void)
+{
+  struct tsch_asn_t asn;
+  struct tsch_link *link, *backup;
+  struct tsch_link *expected_link, *expected_backup;
+  uint16_t offset, expected_offset;
+  unsigned long i;
+
+  TSCH_ASN_INIT(asn, 0, 0);
+  for(i = 0; i < CHECKED_SLOTS; i++) {
+    link = tsch_schedule_get_next_active_link(&asn, &offset, &backup);
+    expected_link = reference(&asn, &expected_offset, &expected_backup);
+    if(link != expected_link || offset != expected_offset
+       || backup != expected_backup) {
+      printf("wrong link at ASN %lu\n", i);
+      return 0;
+    }
+    TSCH_ASN_INC(asn, 1);
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+measure(struct tsch_asn_t *asn)
+{
+  struct tsch_link *backup;
+  unsigned long ops;
+  clock_time_t start;
+  clock_time_t elapsed;
+  uint16_t offset;
+  int i;
+
+  ops = 0;
+  start = clock_time();
+  do {
+    for(i = 0; i < BATCH_SIZE; i++) {
+      tsch_schedule_get_next_active_link(asn, &offset, &backup);
+    }
+    ops += BATCH_SIZE;
+    elapsed = clock_time() - start;
+  } while(elapsed < MEASUREMENT_DURATION);
+
+  return elapsed * (1000000000UL / CLOCK_SECOND) / ops;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(tsch_schedule_bench_process, ev, data)
+{
+  struct tsch_asn_t asn;
+  unsigned long ns;
+  unsigned long sum;
+  unsigned long max;
+  int i;
+
+  PROCESS_BEGIN();
+
+  tsch_schedule_init();
+  create_schedule();
+  if(!check()) {
+    exit(1);
+  }
+
+  /* Replace the broadcast link and some neighbor links */
+  tsch_schedule_remove_link_by_timeslot(slotframes[1], 0);
+  for(i = 1; i <= NEIGHBORS; i += 3) {
+    tsch_schedule_remove_link_by_timeslot(slotframes[2],
+                                          i * 37 % UNICAST_PERIOD);
+  }
+  tsch_schedule_add_link(slotframes[1],
+                         LINK_OPTION_RX | LINK_OPTION_TX | LINK_OPTION_SHARED,
+                         LINK_TYPE_ADVERTISING, &tsch_broadcast_address,
+                         0, 1);
+  for(i = 1; i <= NEIGHBORS; i += 3) {
+    add_neighbor_link(i);
+  }
+  if(!check()) {
+    exit(1);
+  }
+
+  sum = max = 0;
+  for(i = 0; i < SAMPLED_SLOTS; i++) {
+    TSCH_ASN_INIT(asn, 0, i * 7919UL);
+    ns = measure(&asn);
+    sum += ns;
+    if(ns > max) {
+      max = ns;
+    }
+  }
+
+  printf("links\tmean (ns per slot)\tworst case (ns per slot)\n");
+  printf("%d\t%lu\t%lu\n", NEIGHBORS + 2, sum / SAMPLED_SLOTS, max);
+
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -33,6 +33,10 @@
 
 #define BORDER_ROUTER_FILTER_COAP 1
 
+#ifndef BORDER_ROUTER_FILTER_COAP_PROFILE
+#define BORDER_ROUTER_FILTER_COAP_PROFILE 0 /* Compare the filter cost with coap_parse_message() */
+#endif /* BORDER_ROUTER_FILTER_COAP_PROFILE */
+
 #ifndef WITH_NON_STORING
 #define WITH_NON_STORING 0 /* Set this to run with non-storing mode */
 #endif /* WITH_NON_STORING */
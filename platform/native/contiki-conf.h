@@ -73,6 +73,9 @@ typedef unsigned short uip_stats_t;
 #define UIP_CONF_TCP_SPLIT       0
 #define UIP_CONF_LOGGING         0
 #define UIP_CONF_UDP_CHECKSUMS   1
+#ifndef UIP_CONF_CHKSUM_WIDE
+#define UIP_CONF_CHKSUM_WIDE     1
+#endif /* UIP_CONF_CHKSUM_WIDE */
 
 #ifndef NETSTACK_CONF_RDC_CHANNEL_CHECK_RATE
 #define NETSTACK_CONF_RDC_CHANNEL_CHECK_RATE 8
@@ -595,6 +595,10 @@ typedef uint32_t rtimer_clock_t;
 #define AES_128_CONF            cc2538_aes_128_driver /**< AES-128 driver */
 #endif
 
+#ifndef SHA_256_CONF
+#define SHA_256_CONF            cc2538_sha_256_driver /**< SHA-256 driver */
+#endif
+
 #ifndef CCM_STAR_CONF
 #define CCM_STAR_CONF           cc2538_ccm_star_driver /**< AES-CCM* driver */
 #endif